@@ -0,0 +1,426 @@
+/* saugns: Benchmark program for the library interface.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "lib/libsaugns.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#define NAME "bench-lib"
+
+#define PULL_FRAMES 1024
+#define DEFAULT_SRATE 96000
+#define DEFAULT_COUNT 10
+
+/*
+ * Print command line usage instructions.
+ */
+static void print_usage(void) {
+	fputs(
+"Usage: "NAME" [-f] [-e] [-r <srate>] [-n <count>] [-s <events>] <script>...\n"
+"       "NAME" [-n <count>] -g <events>\n"
+"       "NAME" -c\n"
+"\n"
+"Build each script through the library, then render it\n"
+"<count> times with the same renderer, reset between runs.\n"
+"\n"
+"  -e \tEvaluate strings instead of files.\n"
+"  -f \tRender 32-bit float samples, instead of 16-bit integer.\n"
+"  -r \tSample rate in Hz (default 96000).\n"
+"  -n \tNumber of times to render each script (default 10).\n"
+"  -s \tStream each script instead, converting this many events\n"
+"     \tat a time; building is then timed as part of rendering.\n"
+"  -g \tInstead of scripts, generate ones with 1/8, 1/4, 1/2 and all\n"
+"     \tof this many events, the voices in use growing with the count,\n"
+"     \tand time building each <count> times, to check that the time\n"
+"     \tper event stays near the same.\n"
+"  -c \tInstead of benchmarking, check that control commands\n"
+"     \tare applied at the exact frames given.\n"
+"  -h \tPrint this message.\n",
+		stderr);
+}
+
+/*
+ * Read file into NUL-terminated string.
+ *
+ * \return allocated string or NULL on error
+ */
+static char *read_file(const char *restrict path, size_t *restrict len) {
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return NULL;
+	char *text = NULL;
+	size_t count = 0, alloc = 0;
+	for (;;) {
+		if (count + BUFSIZ > alloc) {
+			alloc = (alloc > 0) ? alloc * 2 : BUFSIZ;
+			char *new_text = realloc(text, alloc);
+			if (!new_text) goto ERROR;
+			text = new_text;
+		}
+		size_t read_len = fread(text + count, 1, BUFSIZ, f);
+		count += read_len;
+		if (read_len < BUFSIZ) {
+			if (ferror(f)) goto ERROR;
+			break;
+		}
+	}
+	fclose(f);
+	*len = count;
+	return text;
+ERROR:
+	fclose(f);
+	free(text);
+	return NULL;
+}
+
+/*
+ * \return seconds elapsed for processor since \p start
+ */
+static double elapsed(clock_t start) {
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/*
+ * Pull audio from renderer until the end.
+ *
+ * \return number of frames rendered
+ */
+static size_t pull_all(SAU_LibRenderer *restrict ren, int format,
+		void *restrict buf) {
+	size_t frames = 0, pulled;
+	do {
+		pulled = SAU_LibRenderer_pull(ren, buf, PULL_FRAMES, format);
+		frames += pulled;
+	} while (pulled == PULL_FRAMES);
+	return frames;
+}
+
+/*
+ * Stream and render script, printing times.
+ *
+ * \return true unless error occurred
+ */
+static bool bench_stream(const char *restrict name,
+		const char *restrict text, size_t len,
+		uint32_t srate, unsigned count, int format,
+		size_t chunk_len, void *restrict buf) {
+	size_t frames = 0;
+	clock_t start = clock();
+	for (unsigned i = 0; i < count; ++i) {
+		SAU_LibRenderer *ren = SAU_create_LibStreamRenderer(text, len,
+				srate, chunk_len);
+		if (!ren)
+			return false;
+		frames += pull_all(ren, format, buf);
+		SAU_destroy_LibRenderer(ren);
+	}
+	double render_s = elapsed(start);
+	double audio_s = (double) frames / srate;
+	printf("%s: stream %.3f ms/run, %.1fx realtime\n",
+			name,
+			render_s * 1000.0 / count,
+			(render_s > 0.0) ? audio_s / render_s : 0.0);
+	return true;
+}
+
+/*
+ * Build and render script, printing times.
+ *
+ * \return true unless error occurred
+ */
+static bool bench_script(const char *restrict arg, bool is_path,
+		uint32_t srate, unsigned count, int format,
+		size_t chunk_len, void *restrict buf) {
+	size_t len = strlen(arg);
+	char *text = NULL;
+	if (is_path && !(text = read_file(arg, &len))) {
+		fprintf(stderr, NAME": couldn't read \"%s\"\n", arg);
+		return false;
+	}
+	if (chunk_len > 0) {
+		bool ok = bench_stream(is_path ? arg : "<string>",
+				is_path ? text : arg, len,
+				srate, count, format, chunk_len, buf);
+		free(text);
+		return ok;
+	}
+	clock_t start = clock();
+	SAU_LibProgram *prg = SAU_LibProgram_build(is_path ? text : arg, len);
+	double build_s = elapsed(start);
+	free(text);
+	if (!prg)
+		return false;
+	SAU_LibRenderer *ren = SAU_create_LibRenderer(prg, srate, NULL);
+	if (!ren) {
+		SAU_LibProgram_discard(prg);
+		return false;
+	}
+	size_t frames = 0;
+	start = clock();
+	for (unsigned i = 0; i < count; ++i) {
+		if (i > 0 && !SAU_LibRenderer_reset(ren, prg, srate, NULL))
+			break;
+		frames += pull_all(ren, format, buf);
+	}
+	double render_s = elapsed(start);
+	double audio_s = (double) frames / srate;
+	printf("%s: build %.3f ms, render %.3f ms/run, %.1fx realtime\n",
+			is_path ? arg : "<string>",
+			build_s * 1000.0,
+			render_s * 1000.0 / count,
+			(render_s > 0.0) ? audio_s / render_s : 0.0);
+	SAU_destroy_LibRenderer(ren);
+	SAU_LibProgram_discard(prg);
+	return true;
+}
+
+/*
+ * Generate script with \p events events, each a voice with a wait
+ * after it. Every 16th voice plays until the end, so that the number
+ * of voices in use grows with the length; the rest are short, some
+ * with a modulator.
+ *
+ * \return allocated string or NULL on error
+ */
+static char *generate_script(size_t events, size_t *restrict len) {
+	size_t alloc = events * 64 + 1;
+	char *text = malloc(alloc);
+	if (!text)
+		return NULL;
+	uint32_t seed = 1;
+	size_t count = 0;
+	for (size_t i = 0; i < events; ++i) {
+		seed = seed * 1103515245 + 12345;
+		uint32_t r = seed >> 8;
+		unsigned freq = 100 + r % 900;
+		if (i % 16 == 0)
+			count += sprintf(text + count,
+					"Osin f%u t%.2f a0.01 \\0.01\n",
+					freq, (events - i) * 0.01 + 0.1);
+		else if (r % 4 == 0)
+			count += sprintf(text + count,
+					"Osin f%u t%.2f a0.1 p+[Osin r%u.5] "
+					"\\0.01\n",
+					freq, 0.05 + (r >> 10) % 96 * 0.01,
+					1 + (r >> 4) % 4);
+		else
+			count += sprintf(text + count,
+					"Osin f%u t%.2f a0.1 \\0.01\n",
+					freq, 0.05 + (r >> 10) % 96 * 0.01);
+	}
+	*len = count;
+	return text;
+}
+
+/*
+ * Build generated scripts of growing size, printing times
+ * and the time per event relative to the smallest size.
+ *
+ * \return true unless error occurred
+ */
+static bool bench_generated(size_t events, unsigned count) {
+	double first_us = 0.0;
+	for (int shift = 3; shift >= 0; --shift) {
+		size_t n = events >> shift, len;
+		if (!n) continue;
+		char *text = generate_script(n, &len);
+		if (!text) {
+			fputs(NAME": memory allocation failure\n", stderr);
+			return false;
+		}
+		clock_t start = clock();
+		for (unsigned i = 0; i < count; ++i) {
+			SAU_LibProgram *prg = SAU_LibProgram_build(text, len);
+			if (!prg) {
+				free(text);
+				return false;
+			}
+			SAU_LibProgram_discard(prg);
+		}
+		double build_s = elapsed(start) / count;
+		double event_us = build_s * 1e6 / n;
+		if (!first_us) first_us = event_us;
+		printf("%zu events: build %.3f ms, %.3f us/event (%.2fx)\n",
+				n, build_s * 1000.0, event_us,
+				(first_us > 0.0) ? event_us / first_us : 0.0);
+		free(text);
+	}
+	return true;
+}
+
+/*
+ * Control commands for check, setting the amplitude of the
+ * operator to 0.0 and back to 1.0 over the rendering.
+ */
+static const struct {
+	uint64_t time;
+	float amp;
+	bool late; /* pushed after rendering has begun */
+} ctl_cases[] = {
+	{1000, 0.f, false},
+	{1500, 1.f, false},
+	{1501, 0.f, false},
+	{1502, 1.f, false},
+	{3000, 0.f, true},
+	{3333, 1.f, true},
+};
+
+#define CTL_SRATE 48000
+#define CTL_FRAMES 4000
+#define CTL_PULL_FRAMES 333 /* uneven, so commands fall within pulls */
+
+/*
+ * Push the ctl_cases commands to \p ctl which are, or are not,
+ * to be pushed \p late.
+ *
+ * \return true unless the queue is full
+ */
+static bool push_ctl(SAU_LibCtlQueue *restrict ctl, bool late) {
+	const size_t case_count = sizeof(ctl_cases) / sizeof(*ctl_cases);
+	for (size_t i = 0; i < case_count; ++i) {
+		if (ctl_cases[i].late != late) continue;
+		SAU_LibCtl cmd = {.time = ctl_cases[i].time,
+			.type = SAU_LIB_CTL_OP_AMP,
+			.flags = SAU_LIB_CTLF_VALUE,
+			.value = ctl_cases[i].amp};
+		if (!SAU_LibCtlQueue_push(ctl, &cmd))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Render the check script with the ctl_cases commands, or none
+ * if \p ctl is NULL, into \p buf of CTL_FRAMES frames.
+ *
+ * \return true unless error occurred
+ */
+static bool render_ctl(const SAU_LibProgram *restrict prg,
+		SAU_LibCtlQueue *restrict ctl, int16_t *restrict buf) {
+	SAU_LibRenderer *ren = SAU_create_LibRenderer(prg, CTL_SRATE, NULL);
+	if (!ren)
+		return false;
+	bool ok = !ctl || push_ctl(ctl, false);
+	SAU_LibRenderer_set_ctl(ren, ctl);
+	for (size_t pos = 0; ok && pos < CTL_FRAMES; ) {
+		size_t len = CTL_PULL_FRAMES;
+		if (len > CTL_FRAMES - pos) len = CTL_FRAMES - pos;
+		SAU_LibRenderer_pull(ren, &buf[pos * SAU_LIB_CHANNELS],
+				len, SAU_LIB_FMT_S16);
+		pos += len;
+		if (ctl != NULL && pos == CTL_PULL_FRAMES)
+			ok = push_ctl(ctl, true);
+	}
+	SAU_destroy_LibRenderer(ren);
+	return ok;
+}
+
+/*
+ * Check that control commands pushed to a queue, before and during
+ * rendering, are applied at the exact frames of their times. Audio
+ * rendered with them must match that rendered without, silenced
+ * between each 0.0 amplitude and the next 1.0.
+ *
+ * \return true if all frames match
+ */
+static bool check_ctl(void) {
+	static const char text[] = "Osin f440 t1";
+	static int16_t ref[CTL_FRAMES * SAU_LIB_CHANNELS];
+	static int16_t out[CTL_FRAMES * SAU_LIB_CHANNELS];
+	SAU_LibProgram *prg = SAU_LibProgram_build(text, sizeof(text) - 1);
+	SAU_LibCtlQueue *ctl = SAU_create_LibCtlQueue(16);
+	size_t fails = 0;
+	bool ok = false;
+	if (!prg || !ctl ||
+			!render_ctl(prg, NULL, ref) ||
+			!render_ctl(prg, ctl, out)) {
+		fputs(NAME": couldn't render for control check\n", stderr);
+		goto DONE;
+	}
+	const size_t case_count = sizeof(ctl_cases) / sizeof(*ctl_cases);
+	size_t next = 0;
+	float amp = 1.f;
+	for (size_t i = 0; i < CTL_FRAMES; ++i) {
+		while (next < case_count && ctl_cases[next].time <= i)
+			amp = ctl_cases[next++].amp;
+		for (size_t c = 0; c < SAU_LIB_CHANNELS; ++c) {
+			size_t j = i * SAU_LIB_CHANNELS + c;
+			int16_t expect = (amp != 0.f) ? ref[j] : 0;
+			if (out[j] == expect) continue;
+			if (++fails <= 10)
+				printf("  mismatch at frame %zu: %d, expected %d\n",
+						i, out[j], expect);
+		}
+		/* check the test isn't vacuous */
+		if (i + 1 == ctl_cases[0].time && !ref[i * SAU_LIB_CHANNELS])
+			++fails;
+	}
+	printf("control: %zu commands, %d frames checked, %zu mismatched\n",
+			case_count, CTL_FRAMES, fails);
+	ok = !fails;
+DONE:
+	SAU_destroy_LibCtlQueue(ctl);
+	SAU_LibProgram_discard(prg);
+	return ok;
+}
+
+/**
+ * Main function.
+ */
+int main(int argc, char **restrict argv) {
+	uint32_t srate = DEFAULT_SRATE;
+	unsigned count = DEFAULT_COUNT;
+	size_t chunk_len = 0, gen_events = 0;
+	int format = SAU_LIB_FMT_S16;
+	bool is_path = true;
+	int i;
+	for (i = 1; i < argc && argv[i][0] == '-'; ++i) {
+		const char *arg = argv[i];
+		if (!strcmp(arg, "-e")) {
+			is_path = false;
+		} else if (!strcmp(arg, "-f")) {
+			format = SAU_LIB_FMT_F32;
+		} else if (!strcmp(arg, "-r") && i + 1 < argc) {
+			srate = strtoul(argv[++i], NULL, 10);
+		} else if (!strcmp(arg, "-n") && i + 1 < argc) {
+			count = strtoul(argv[++i], NULL, 10);
+		} else if (!strcmp(arg, "-s") && i + 1 < argc) {
+			chunk_len = strtoul(argv[++i], NULL, 10);
+		} else if (!strcmp(arg, "-c")) {
+			if (argc != 2) goto USAGE;
+			return !check_ctl();
+		} else if (!strcmp(arg, "-g") && i + 1 < argc) {
+			gen_events = strtoul(argv[++i], NULL, 10);
+			if (!gen_events) goto USAGE;
+		} else {
+			goto USAGE;
+		}
+	}
+	if (gen_events > 0) {
+		if (i < argc || !count) goto USAGE;
+		return !bench_generated(gen_events, count);
+	}
+	if (i == argc || !srate || !count) goto USAGE;
+	float buf[PULL_FRAMES * SAU_LIB_CHANNELS];
+	bool error = false;
+	for (; i < argc; ++i) {
+		if (!bench_script(argv[i], is_path, srate, count, format,
+					chunk_len, buf))
+			error = true;
+	}
+	return error;
+USAGE:
+	print_usage();
+	return 0;
+}
@@ -13,15 +13,26 @@
 
 #include "../saugns.h"
 #include "../script.h"
+#include "../arrtype.h"
+#include "progfile.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /*
  * Create program for the given script file. Invokes the parser.
+ * If \p pipelined, the stages are run together, freeing memory
+ * behind them. If not a path, \p script_arg is a string named
+ * \p name, or "<string>" if NULL.
  *
  * \return instance or NULL on error
  */
 static SAU_Program *build_program(const char *restrict script_arg,
-		bool is_path) {
-	SAU_Script *sd = SAU_load_Script(script_arg, is_path);
+		bool is_path, const char *restrict name, bool pipelined) {
+	if (pipelined)
+		return SAU_build_piped_Program(script_arg, is_path, name);
+	SAU_Script *sd = SAU_load_Script(script_arg, is_path, name);
 	if (!sd)
 		return NULL;
 	SAU_Program *o = SAU_build_Program(sd);
@@ -29,19 +40,115 @@ static SAU_Program *build_program(const char *restrict script_arg,
 	return o;
 }
 
+/*
+ * Read the contents of the file at \p path into \p buf,
+ * adding a terminating NUL which is not counted.
+ *
+ * \return true, or false if the file could not be read
+ */
+static bool read_script(const char *restrict path,
+		SAU_ByteArr *restrict buf) {
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return false;
+	bool ok = true;
+	for (;;) {
+		if (!SAU_ByteArr_upsize(buf, buf->count + BUFSIZ)) {
+			ok = false;
+			break;
+		}
+		size_t len = fread(buf->a + buf->count, 1, BUFSIZ, f);
+		buf->count += len;
+		if (len < BUFSIZ) {
+			ok = !ferror(f);
+			break;
+		}
+	}
+	fclose(f);
+	if (ok)
+		buf->a[buf->count] = '\0'; // fits, as last read was short
+	return ok;
+}
+
+/*
+ * Create program for the given script file, using the program file cache
+ * in \p cache_dir. A program file found for the same script contents is
+ * loaded instead of parsing the script; otherwise, the program is built
+ * and a program file written for it. Files are named for the build mode
+ * too, so that a program built one way is never used for the other.
+ *
+ * A script file is read once, and the contents hashed are also those
+ * parsed, so that a file changed meanwhile can't be cached under the
+ * key for its earlier contents.
+ *
+ * \return instance or NULL on error
+ */
+static SAU_Program *build_program_cached(const char *restrict script_arg,
+		bool is_path, bool pipelined, const char *restrict cache_dir) {
+	SAU_ByteArr text = (SAU_ByteArr){0};
+	const char *str = script_arg;
+	size_t str_len;
+	SAU_Program *o = NULL;
+	char *path = NULL;
+	if (is_path) {
+		if (!read_script(script_arg, &text)) {
+			o = build_program(script_arg, is_path, NULL,
+					pipelined); // reports error
+			goto DONE;
+		}
+		str = (const char*) text.a;
+		str_len = text.count;
+	} else {
+		str_len = strlen(script_arg);
+	}
+	/* With a path, the contents are parsed as a string named by it. */
+	const char *name = is_path ? script_arg : NULL;
+	uint64_t key = SAU_ProgramFile_hash(str, str_len);
+	const char *fmt = "%s/%016"PRIx64"%s" SAU_PROGRAMFILE_SUFFIX;
+	const char *mode = pipelined ? "-P" : "";
+	int len = snprintf(NULL, 0, fmt, cache_dir, key, mode);
+	path = (len > 0) ? malloc(len + 1) : NULL;
+	if (!path) {
+		o = build_program(str, false, name, pipelined);
+		goto DONE;
+	}
+	snprintf(path, len + 1, fmt, cache_dir, key, mode);
+	o = SAU_load_ProgramFile(path, key, str_len,
+			is_path ? script_arg : "<string>");
+	if (!o) {
+		o = build_program(str, false, name, pipelined);
+		if (o != NULL && !SAU_write_ProgramFile(o, path, key, str_len))
+			SAU_warning("builder",
+"couldn't write program file \"%s\"", path);
+	}
+DONE:
+	free(path);
+	SAU_ByteArr_clear(&text);
+	return o;
+}
+
 /**
  * Build the listed scripts, adding each result (even if NULL)
  * to the program list.
  *
+ * If \p cache_dir is not NULL, programs are cached as files in
+ * that directory, keyed by script contents, and loaded from it
+ * instead of being rebuilt when a script is unchanged.
+ *
  * \return number of programs successfully built
  */
 size_t SAU_build(const SAU_PtrArr *restrict script_args, uint32_t options,
+		const char *restrict cache_dir,
 		SAU_PtrArr *restrict prg_objs) {
 	bool are_paths = !(options & SAU_ARG_EVAL_STRING);
+	bool pipelined = (options & SAU_ARG_PIPELINE) != 0;
 	size_t built = 0;
 	const char **args = (const char**) SAU_PtrArr_ITEMS(script_args);
 	for (size_t i = 0; i < script_args->count; ++i) {
-		SAU_Program *prg = build_program(args[i], are_paths);
+		SAU_Program *prg = (cache_dir != NULL) ?
+			build_program_cached(args[i], are_paths, pipelined,
+					cache_dir) :
+			build_program(args[i], are_paths, NULL, pipelined);
 		if (prg != NULL) ++built;
 		SAU_PtrArr_add(prg_objs, prg);
 	}
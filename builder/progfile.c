@@ -0,0 +1,632 @@
+/* saugns: Audio program file (compiled program cache) module.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "progfile.h"
+#include "../saugns.h"
+#include "../arrtype.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Program file format.
+ *
+ * A program file holds an image of all the data of an SAU_Program, in
+ * the native memory layout, but with each pointer replaced by an offset
+ * from the beginning of the file. A table of the locations of all such
+ * pointers follows the data. Loading a file maps it into memory, then
+ * adds the base address to each location listed. Nothing is parsed.
+ *
+ * The header records the sizes of the types stored, so that a file for
+ * another layout (e.g. written by a different build) is simply rejected,
+ * like a file with another version number. The script contents the file
+ * was built from are identified by a hash and a length. The hash, and
+ * the header, also include the version string, so that files written
+ * by other versions are never used, even if the layout is the same.
+ */
+
+#define PRGFILE_MAGIC "SAUprg\r\n"
+#define PRGFILE_VERSION 6
+#define PRGFILE_SAU_VERSION_MAX 32
+#define PRGFILE_BYTE_ORDER UINT32_C(0x01020304)
+
+typedef struct ProgramFileHead {
+	char magic[8];
+	char sau_version[PRGFILE_SAU_VERSION_MAX];
+	uint32_t version;
+	uint32_t byte_order;
+	uint16_t ptr_size;
+	uint16_t prg_size;
+	uint16_t ev_size;
+	uint16_t vo_size;
+	uint16_t op_size;
+	uint16_t oplist_size;
+	uint16_t arg_size;
+	uint16_t argslot_size;
+	uint16_t loop_size;
+	uint64_t key;
+	uint64_t key_len;
+	uint64_t file_size;
+	uint64_t reloc_offset;
+	uint64_t reloc_count;
+	SAU_Program prg;
+} ProgramFileHead;
+
+/* Alignment used for each object in a program file. */
+#define PRGFILE_ALIGN 8
+
+/*
+ * Compute MurmurHash64A of \p data of length \p len, using \p seed.
+ *
+ * \return hash
+ */
+static uint64_t murmur64a(const void *restrict data, size_t len,
+		uint64_t seed) {
+	const uint64_t m = UINT64_C(0xC6A4A7935BD1E995);
+	const uint8_t *s = data;
+	uint64_t h = seed ^ (len * m);
+	uint64_t k;
+	size_t i = 0;
+	for (; i + 8 <= len; i += 8) {
+		memcpy(&k, &s[i], 8);
+		k *= m;
+		k ^= k >> 47;
+		k *= m;
+		h ^= k;
+		h *= m;
+	}
+	if (i < len) {
+		k = 0;
+		for (size_t j = 0; i + j < len; ++j)
+			k |= (uint64_t) s[i + j] << (j * 8);
+		h ^= k;
+		h *= m;
+	}
+	h ^= h >> 47;
+	h *= m;
+	h ^= h >> 47;
+	return h;
+}
+
+/**
+ * Compute 64-bit hash of \p data of length \p len,
+ * for use as a key identifying script contents.
+ *
+ * (Uses the MurmurHash64A algorithm, seeded with a hash
+ * of SAU_VERSION_STR, so that keys differ between versions.)
+ *
+ * \return hash
+ */
+uint64_t SAU_ProgramFile_hash(const void *restrict data, size_t len) {
+	static const char version[] = SAU_VERSION_STR;
+	uint64_t seed = murmur64a(version, sizeof(version) - 1,
+			UINT64_C(0x5341554E53505247));
+	return murmur64a(data, len, seed);
+}
+
+/*
+ * Program file writing.
+ */
+
+sauArrType(OffsetArr, uint64_t, _)
+
+typedef struct PtrMapItem {
+	const void *ptr;
+	size_t offset;
+} PtrMapItem;
+
+/*
+ * Hash table mapping memory addresses to offsets in the file written.
+ */
+typedef struct PtrMap {
+	PtrMapItem *items;
+	size_t count;
+	size_t alloc;
+} PtrMap;
+
+#define PTRMAP_ALLOC_INITIAL 1024
+
+static inline size_t PtrMap_hash(const void *restrict ptr) {
+	uint64_t hash = (uintptr_t) ptr;
+	hash *= UINT64_C(0x9E3779B97F4A7C15);
+	return (size_t) (hash ^ (hash >> 32));
+}
+
+/*
+ * Find offset for \p ptr, setting it to \p offset.
+ *
+ * \return true if found
+ */
+static bool PtrMap_find(const PtrMap *restrict o,
+		const void *restrict ptr, size_t *restrict offset) {
+	if (!o->alloc)
+		return false;
+	size_t mask = o->alloc - 1;
+	for (size_t i = PtrMap_hash(ptr) & mask; ; i = (i + 1) & mask) {
+		PtrMapItem *item = &o->items[i];
+		if (!item->ptr)
+			return false;
+		if (item->ptr == ptr) {
+			*offset = item->offset;
+			return true;
+		}
+	}
+}
+
+/*
+ * Increase the size of the hash table.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool PtrMap_upsize(PtrMap *restrict o) {
+	PtrMapItem *items, *old_items = o->items;
+	size_t alloc, old_alloc = o->alloc;
+	alloc = (old_alloc > 0) ?
+		(old_alloc << 1) :
+		PTRMAP_ALLOC_INITIAL;
+	items = calloc(alloc, sizeof(PtrMapItem));
+	if (!items)
+		return false;
+	for (size_t i = 0; i < old_alloc; ++i) {
+		PtrMapItem *old_item = &old_items[i];
+		if (!old_item->ptr)
+			continue;
+		size_t j = PtrMap_hash(old_item->ptr) & (alloc - 1);
+		while (items[j].ptr != NULL)
+			j = (j + 1) & (alloc - 1);
+		items[j] = *old_item;
+	}
+	free(old_items);
+	o->items = items;
+	o->alloc = alloc;
+	return true;
+}
+
+/*
+ * Add \p ptr with \p offset. It must not already be present.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool PtrMap_add(PtrMap *restrict o,
+		const void *restrict ptr, size_t offset) {
+	if (o->count >= (o->alloc / 2)) {
+		if (!PtrMap_upsize(o))
+			return false;
+	}
+	size_t mask = o->alloc - 1;
+	size_t i = PtrMap_hash(ptr) & mask;
+	while (o->items[i].ptr != NULL)
+		i = (i + 1) & mask;
+	o->items[i].ptr = ptr;
+	o->items[i].offset = offset;
+	++o->count;
+	return true;
+}
+
+static void PtrMap_clear(PtrMap *restrict o) {
+	free(o->items);
+	*o = (PtrMap){0};
+}
+
+typedef struct ProgramWriter {
+	SAU_ByteArr data;
+	OffsetArr relocs;
+	PtrMap ptrs;
+} ProgramWriter;
+
+/*
+ * Allocate zeroed, aligned space of \p size at the end of the data,
+ * setting \p offset to its position.
+ *
+ * Any pointers into the data are invalidated; use offsets.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ProgramWriter_alloc(ProgramWriter *restrict o,
+		size_t size, size_t *restrict offset) {
+	size_t start = (o->data.count + (PRGFILE_ALIGN - 1)) &
+		~(size_t) (PRGFILE_ALIGN - 1);
+	if (!SAU_ByteArr_upsize(&o->data, start + size))
+		return false;
+	memset(o->data.a + o->data.count, 0, (start + size) - o->data.count);
+	o->data.count = start + size;
+	*offset = start;
+	return true;
+}
+
+/*
+ * Set pointer at \p field offset to point to \p target offset,
+ * or to NULL if \p set is false. Records the relocation needed.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ProgramWriter_set_ptr(ProgramWriter *restrict o,
+		size_t field, size_t target, bool set) {
+	uintptr_t value = set ? target : 0;
+	memcpy(o->data.a + field, &value, sizeof(value));
+	if (!set)
+		return true;
+	uint64_t reloc = field;
+	return _OffsetArr_add(&o->relocs, &reloc) != NULL;
+}
+
+/*
+ * Set pointer at \p field offset to the offset already written
+ * for \p ptr, or to NULL if \p ptr is NULL.
+ *
+ * \return true, or false on missing object or allocation failure
+ */
+static bool ProgramWriter_link(ProgramWriter *restrict o,
+		size_t field, const void *restrict ptr) {
+	size_t target = 0;
+	if (ptr != NULL && !PtrMap_find(&o->ptrs, ptr, &target))
+		return false;
+	return ProgramWriter_set_ptr(o, field, target, ptr != NULL);
+}
+
+/*
+ * Set pointer at \p field offset to operator list \p list,
+ * adding a copy of the list unless already written.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ProgramWriter_set_oplist(ProgramWriter *restrict o,
+		size_t field, const SAU_ProgramOpList *restrict list) {
+	size_t target = 0;
+	if (list != NULL && !PtrMap_find(&o->ptrs, list, &target)) {
+		size_t size = sizeof(SAU_ProgramOpList) +
+			sizeof(uint32_t) * list->count;
+		if (!ProgramWriter_alloc(o, size, &target) ||
+			!PtrMap_add(&o->ptrs, list, target)) return false;
+		memcpy(o->data.a + target, list, size);
+	}
+	return ProgramWriter_set_ptr(o, field, target, list != NULL);
+}
+
+/*
+ * Set pointer at \p field offset to script argument list \p list,
+ * adding a copy of the list, or to NULL if \p list is NULL.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ProgramWriter_set_arglist(ProgramWriter *restrict o,
+		size_t field, const SAU_ProgramArgList *restrict list) {
+	size_t target = 0;
+	if (list != NULL) {
+		size_t size = sizeof(SAU_ProgramArgList) +
+			sizeof(SAU_ProgramArgSlot) * list->count;
+		if (!ProgramWriter_alloc(o, size, &target)) return false;
+		memcpy(o->data.a + target, list, size);
+	}
+	return ProgramWriter_set_ptr(o, field, target, list != NULL);
+}
+
+/*
+ * Add the script arguments of \p prg, with their names,
+ * setting \p offset to the position of the array.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ProgramWriter_add_args(ProgramWriter *restrict o,
+		const SAU_Program *restrict prg, size_t *restrict offset) {
+	if (!ProgramWriter_alloc(o, sizeof(SAU_ProgramArg) * prg->arg_count,
+				offset)) return false;
+	for (size_t i = 0; i < prg->arg_count; ++i) {
+		const SAU_ProgramArg *arg = &prg->args[i];
+		size_t arg_offset = *offset + i * sizeof(SAU_ProgramArg);
+		size_t name_len = strlen(arg->name) + 1, name_offset;
+		memcpy(o->data.a + arg_offset, arg, sizeof(SAU_ProgramArg));
+		if (!ProgramWriter_alloc(o, name_len, &name_offset))
+			return false;
+		memcpy(o->data.a + name_offset, arg->name, name_len);
+		if (!ProgramWriter_set_ptr(o, arg_offset +
+				offsetof(SAU_ProgramArg, name),
+				name_offset, true))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Add voice data \p vd for event written at \p ev_offset.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ProgramWriter_add_vo_data(ProgramWriter *restrict o,
+		size_t ev_offset, const SAU_ProgramVoData *restrict vd) {
+	size_t offset;
+	if (!ProgramWriter_alloc(o, sizeof(SAU_ProgramVoData), &offset) ||
+		!PtrMap_add(&o->ptrs, vd, offset)) return false;
+	memcpy(o->data.a + offset, vd, sizeof(SAU_ProgramVoData));
+	if (!ProgramWriter_set_oplist(o, offset +
+			offsetof(SAU_ProgramVoData, carriers), vd->carriers) ||
+		!ProgramWriter_link(o, offset +
+			offsetof(SAU_ProgramVoData, prev), vd->prev))
+		return false;
+	return ProgramWriter_set_ptr(o, ev_offset +
+			offsetof(SAU_ProgramEvent, vo_data), offset, true);
+}
+
+/*
+ * Add the operator data array of \p ev, for event written
+ * at \p ev_offset.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ProgramWriter_add_op_data(ProgramWriter *restrict o,
+		size_t ev_offset, const SAU_ProgramEvent *restrict ev) {
+	size_t offset;
+	if (!ProgramWriter_alloc(o,
+			sizeof(SAU_ProgramOpData) * ev->op_data_count,
+			&offset)) return false;
+	for (size_t i = 0; i < ev->op_data_count; ++i) {
+		const SAU_ProgramOpData *od = &ev->op_data[i];
+		size_t od_offset = offset + i * sizeof(SAU_ProgramOpData);
+		if (!PtrMap_add(&o->ptrs, od, od_offset)) return false;
+		memcpy(o->data.a + od_offset, od, sizeof(SAU_ProgramOpData));
+		if (!ProgramWriter_set_oplist(o, od_offset +
+				offsetof(SAU_ProgramOpData, fmods), od->fmods) ||
+			!ProgramWriter_set_oplist(o, od_offset +
+				offsetof(SAU_ProgramOpData, pmods), od->pmods) ||
+			!ProgramWriter_set_oplist(o, od_offset +
+				offsetof(SAU_ProgramOpData, amods), od->amods) ||
+			!ProgramWriter_set_arglist(o, od_offset +
+				offsetof(SAU_ProgramOpData, args), od->args) ||
+			!ProgramWriter_link(o, od_offset +
+				offsetof(SAU_ProgramOpData, prev), od->prev))
+			return false;
+	}
+	return ProgramWriter_set_ptr(o, ev_offset +
+			offsetof(SAU_ProgramEvent, op_data), offset, true);
+}
+
+/*
+ * Write an image of \p prg into the data, followed
+ * by the relocation table.
+ *
+ * \return true, or false on error
+ */
+static bool ProgramWriter_build(ProgramWriter *restrict o,
+		const SAU_Program *restrict prg,
+		uint64_t key, uint64_t key_len) {
+	size_t head_offset, evp_offset, ev_offset, args_offset = 0;
+	size_t loops_offset = 0;
+	size_t reloc_offset;
+	if (!ProgramWriter_alloc(o, sizeof(ProgramFileHead), &head_offset))
+		return false;
+	if (!ProgramWriter_alloc(o, sizeof(SAU_ProgramEvent*) * prg->ev_count,
+				&evp_offset) ||
+		!ProgramWriter_alloc(o,
+			sizeof(SAU_ProgramEvent) * prg->ev_count,
+			&ev_offset)) return false;
+	for (size_t i = 0; i < prg->ev_count; ++i) {
+		const SAU_ProgramEvent *ev = prg->events[i];
+		size_t offset = ev_offset + i * sizeof(SAU_ProgramEvent);
+		memcpy(o->data.a + offset, ev, sizeof(SAU_ProgramEvent));
+		if (!ProgramWriter_set_ptr(o,
+				evp_offset + i * sizeof(SAU_ProgramEvent*),
+				offset, true) ||
+			!ProgramWriter_set_ptr(o, offset +
+				offsetof(SAU_ProgramEvent, vo_data), 0, false) ||
+			!ProgramWriter_set_ptr(o, offset +
+				offsetof(SAU_ProgramEvent, op_data), 0, false))
+			return false;
+		if (ev->vo_data != NULL &&
+			!ProgramWriter_add_vo_data(o, offset, ev->vo_data))
+			return false;
+		if (ev->op_data_count > 0 &&
+			!ProgramWriter_add_op_data(o, offset, ev))
+			return false;
+	}
+	if (prg->arg_count > 0 &&
+		!ProgramWriter_add_args(o, prg, &args_offset))
+		return false;
+	if (prg->loop_count > 0) {
+		size_t size = sizeof(SAU_ProgramLoop) * prg->loop_count;
+		if (!ProgramWriter_alloc(o, size, &loops_offset))
+			return false;
+		memcpy(o->data.a + loops_offset, prg->loops, size);
+	}
+	ProgramFileHead *head = (ProgramFileHead*) (o->data.a + head_offset);
+	memcpy(head->magic, PRGFILE_MAGIC, sizeof(head->magic));
+	strncpy(head->sau_version, SAU_VERSION_STR,
+			sizeof(head->sau_version));
+	head->version = PRGFILE_VERSION;
+	head->byte_order = PRGFILE_BYTE_ORDER;
+	head->ptr_size = sizeof(void*);
+	head->prg_size = sizeof(SAU_Program);
+	head->ev_size = sizeof(SAU_ProgramEvent);
+	head->vo_size = sizeof(SAU_ProgramVoData);
+	head->op_size = sizeof(SAU_ProgramOpData);
+	head->oplist_size = sizeof(SAU_ProgramOpList);
+	head->arg_size = sizeof(SAU_ProgramArg);
+	head->argslot_size = sizeof(SAU_ProgramArgSlot);
+	head->loop_size = sizeof(SAU_ProgramLoop);
+	head->key = key;
+	head->key_len = key_len;
+	head->prg = *prg;
+	head->prg.name = NULL; // set upon load
+	head->prg.mem = NULL;
+	if (!ProgramWriter_set_ptr(o, head_offset +
+			offsetof(ProgramFileHead, prg) +
+			offsetof(SAU_Program, events),
+			evp_offset, prg->ev_count > 0) ||
+		!ProgramWriter_set_ptr(o, head_offset +
+			offsetof(ProgramFileHead, prg) +
+			offsetof(SAU_Program, args),
+			args_offset, prg->arg_count > 0) ||
+		!ProgramWriter_set_ptr(o, head_offset +
+			offsetof(ProgramFileHead, prg) +
+			offsetof(SAU_Program, loops),
+			loops_offset, prg->loop_count > 0)) return false;
+	size_t reloc_count = o->relocs.count;
+	if (!ProgramWriter_alloc(o, sizeof(uint64_t) * reloc_count,
+				&reloc_offset)) return false;
+	memcpy(o->data.a + reloc_offset, o->relocs.a,
+			sizeof(uint64_t) * reloc_count);
+	head = (ProgramFileHead*) (o->data.a + head_offset);
+	head->reloc_offset = reloc_offset;
+	head->reloc_count = reloc_count;
+	head->file_size = o->data.count;
+	return true;
+}
+
+/**
+ * Write program file for \p prg to \p path, identifying the
+ * script contents it was built from using \p key and \p key_len.
+ *
+ * The file is first written under a temporary name, then renamed,
+ * so that a partially written file is never found at \p path.
+ *
+ * \return true on success
+ */
+bool SAU_write_ProgramFile(const SAU_Program *restrict prg,
+		const char *restrict path,
+		uint64_t key, uint64_t key_len) {
+	ProgramWriter pw = (ProgramWriter){0};
+	char *tmp_path = NULL;
+	FILE *f = NULL;
+	bool ok = false;
+	if (!ProgramWriter_build(&pw, prg, key, key_len)) {
+		SAU_error("progfile", "memory allocation failure");
+		goto DONE;
+	}
+	int len = snprintf(NULL, 0, "%s.%ld.tmp", path, (long) getpid());
+	if (len < 0 || !(tmp_path = malloc(len + 1))) goto DONE;
+	snprintf(tmp_path, len + 1, "%s.%ld.tmp", path, (long) getpid());
+	f = fopen(tmp_path, "wb");
+	if (!f) goto DONE;
+	ok = (fwrite(pw.data.a, 1, pw.data.count, f) == pw.data.count);
+	ok = (fclose(f) == 0) && ok;
+	if (ok)
+		ok = (rename(tmp_path, path) == 0);
+	if (!ok)
+		remove(tmp_path);
+DONE:
+	free(tmp_path);
+	_OffsetArr_clear(&pw.relocs);
+	SAU_ByteArr_clear(&pw.data);
+	PtrMap_clear(&pw.ptrs);
+	return ok;
+}
+
+/*
+ * Program file loading.
+ */
+
+/*
+ * Check that the header matches the current layout and the key,
+ * and that the table of relocations lies within the file.
+ *
+ * \return true if valid
+ */
+static bool check_head(const ProgramFileHead *restrict head, size_t size,
+		uint64_t key, uint64_t key_len) {
+	if (memcmp(head->magic, PRGFILE_MAGIC, sizeof(head->magic)) ||
+		strncmp(head->sau_version, SAU_VERSION_STR,
+			sizeof(head->sau_version)) ||
+		head->version != PRGFILE_VERSION ||
+		head->byte_order != PRGFILE_BYTE_ORDER ||
+		head->ptr_size != sizeof(void*) ||
+		head->prg_size != sizeof(SAU_Program) ||
+		head->ev_size != sizeof(SAU_ProgramEvent) ||
+		head->vo_size != sizeof(SAU_ProgramVoData) ||
+		head->op_size != sizeof(SAU_ProgramOpData) ||
+		head->oplist_size != sizeof(SAU_ProgramOpList) ||
+		head->arg_size != sizeof(SAU_ProgramArg) ||
+		head->argslot_size != sizeof(SAU_ProgramArgSlot) ||
+		head->loop_size != sizeof(SAU_ProgramLoop))
+		return false;
+	if (head->key != key || head->key_len != key_len ||
+		head->file_size != size)
+		return false;
+	if (head->reloc_offset > size ||
+		(head->reloc_offset & (PRGFILE_ALIGN - 1)) != 0 ||
+		head->reloc_count > (size - head->reloc_offset) /
+			sizeof(uint64_t))
+		return false;
+	return true;
+}
+
+/**
+ * Load program file at \p path if present and valid for the script
+ * contents identified by \p key and \p key_len. The file is mapped
+ * into memory and used in place, after adjusting its pointers.
+ *
+ * The program name is set to \p name, which must remain valid for
+ * the lifetime of the program.
+ *
+ * The program is to be destroyed using SAU_discard_Program().
+ *
+ * \return instance, or NULL if missing, mismatched or invalid
+ */
+SAU_Program *SAU_load_ProgramFile(const char *restrict path,
+		uint64_t key, uint64_t key_len,
+		const char *restrict name) {
+	struct stat st;
+	void *base = MAP_FAILED;
+	size_t size = 0;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) == 0 &&
+		st.st_size >= (off_t) sizeof(ProgramFileHead)) {
+		size = st.st_size;
+		base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (base == MAP_FAILED)
+		return NULL;
+	ProgramFileHead *head = base;
+	if (!check_head(head, size, key, key_len))
+		goto ERROR;
+	uint8_t *data = base;
+	const uint64_t *relocs = (const uint64_t*) (data + head->reloc_offset);
+	for (size_t i = 0; i < head->reloc_count; ++i) {
+		uint64_t field = relocs[i];
+		uintptr_t value;
+		if (field > size - sizeof(uintptr_t) ||
+			(field & (sizeof(uintptr_t) - 1)) != 0)
+			goto ERROR;
+		memcpy(&value, data + field, sizeof(uintptr_t));
+		if (value >= size)
+			goto ERROR;
+		value += (uintptr_t) base;
+		memcpy(data + field, &value, sizeof(uintptr_t));
+	}
+	head->prg.name = name;
+	head->prg.mem = NULL;
+	return &head->prg;
+ERROR:
+	munmap(base, size);
+	return NULL;
+}
+
+/**
+ * Unmap program loaded using SAU_load_ProgramFile().
+ * (Used by SAU_discard_Program().)
+ */
+void SAU_unload_ProgramFile(SAU_Program *restrict o) {
+	if (!o)
+		return;
+	ProgramFileHead *head = (ProgramFileHead*)
+		((uint8_t*) o - offsetof(ProgramFileHead, prg));
+	munmap(head, head->file_size);
+}
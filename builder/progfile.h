@@ -0,0 +1,30 @@
+/* saugns: Audio program file (compiled program cache) module.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "../program.h"
+
+/**
+ * File name suffix used for program files in a cache directory.
+ */
+#define SAU_PROGRAMFILE_SUFFIX ".sauprg"
+
+uint64_t SAU_ProgramFile_hash(const void *restrict data, size_t len);
+
+bool SAU_write_ProgramFile(const SAU_Program *restrict prg,
+		const char *restrict path,
+		uint64_t key, uint64_t key_len);
+SAU_Program *SAU_load_ProgramFile(const char *restrict path,
+		uint64_t key, uint64_t key_len,
+		const char *restrict name);
+void SAU_unload_ProgramFile(SAU_Program *restrict o);
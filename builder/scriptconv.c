@@ -12,8 +12,12 @@
  */
 
 #include "scriptconv.h"
-#include "../ptrarr.h"
+#include "progfile.h"
+#include "../math.h"
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /*
  * Program construction from script data.
@@ -24,9 +28,9 @@
 static const SAU_ProgramOpList blank_oplist = {0};
 
 static sauNoinline const SAU_ProgramOpList
-*create_ProgramOpList(const SAU_RefList *restrict op_list,
+*create_ProgramOpList(const SAU_ScriptOpList *restrict op_list,
 		SAU_MemPool *restrict mem) {
-	size_t count = op_list->ref_count;
+	uint32_t count = op_list->count;
 	if (!count)
 		return &blank_oplist;
 	SAU_ProgramOpList *o = SAU_MemPool_alloc(mem,
@@ -34,15 +38,26 @@ static sauNoinline const SAU_ProgramOpList
 	if (!o)
 		return NULL;
 	o->count = count;
-	size_t i = 0;
-	for (SAU_RefItem *ref = op_list->refs;
-			ref != NULL; ref = ref->next) {
-		SAU_ScriptOpData *op = ref->data;
-		o->ids[i++] = op->op_id;
-	}
+	for (uint32_t i = 0; i < count; ++i)
+		o->ids[i] = op_list->ops[i]->op_id;
 	return o;
 }
 
+/*
+ * Copy program operator list into \p mem.
+ *
+ * \return copy, or NULL on allocation failure
+ */
+static const SAU_ProgramOpList
+*copy_ProgramOpList(const SAU_ProgramOpList *restrict op_list,
+		SAU_MemPool *restrict mem) {
+	if (!op_list->count)
+		return &blank_oplist;
+	return SAU_MemPool_memdup(mem, op_list,
+			sizeof(SAU_ProgramOpList) +
+			sizeof(uint32_t) * op_list->count);
+}
+
 /*
  * Returns the longest carrier duration for the voice event.
  */
@@ -50,40 +65,118 @@ static uint32_t voice_duration(const SAU_ScriptEvData *restrict ve) {
 	if (!ve->carriers)
 		return 0;
 	uint32_t duration_ms = 0;
-	for (SAU_RefItem *ref = ve->carriers->refs;
-			ref != NULL; ref = ref->next) {
-		SAU_ScriptOpData *op = ref->data;
+	const SAU_ScriptOpList *carriers = ve->carriers;
+	for (uint32_t i = 0; i < carriers->count; ++i) {
+		const SAU_ScriptOpData *op = carriers->ops[i];
 		if (op->time.v_ms > duration_ms)
 			duration_ms = op->time.v_ms;
 	}
 	return duration_ms;
 }
 
+/*
+ * Add item to min-heap.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool SAU_VoHeap_push(SAU_VoHeap *restrict o,
+		uint64_t key, uint32_t id) {
+	if (!_SAU_VoHeap_add(o, NULL))
+		return false;
+	SAU_VoHeapItem *a = o->a;
+	size_t i = o->count - 1;
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (a[parent].key <= key)
+			break;
+		a[i] = a[parent];
+		i = parent;
+	}
+	a[i] = (SAU_VoHeapItem){key, id};
+	return true;
+}
+
+/*
+ * Remove the first item from non-empty min-heap.
+ */
+static void SAU_VoHeap_pop(SAU_VoHeap *restrict o) {
+	SAU_VoHeapItem *a = o->a;
+	SAU_VoHeapItem last = a[--o->count];
+	size_t count = o->count, i = 0;
+	for (;;) {
+		size_t child = i * 2 + 1;
+		if (child >= count)
+			break;
+		if (child + 1 < count && a[child + 1].key < a[child].key)
+			++child;
+		if (last.key <= a[child].key)
+			break;
+		a[i] = a[child];
+		i = child;
+	}
+	a[i] = last;
+}
+
+/*
+ * Free the operators of a voice being reused, for reuse in it,
+ * unless any of them is used later. They are then kept in use,
+ * along with the operators allocated for it next.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool SAU_VoAllocState_free_ops(SAU_VoAllocState *restrict vas,
+		const SAU_OpAlloc *restrict oa) {
+	SAU_OpIdArr *op_ids = &vas->op_ids;
+	for (size_t i = 0; i < op_ids->count; ++i) {
+		const SAU_OpAllocState *oas = &oa->a[op_ids->a[i]];
+		if (oas->flags & SAU_OAS_LATER_USED)
+			return true;
+	}
+	for (size_t i = 0; i < op_ids->count; ++i) {
+		if (!_SAU_OpIdArr_add(&vas->free_op_ids, &op_ids->a[i]))
+			return false;
+	}
+	op_ids->count = 0; // re-use allocation
+	return true;
+}
+
 /*
  * Get voice ID for event, setting it to \p vo_id.
  *
+ * The operators of a voice are freed when it's reused, its graph
+ * then replaced. (A voice which has expired may still be running
+ * its graph, if its carriers were lengthened after.)
+ *
  * \return true, or false on allocation failure
  */
 static bool SAU_VoAlloc_get_id(SAU_VoAlloc *restrict va,
+		const SAU_OpAlloc *restrict oa,
 		const SAU_ScriptEvData *restrict e, uint32_t *restrict vo_id) {
 	if (e->root_ev != NULL) {
 		*vo_id = e->root_ev->vo_id;
 		return true;
 	}
 	SAU_VoAllocState *vas;
-	for (size_t id = 0; id < va->count; ++id) {
-		vas = &va->a[id];
-		if (!(vas->last_sev->ev_flags & SAU_SDEV_LATER_USED) &&
-				vas->duration_ms == 0) {
-			*vas = (SAU_VoAllocState){0};
+	while (va->free_ids.count > 0) {
+		uint32_t id = va->free_ids.a[0].id;
+		SAU_VoHeap_pop(&va->free_ids);
+		vas = &va->states.a[id];
+		if (vas->flags & SAU_VAS_FREE) {
+			if (!SAU_VoAllocState_free_ops(vas, oa))
+				return false;
+			*vas = (SAU_VoAllocState){
+				.op_ids = vas->op_ids,
+				.free_op_ids = vas->free_op_ids,
+			};
 			*vo_id = id;
 			goto INIT;
 		}
+		/* else stale, voice used again after freed */
 	}
-	*vo_id = va->count;
-	if (!_SAU_VoAlloc_add(va, NULL))
+	*vo_id = va->states.count;
+	if (!_SAU_VoStateArr_add(&va->states, NULL))
 		return false;
-	vas = &va->a[*vo_id];
+	vas = &va->states.a[*vo_id];
 INIT:
 	vas->carriers = &blank_oplist;
 	return true;
@@ -92,65 +185,131 @@ INIT:
 /*
  * Update voices for event and return a voice ID for the event.
  *
- * Use the current voice if any, otherwise reusing an expired voice
- * if possible, or allocating a new if not.
+ * Use the current voice if any, otherwise reusing the expired voice
+ * with the lowest ID if possible, or allocating a new if not.
+ *
+ * A voice expires when its time has passed, unless it's later used.
+ * Each voice updated and not to be used later has an entry added to
+ * a heap of end times, which is consumed as time passes, moving the
+ * voices still expired to a heap of free IDs. Entries for voices no
+ * longer matching are skipped.
  *
  * \return true, or false on allocation failure
  */
 static bool SAU_VoAlloc_update(SAU_VoAlloc *restrict va,
+		const SAU_OpAlloc *restrict oa,
 		SAU_ScriptEvData *restrict e, uint32_t *restrict vo_id) {
-	for (size_t id = 0; id < va->count; ++id) {
-		if (va->a[id].duration_ms < e->wait_ms)
-			va->a[id].duration_ms = 0;
-		else
-			va->a[id].duration_ms -= e->wait_ms;
+	va->time_ms += e->wait_ms;
+	while (va->ends.count > 0 && va->ends.a[0].key <= va->time_ms) {
+		uint32_t id = va->ends.a[0].id;
+		SAU_VoHeap_pop(&va->ends);
+		SAU_VoAllocState *vas = &va->states.a[id];
+		if ((vas->flags & SAU_VAS_FREE) != 0 ||
+				vas->end_ms > va->time_ms ||
+				(vas->flags & SAU_VAS_LATER_USED) != 0)
+			continue;
+		vas->flags |= SAU_VAS_FREE;
+		if (!SAU_VoHeap_push(&va->free_ids, id, id))
+			return false;
 	}
-	if (!SAU_VoAlloc_get_id(va, e, vo_id))
+	if (!SAU_VoAlloc_get_id(va, oa, e, vo_id))
 		return false;
 	e->vo_id = *vo_id;
-	SAU_VoAllocState *vas = &va->a[*vo_id];
-	vas->last_sev = e;
-	vas->flags &= ~SAU_VAS_GRAPH;
+	SAU_VoAllocState *vas = &va->states.a[*vo_id];
+	vas->flags &= ~(SAU_VAS_GRAPH | SAU_VAS_FREE | SAU_VAS_LATER_USED);
+	if (e->ev_flags & SAU_SDEV_LATER_USED)
+		vas->flags |= SAU_VAS_LATER_USED;
 	if (e->ev_flags & SAU_SDEV_NEW_OPGRAPH)
-		vas->duration_ms = voice_duration(e);
+		vas->end_ms = va->time_ms + voice_duration(e);
+	if (!(e->ev_flags & SAU_SDEV_LATER_USED) &&
+			!SAU_VoHeap_push(&va->ends, vas->end_ms, *vo_id))
+		return false;
+	return true;
+}
+
+/*
+ * Move time past the repetitions of the \p count events, placed
+ * \p extra_ms after the first pass, keeping the voices used by
+ * them until the same time after their end time.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool SAU_VoAlloc_repeat(SAU_VoAlloc *restrict va,
+		const SAU_ProgramEvent *restrict events, size_t count,
+		uint64_t extra_ms) {
+	va->time_ms += extra_ms;
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t vo_id = events[i].vo_id;
+		SAU_VoAllocState *vas = &va->states.a[vo_id];
+		if (vas->flags & SAU_VAS_REPEAT)
+			continue;
+		vas->flags |= SAU_VAS_REPEAT;
+		vas->flags &= ~SAU_VAS_FREE;
+		vas->end_ms += extra_ms;
+		if (!(vas->flags & SAU_VAS_LATER_USED) &&
+				!SAU_VoHeap_push(&va->ends, vas->end_ms, vo_id))
+			return false;
+	}
+	for (size_t i = 0; i < count; ++i)
+		va->states.a[events[i].vo_id].flags &= ~SAU_VAS_REPEAT;
 	return true;
 }
 
+/*
+ * Get time left for the voice playing the longest after the
+ * current time.
+ */
+static uint32_t SAU_VoAlloc_remaining_ms(const SAU_VoAlloc *restrict va) {
+	uint64_t end_ms = va->time_ms;
+	for (size_t i = 0; i < va->states.count; ++i) {
+		const SAU_VoAllocState *vas = &va->states.a[i];
+		if (vas->end_ms > end_ms)
+			end_ms = vas->end_ms;
+	}
+	return end_ms - va->time_ms;
+}
+
 /*
  * Clear voice allocator.
  */
 static void SAU_VoAlloc_clear(SAU_VoAlloc *restrict o) {
-	_SAU_VoAlloc_clear(o);
+	for (size_t i = 0; i < o->states.count; ++i) {
+		_SAU_OpIdArr_clear(&o->states.a[i].op_ids);
+		_SAU_OpIdArr_clear(&o->states.a[i].free_op_ids);
+	}
+	_SAU_VoStateArr_clear(&o->states);
+	_SAU_VoHeap_clear(&o->ends);
+	_SAU_VoHeap_clear(&o->free_ids);
 }
 
 /*
  * Get operator ID for event, setting it to \p op_id.
- * (Tracking of expired operators for reuse of their IDs is currently
- * disabled.)
+ *
+ * Use the current operator if any, otherwise reusing one freed
+ * for the voice \p vas if possible, or allocating a new if not.
  *
  * \return true, or false on allocation failure
  */
 static bool SAU_OpAlloc_get_id(SAU_OpAlloc *restrict oa,
-		const SAU_ScriptOpData *restrict od, uint32_t *restrict op_id) {
+		const SAU_ScriptOpData *restrict od,
+		SAU_VoAllocState *restrict vas, uint32_t *restrict op_id) {
 	if (od->prev_use != NULL) {
 		*op_id = od->prev_use->op_id;
 		return true;
 	}
 	SAU_OpAllocState *oas;
-//	for (uint32_t id = 0; id < oa->count; ++id) {
-//		oas = &oa->a[id];
-//		if (!oas->last_sod->next_use
-//			&& oas->duration_ms == 0) {
-//			*oas = (SAU_OpAllocState){0};
-//			*op_id = id;
-//			goto INIT;
-//		}
-//	}
-	*op_id = oa->count;
-	if (!_SAU_OpAlloc_add(oa, NULL))
+	if (vas->free_op_ids.count > 0) {
+		*op_id = vas->free_op_ids.a[--vas->free_op_ids.count];
+		oas = &oa->a[*op_id];
+		*oas = (SAU_OpAllocState){0};
+	} else {
+		*op_id = oa->count;
+		if (!_SAU_OpAlloc_add(oa, NULL))
+			return false;
+		oas = &oa->a[*op_id];
+	}
+	if (!_SAU_OpIdArr_add(&vas->op_ids, op_id))
 		return false;
-	oas = &oa->a[*op_id];
-//INIT:
 	for (size_t i = 0; i < SAU_POP_USES - 1; ++i)
 		oas->mod_lists[i] = &blank_oplist;
 	return true;
@@ -159,31 +318,21 @@ static bool SAU_OpAlloc_get_id(SAU_OpAlloc *restrict oa,
 /*
  * Update operators for event and return an operator ID for the event.
  *
- * Use the current operator if any, otherwise allocating a new one.
- * (Tracking of expired operators for reuse of their IDs is currently
- * disabled.)
- *
  * Only valid to call for single-operator nodes.
  *
  * \return true, or false on allocation failure
  */
 static bool SAU_OpAlloc_update(SAU_OpAlloc *restrict oa,
 		SAU_ScriptOpData *restrict od,
-		uint32_t *restrict op_id) {
-//	SAU_ScriptEvData *e = od->event;
-//	for (size_t id = 0; id < oa->count; ++id) {
-//		if (oa->a[id].duration_ms < e->wait_ms)
-//			oa->a[id].duration_ms = 0;
-//		else
-//			oa->a[id].duration_ms -= e->wait_ms;
-//	}
-	if (!SAU_OpAlloc_get_id(oa, od, op_id))
+		SAU_VoAllocState *restrict vas, uint32_t *restrict op_id) {
+	if (!SAU_OpAlloc_get_id(oa, od, vas, op_id))
 		return false;
 	od->op_id = *op_id;
 	SAU_OpAllocState *oas = &oa->a[*op_id];
 	oas->last_sod = od;
 	oas->flags = 0;
-//	oas->duration_ms = od->time.v_ms;
+	if (od->op_flags & SAU_SDOP_LATER_USED)
+		oas->flags |= SAU_OAS_LATER_USED;
 	return true;
 }
 
@@ -194,31 +343,76 @@ static void SAU_OpAlloc_clear(SAU_OpAlloc *restrict o) {
 	_SAU_OpAlloc_clear(o);
 }
 
-sauArrType(OpDataArr, SAU_ProgramOpData, _)
+sauArrType(ProgramLoopArr, SAU_ProgramLoop, _)
 
+/*
+ * Events and operator data are each placed in one block, allocated
+ * after counting them, filled in event order. Running through the
+ * events then reads memory in order.
+ *
+ * When streaming, each chunk of events is placed in a program of
+ * its own, with allocation state kept between them. Lists still
+ * in use from the previous chunk are copied for each new one.
+ * Chunks are not split within a loop.
+ *
+ * Repeated events are converted once, and a loop added for them.
+ * Allocation then moves on past the repetitions.
+ */
 typedef struct ScriptConv {
-	SAU_PtrArr ev_list;
+	SAU_ProgramEvent *events;
+	size_t ev_count;
+	SAU_ProgramOpData *op_data;
+	size_t op_data_count;
 	SAU_VoAlloc va;
 	SAU_OpAlloc oa;
 	SAU_ProgramEvent *ev;
-	OpDataArr ev_op_data;
 	uint32_t duration_ms;
+	ProgramLoopArr loops;
+	const SAU_ScriptLoop *loop; // current, if events repeated
 	SAU_MemPool *mem;
 } ScriptConv;
 
+/*
+ * Make the data kept for voices and operators usable in the current
+ * chunk, copying lists still referenced from the previous program,
+ * which is discarded after.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ScriptConv_renew(ScriptConv *restrict o) {
+	for (size_t i = 0; i < o->va.states.count; ++i) {
+		SAU_VoAllocState *vas = &o->va.states.a[i];
+		vas->carriers = copy_ProgramOpList(vas->carriers, o->mem);
+		if (!vas->carriers)
+			return false;
+		vas->vo_prev = NULL;
+	}
+	for (size_t i = 0; i < o->oa.count; ++i) {
+		SAU_OpAllocState *oas = &o->oa.a[i];
+		for (size_t j = 0; j < SAU_POP_USES - 1; ++j) {
+			oas->mod_lists[j] = copy_ProgramOpList(
+					oas->mod_lists[j], o->mem);
+			if (!oas->mod_lists[j])
+				return false;
+		}
+		oas->op_prev = NULL;
+	}
+	return true;
+}
+
 /*
  * Convert data for an operator node to program operator data,
  * adding it to the list to be used for the current program event.
  *
  * \return true, or false on allocation failure
  */
-static bool OpDataArr_add_for(OpDataArr *restrict o,
+static bool ScriptConv_add_opdata(ScriptConv *restrict o,
 		const SAU_ScriptOpData *restrict op, uint32_t op_id) {
-	SAU_ProgramOpData *od = _OpDataArr_add(o, NULL);
-	if (!od)
-		return false;
+	SAU_ProgramOpData *od = &o->op_data[o->op_data_count++];
 	od->id = op_id;
 	od->params = op->params;
+	if (!op->prev_use)
+		od->flags |= SAU_PODF_INIT;
 	od->time = op->time;
 	od->silence_ms = op->silence_ms;
 	od->wave = op->wave;
@@ -228,6 +422,13 @@ static bool OpDataArr_add_for(OpDataArr *restrict o,
 	od->amp2 = op->amp2;
 	od->pan = op->pan;
 	od->phase = op->phase;
+	if (op->args != NULL) {
+		od->args = SAU_MemPool_memdup(o->mem, op->args,
+				sizeof(SAU_ProgramArgList) +
+				sizeof(SAU_ProgramArgSlot) * op->args->count);
+		if (!od->args)
+			return false;
+	}
 	return true;
 }
 
@@ -237,7 +438,7 @@ static bool OpDataArr_add_for(OpDataArr *restrict o,
  * \return true, or false on allocation failure
  */
 static inline bool update_oplist(const SAU_ProgramOpList **restrict dstp,
-		const SAU_RefList *restrict src,
+		const SAU_ScriptOpList *restrict src,
 		SAU_MemPool *restrict mem) {
 	const SAU_ProgramOpList *dst = create_ProgramOpList(src, mem);
 	if (!dst)
@@ -257,12 +458,12 @@ static bool ScriptConv_update_modlists(ScriptConv *restrict o,
 		SAU_ProgramOpData *restrict od) {
 	SAU_OpAllocState *oas = &o->oa.a[od->id];
 	const SAU_ScriptOpData *sod = oas->last_sod;
-	const SAU_RefList *sub_lists[SAU_POP_USES - 1] = {0};
-	for (const SAU_RefList *list = sod->mod_lists;
+	const SAU_ScriptOpList *sub_lists[SAU_POP_USES - 1] = {0};
+	for (const SAU_ScriptOpList *list = sod->mod_lists;
 			list != NULL; list = list->next) {
-		sub_lists[list->list_type - 1] = list;
+		sub_lists[list->use_type - 1] = list;
 	}
-	SAU_VoAllocState *vas = &o->va.a[o->ev->vo_id];
+	SAU_VoAllocState *vas = &o->va.states.a[o->ev->vo_id];
 	for (size_t i = 0; i < SAU_POP_USES - 1; ++i) {
 		if (!sub_lists[i]) continue;
 		vas->flags |= SAU_VAS_GRAPH;
@@ -285,18 +486,17 @@ static bool ScriptConv_update_modlists(ScriptConv *restrict o,
 static bool ScriptConv_convert_ops(ScriptConv *restrict o,
 		SAU_NodeRange *restrict sop_list) {
 	SAU_ScriptOpData *sop;
+	SAU_VoAllocState *vas = &o->va.states.a[o->ev->vo_id];
+	size_t first = o->op_data_count;
 	for (sop = sop_list->first; sop != NULL; sop = sop->range_next) {
 		uint32_t op_id;
-		if (!SAU_OpAlloc_update(&o->oa, sop, &op_id)) goto MEM_ERR;
-		if (!OpDataArr_add_for(&o->ev_op_data, sop, op_id))
+		if (!SAU_OpAlloc_update(&o->oa, sop, vas, &op_id))
 			goto MEM_ERR;
+		if (!ScriptConv_add_opdata(o, sop, op_id)) goto MEM_ERR;
 	}
-	if (o->ev_op_data.count > 0) {
-		if (!_OpDataArr_mpmemdup(&o->ev_op_data,
-					(SAU_ProgramOpData**) &o->ev->op_data,
-					o->mem)) goto MEM_ERR;
-		o->ev->op_data_count = o->ev_op_data.count;
-		o->ev_op_data.count = 0; // reuse allocation
+	if (o->op_data_count > first) {
+		o->ev->op_data = &o->op_data[first];
+		o->ev->op_data_count = o->op_data_count - first;
 	}
 	for (size_t i = 0; i < o->ev->op_data_count; ++i) {
 		SAU_ProgramOpData *od = (SAU_ProgramOpData*) &o->ev->op_data[i];
@@ -310,6 +510,43 @@ MEM_ERR:
 	return false;
 }
 
+/*
+ * End the current loop, if any, once the events it repeats
+ * have been converted and its timing is final.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ScriptConv_end_loop(ScriptConv *restrict o) {
+	const SAU_ScriptLoop *sl = o->loop;
+	o->loop = NULL;
+	if (!sl || sl->count < 2)
+		return true;
+	SAU_ProgramLoop *loop = &o->loops.a[o->loops.count - 1];
+	loop->ev_count = o->ev_count - loop->first_ev;
+	loop->count = sl->count;
+	loop->period_ms = sl->period_ms;
+	uint64_t extra_ms = (uint64_t) (sl->count - 1) * sl->period_ms;
+	o->duration_ms += extra_ms;
+	return SAU_VoAlloc_repeat(&o->va, &o->events[loop->first_ev],
+			loop->ev_count, extra_ms);
+}
+
+/*
+ * Begin loop for events repeated, ending any current.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ScriptConv_begin_loop(ScriptConv *restrict o,
+		const SAU_ScriptLoop *restrict sl) {
+	if (!ScriptConv_end_loop(o))
+		return false;
+	o->loop = sl;
+	if (!sl || sl->count < 2)
+		return true;
+	SAU_ProgramLoop loop = {.first_ev = o->ev_count};
+	return _ProgramLoopArr_add(&o->loops, &loop);
+}
+
 /*
  * Convert all voice and operator data for a script event node into a
  * series of output events.
@@ -321,11 +558,11 @@ MEM_ERR:
 static bool ScriptConv_convert_event(ScriptConv *restrict o,
 		SAU_ScriptEvData *restrict e) {
 	uint32_t vo_id;
-	if (!SAU_VoAlloc_update(&o->va, e, &vo_id)) goto MEM_ERR;
-	SAU_VoAllocState *vas = &o->va.a[vo_id];
-	SAU_ProgramEvent *out_ev = SAU_MemPool_alloc(o->mem,
-			sizeof(SAU_ProgramEvent));
-	if (!out_ev || !SAU_PtrArr_add(&o->ev_list, out_ev)) goto MEM_ERR;
+	if (e->loop != o->loop && !ScriptConv_begin_loop(o, e->loop))
+		goto MEM_ERR;
+	if (!SAU_VoAlloc_update(&o->va, &o->oa, e, &vo_id)) goto MEM_ERR;
+	SAU_VoAllocState *vas = &o->va.states.a[vo_id];
+	SAU_ProgramEvent *out_ev = &o->events[o->ev_count++];
 	out_ev->wait_ms = e->wait_ms;
 	out_ev->vo_id = vo_id;
 	o->ev = out_ev;
@@ -359,15 +596,15 @@ MEM_ERR:
 static bool ScriptConv_check_validity(ScriptConv *restrict o,
 		SAU_Script *restrict script) {
 	bool error = false;
-	if (o->va.count > SAU_PVO_MAX_ID) {
+	if (o->va.states.count > SAU_PVO_MAX_ID) {
 		fprintf(stderr,
-"%s: error: number of voices used cannot exceed %d\n",
+"%s: error: number of voices used cannot exceed %u\n",
 			script->name, SAU_PVO_MAX_ID);
 		error = true;
 	}
 	if (o->oa.count > SAU_POP_MAX_ID) {
 		fprintf(stderr,
-"%s: error: number of operators used cannot exceed %d\n",
+"%s: error: number of operators used cannot exceed %u\n",
 			script->name, SAU_POP_MAX_ID);
 		error = true;
 	}
@@ -378,9 +615,23 @@ static SAU_Program *ScriptConv_create_program(ScriptConv *restrict o,
 		SAU_Script *restrict script) {
 	SAU_Program *prg = SAU_MemPool_alloc(o->mem, sizeof(SAU_Program));
 	if (!prg) goto MEM_ERR;
-	if (!SAU_PtrArr_mpmemdup(&o->ev_list,
-				(void***) &prg->events, o->mem)) goto MEM_ERR;
-	prg->ev_count = o->ev_list.count;
+	if (o->ev_count > 0) {
+		const SAU_ProgramEvent **events = SAU_MemPool_alloc(o->mem,
+				o->ev_count * sizeof(SAU_ProgramEvent*));
+		if (!events) goto MEM_ERR;
+		for (size_t i = 0; i < o->ev_count; ++i)
+			events[i] = &o->events[i];
+		prg->events = events;
+	}
+	prg->ev_count = o->ev_count;
+	if (o->loops.count > 0) {
+		SAU_ProgramLoop *loops;
+		if (!_ProgramLoopArr_mpmemdup(&o->loops, &loops, o->mem))
+			goto MEM_ERR;
+		prg->loops = loops;
+		prg->loop_count = o->loops.count;
+		o->loops.count = 0;
+	}
 	if (!(script->sopt.set & SAU_SOPT_AMPMULT)) {
 		/*
 		 * Enable amplitude scaling (division) by voice count,
@@ -388,9 +639,23 @@ static SAU_Program *ScriptConv_create_program(ScriptConv *restrict o,
 		 */
 		prg->mode |= SAU_PMODE_AMP_DIV_VOICES;
 	}
-	prg->vo_count = o->va.count;
+	prg->vo_count = o->va.states.count;
 	prg->op_count = o->oa.count;
 	prg->duration_ms = o->duration_ms;
+	if (script->arg_count > 0) {
+		SAU_ProgramArg *args = SAU_MemPool_alloc(o->mem,
+				sizeof(SAU_ProgramArg) * script->arg_count);
+		if (!args) goto MEM_ERR;
+		for (uint32_t i = 0; i < script->arg_count; ++i) {
+			const char *name = script->args[i].name;
+			args[i].name = SAU_MemPool_memdup(o->mem,
+					name, strlen(name) + 1);
+			if (!args[i].name) goto MEM_ERR;
+			args[i].def_val = script->args[i].def_val;
+		}
+		prg->args = args;
+		prg->arg_count = script->arg_count;
+	}
 	prg->name = script->name;
 	prg->mem = o->mem;
 	o->mem = NULL; // pass on to program
@@ -400,25 +665,57 @@ MEM_ERR:
 }
 
 /*
- * Build program, allocating events, voices, and operators.
+ * Build program, allocating events, voices, and operators,
+ * for up to \p max_ev events from \p *evp, updated to the
+ * event after the last converted.
+ *
+ * The program only includes time left after its last event
+ * when all events have been converted.
+ *
+ * \return instance or NULL on error
  */
 static SAU_Program *ScriptConv_convert(ScriptConv *restrict o,
-		SAU_Script *restrict script) {
+		SAU_Script *restrict script,
+		SAU_ScriptEvData **restrict evp, size_t max_ev) {
 	SAU_Program *prg = NULL;
+	SAU_ScriptEvData *e;
+	o->events = NULL;
+	o->op_data = NULL;
+	o->ev_count = o->op_data_count = 0;
+	o->loops.count = 0;
+	o->duration_ms = 0;
 	o->mem = SAU_create_MemPool(0);
-	if (!o->mem) goto MEM_ERR;
+	if (!o->mem || !ScriptConv_renew(o)) goto MEM_ERR;
+	size_t ev_count = 0, op_data_count = 0;
+	const SAU_ScriptLoop *loop = NULL;
+	for (e = *evp; e != NULL; e = e->next) {
+		if (ev_count >= max_ev && (!loop || e->loop != loop))
+			break; /* end chunk, unless within loop */
+		loop = e->loop;
+		++ev_count;
+		for (SAU_ScriptOpData *sop = e->op_all.first; sop != NULL;
+				sop = sop->range_next)
+			++op_data_count;
+	}
+	if (ev_count > 0) {
+		o->events = SAU_MemPool_alloc(o->mem,
+				ev_count * sizeof(SAU_ProgramEvent));
+		if (!o->events) goto MEM_ERR;
+	}
+	if (op_data_count > 0) {
+		o->op_data = SAU_MemPool_alloc(o->mem,
+				op_data_count * sizeof(SAU_ProgramOpData));
+		if (!o->op_data) goto MEM_ERR;
+	}
 
-	uint32_t remaining_ms = 0;
-	for (SAU_ScriptEvData *e = script->events; e; e = e->next) {
+	for (e = *evp; e != NULL && o->ev_count < ev_count; e = e->next) {
 		if (!ScriptConv_convert_event(o, e)) goto MEM_ERR;
 		o->duration_ms += e->wait_ms;
 	}
-	for (size_t i = 0; i < o->va.count; ++i) {
-		SAU_VoAllocState *vas = &o->va.a[i];
-		if (vas->duration_ms > remaining_ms)
-			remaining_ms = vas->duration_ms;
-	}
-	o->duration_ms += remaining_ms;
+	*evp = e;
+	if (!ScriptConv_end_loop(o)) goto MEM_ERR;
+	if (!e)
+		o->duration_ms += SAU_VoAlloc_remaining_ms(&o->va);
 	if (ScriptConv_check_validity(o, script)) {
 		prg = ScriptConv_create_program(o, script);
 		if (!prg) goto MEM_ERR;
@@ -427,14 +724,20 @@ static SAU_Program *ScriptConv_convert(ScriptConv *restrict o,
 	MEM_ERR: {
 		SAU_error("scriptconv", "memory allocation failure");
 	}
-	SAU_OpAlloc_clear(&o->oa);
-	SAU_VoAlloc_clear(&o->va);
-	_OpDataArr_clear(&o->ev_op_data);
-	SAU_PtrArr_clear(&o->ev_list);
 	SAU_destroy_MemPool(o->mem);
+	o->mem = NULL;
 	return prg;
 }
 
+/*
+ * Clear allocation state.
+ */
+static void ScriptConv_clear(ScriptConv *restrict o) {
+	_ProgramLoopArr_clear(&o->loops);
+	SAU_OpAlloc_clear(&o->oa);
+	SAU_VoAlloc_clear(&o->va);
+}
+
 /**
  * Create internal program for the given script data.
  *
@@ -442,16 +745,381 @@ static SAU_Program *ScriptConv_convert(ScriptConv *restrict o,
  */
 SAU_Program* SAU_build_Program(SAU_Script *restrict sd) {
 	ScriptConv sc = (ScriptConv){0};
-	SAU_Program *o = ScriptConv_convert(&sc, sd);
+	SAU_ScriptEvData *e = sd->events;
+	SAU_Program *o = ScriptConv_convert(&sc, sd, &e, SIZE_MAX);
+	ScriptConv_clear(&sc);
 	return o;
 }
 
+sauArrType(ProgramEventArr, SAU_ProgramEvent, _)
+
+/*
+ * Pipelined program build state. Events are gathered in
+ * an array, moved into the program at the end.
+ */
+typedef struct ScriptPipe {
+	ScriptConv sc;
+	ProgramEventArr events;
+} ScriptPipe;
+
+/*
+ * Convert event passed on while the script is loaded,
+ * allocating operator data for it alone.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ScriptPipe_convert_event(void *restrict data,
+		SAU_ScriptEvData *restrict e,
+		const SAU_ScriptOptions *restrict sopt sauMaybeUnused) {
+	ScriptPipe *sp = data;
+	ScriptConv *o = &sp->sc;
+	size_t op_data_count = 0;
+	for (SAU_ScriptOpData *sop = e->op_all.first; sop != NULL;
+			sop = sop->range_next)
+		++op_data_count;
+	if (!_ProgramEventArr_add(&sp->events, NULL)) goto MEM_ERR;
+	o->events = sp->events.a;
+	o->op_data = NULL;
+	o->op_data_count = 0;
+	if (op_data_count > 0) {
+		o->op_data = SAU_MemPool_alloc(o->mem,
+				op_data_count * sizeof(SAU_ProgramOpData));
+		if (!o->op_data) goto MEM_ERR;
+	}
+	if (!ScriptConv_convert_event(o, e)) goto MEM_ERR;
+	o->duration_ms += e->wait_ms;
+	return true;
+MEM_ERR:
+	SAU_error("scriptconv", "memory allocation failure");
+	return false;
+}
+
 /**
- * Destroy instance.
+ * Create internal program for the given script file, pipelining
+ * the stages of building. Each event is converted as soon as it's
+ * parsed and final, and intermediate data is freed behind it, for
+ * lower peak memory use with large scripts.
+ *
+ * \return instance or NULL on error
+ */
+SAU_Program* SAU_build_piped_Program(const char *restrict script_arg,
+		bool is_path, const char *restrict name) {
+	ScriptPipe sp = (ScriptPipe){0};
+	ScriptConv *o = &sp.sc;
+	SAU_Script *sd = NULL;
+	SAU_Program *prg = NULL;
+	o->mem = SAU_create_MemPool(0);
+	if (!o->mem) goto MEM_ERR;
+	sd = SAU_pipe_Script(script_arg, is_path, name,
+			ScriptPipe_convert_event, &sp);
+	if (!sd) goto DONE;
+	if (!ScriptConv_end_loop(o)) goto MEM_ERR;
+	o->duration_ms += SAU_VoAlloc_remaining_ms(&o->va);
+	if (!_ProgramEventArr_mpmemdup(&sp.events, &o->events, o->mem))
+		goto MEM_ERR;
+	if (ScriptConv_check_validity(o, sd)) {
+		prg = ScriptConv_create_program(o, sd);
+		if (!prg) goto MEM_ERR;
+	}
+	if (false)
+	MEM_ERR: {
+		SAU_error("scriptconv", "memory allocation failure");
+	}
+DONE:
+	SAU_discard_Script(sd);
+	SAU_destroy_MemPool(o->mem);
+	_ProgramEventArr_clear(&sp.events);
+	ScriptConv_clear(o);
+	return prg;
+}
+
+/*
+ * Program stream state.
+ *
+ * The script is loaded and converted in a thread of its own,
+ * pipelined, each chunk of events made into a program handed
+ * over for the next call to SAU_ProgramStream_next(). Until
+ * it's taken, the thread waits before going on, so that only
+ * the chunk in use, the one handed over, and the one being
+ * converted are kept at once.
+ */
+struct SAU_ProgramStream {
+	ScriptPipe sp;
+	const char *script_arg;
+	const char *name;
+	bool is_path;
+	size_t chunk_len;
+	SAU_ScriptOptions sopt; // as of the last event converted
+	bool checked; // options checked at the first event
+	/* shared by threads, under lock */
+	SAU_Program *next_prg; // handed over, not yet taken
+	bool done; // no more programs to hand over
+	bool stop; // closing, end the loading
+	/* used by caller of SAU_ProgramStream_next() */
+	SAU_Program *prg;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t thread;
+};
+
+/*
+ * Begin converting a chunk of events, with new memory
+ * for the program. Allocation state still used is copied
+ * from the previous program's memory, kept until after.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool ProgramStream_begin_chunk(SAU_ProgramStream *restrict o) {
+	ScriptConv *sc = &o->sp.sc;
+	o->sp.events.count = 0;
+	sc->events = NULL;
+	sc->ev_count = 0;
+	sc->loops.count = 0;
+	sc->duration_ms = 0;
+	sc->mem = SAU_create_MemPool(0);
+	return sc->mem != NULL && ScriptConv_renew(sc);
+}
+
+/*
+ * Make a program of the chunk of events converted, and hand it
+ * over, waiting until the one handed over before has been taken.
+ * If \p last, the time left after the last event is included.
+ *
+ * \return true, or false on error or if stopped
+ */
+static bool ProgramStream_end_chunk(SAU_ProgramStream *restrict o,
+		bool last) {
+	ScriptConv *sc = &o->sp.sc;
+	SAU_Script sd = {.name = o->name, .sopt = o->sopt};
+	SAU_Program *prg = NULL;
+	bool ok = false;
+	if (!ScriptConv_end_loop(sc)) goto MEM_ERR;
+	if (last)
+		sc->duration_ms += SAU_VoAlloc_remaining_ms(&sc->va);
+	if (!_ProgramEventArr_mpmemdup(&o->sp.events, &sc->events, sc->mem))
+		goto MEM_ERR;
+	if (!ScriptConv_check_validity(sc, &sd))
+		goto DONE;
+	prg = ScriptConv_create_program(sc, &sd);
+	if (!prg) goto MEM_ERR;
+	pthread_mutex_lock(&o->lock);
+	while (o->next_prg != NULL && !o->stop)
+		pthread_cond_wait(&o->cond, &o->lock);
+	if (!o->stop) {
+		o->next_prg = prg;
+		prg = NULL;
+		ok = true;
+		pthread_cond_signal(&o->cond);
+	}
+	pthread_mutex_unlock(&o->lock);
+	if (false)
+	MEM_ERR: {
+		SAU_error("scriptconv", "memory allocation failure");
+	}
+DONE:
+	SAU_discard_Program(prg); // unless handed over
+	SAU_destroy_MemPool(sc->mem); // unless passed on to program
+	sc->mem = NULL;
+	return ok;
+}
+
+/*
+ * Convert event passed on while the script is loaded, ending
+ * the chunk of events before it when full, unless both are
+ * repeated in the same loop.
+ *
+ * \return true, or false on error or if stopped
+ */
+static bool ProgramStream_convert_event(void *restrict data,
+		SAU_ScriptEvData *restrict e,
+		const SAU_ScriptOptions *restrict sopt) {
+	SAU_ProgramStream *o = data;
+	ScriptConv *sc = &o->sp.sc;
+	o->sopt = *sopt;
+	if (!o->checked) {
+		o->checked = true;
+		if (!(sopt->set & SAU_SOPT_AMPMULT)) {
+			fprintf(stderr,
+"%s: error: streaming needs amplitude multiplier set before first event\n",
+				o->name);
+			return false;
+		}
+	}
+	if (o->sp.events.count >= o->chunk_len &&
+			(!sc->loop || e->loop != sc->loop)) {
+		if (!ProgramStream_end_chunk(o, false) ||
+				!ProgramStream_begin_chunk(o))
+			return false;
+	}
+	return ScriptPipe_convert_event(&o->sp, e, sopt);
+}
+
+/*
+ * Load and convert the script, handing over programs.
+ */
+static void *run_ProgramStream(void *restrict data) {
+	SAU_ProgramStream *o = data;
+	SAU_Script *sd = NULL;
+	if (!ProgramStream_begin_chunk(o)) {
+		SAU_error("scriptconv", "memory allocation failure");
+	} else {
+		sd = SAU_pipe_Script(o->script_arg, o->is_path, o->name,
+				ProgramStream_convert_event, o);
+	}
+	if (sd != NULL) {
+		o->sopt = sd->sopt;
+		ProgramStream_end_chunk(o, true);
+		SAU_discard_Script(sd);
+	}
+	SAU_destroy_MemPool(o->sp.sc.mem); // if left by error
+	o->sp.sc.mem = NULL;
+	pthread_mutex_lock(&o->lock);
+	o->done = true;
+	pthread_cond_signal(&o->cond);
+	pthread_mutex_unlock(&o->lock);
+	return NULL;
+}
+
+/**
+ * Open stream of programs for the given script file or string,
+ * each converted from the next \p chunk_len events, or fewer at
+ * the end, or more to not split a repetition. Loading is done in
+ * a thread, pipelined like SAU_build_piped_Program(), and kept
+ * only up to two programs ahead of those taken; the script is not
+ * held in full, nor the program. \p script_arg must be kept until
+ * the stream is closed. If not a path, it's a string named \p name,
+ * or "<string>" if NULL.
+ *
+ * The programs are to be run in order, in one interpreter,
+ * as continuations of the first. Only the current program
+ * is kept, and discarded when the next is taken.
+ *
+ * As the number of voices isn't known until the end, amplitude
+ * can't be scaled by it as for a program built at once. The script
+ * must set the amplitude multiplier before its first event instead,
+ * or the stream ends before it.
+ *
+ * \return instance or NULL on error
+ */
+SAU_ProgramStream *SAU_open_ProgramStream(const char *restrict script_arg,
+		bool is_path, const char *restrict name, size_t chunk_len) {
+	SAU_ProgramStream *o = calloc(1, sizeof(SAU_ProgramStream));
+	if (!o)
+		return NULL;
+	o->script_arg = script_arg;
+	o->is_path = is_path;
+	o->name = is_path ? script_arg : (name ? name : "<string>");
+	o->chunk_len = (chunk_len > 0) ? chunk_len : 1;
+	pthread_mutex_init(&o->lock, NULL);
+	pthread_cond_init(&o->cond, NULL);
+	if (pthread_create(&o->thread, NULL, run_ProgramStream, o) != 0) {
+		SAU_error("scriptconv", "couldn't create loading thread");
+		pthread_cond_destroy(&o->cond);
+		pthread_mutex_destroy(&o->lock);
+		free(o);
+		return NULL;
+	}
+	return o;
+}
+
+/**
+ * Close stream, stopping loading, and discarding the programs.
+ */
+void SAU_close_ProgramStream(SAU_ProgramStream *restrict o) {
+	if (!o)
+		return;
+	pthread_mutex_lock(&o->lock);
+	o->stop = true;
+	pthread_cond_signal(&o->cond);
+	pthread_mutex_unlock(&o->lock);
+	pthread_join(o->thread, NULL);
+	SAU_discard_Program(o->next_prg);
+	SAU_discard_Program(o->prg);
+	_ProgramEventArr_clear(&o->sp.events);
+	ScriptConv_clear(&o->sp.sc);
+	pthread_cond_destroy(&o->cond);
+	pthread_mutex_destroy(&o->lock);
+	free(o);
+}
+
+/**
+ * Take the next program, waiting for it to be converted, and
+ * discard the current. The first includes at least the first
+ * event, if any; later programs are only returned while events
+ * remain.
+ *
+ * The voice and operator counts of each program include those
+ * of the programs before it.
+ *
+ * \return program, or NULL at the end or on error
+ */
+const SAU_Program *SAU_ProgramStream_next(SAU_ProgramStream *restrict o) {
+	pthread_mutex_lock(&o->lock);
+	while (!o->next_prg && !o->done)
+		pthread_cond_wait(&o->cond, &o->lock);
+	SAU_Program *prg = o->next_prg;
+	o->next_prg = NULL;
+	pthread_cond_signal(&o->cond);
+	pthread_mutex_unlock(&o->lock);
+	SAU_discard_Program(o->prg);
+	o->prg = prg;
+	return prg;
+}
+
+/**
+ * Look up script argument of program by \p name.
+ *
+ * \return argument ID, or SAU_PARG_NO_ID if not found
+ */
+uint32_t SAU_Program_find_arg(const SAU_Program *restrict o,
+		const char *restrict name) {
+	for (uint32_t i = 0; i < o->arg_count; ++i) {
+		if (!strcmp(o->args[i].name, name))
+			return i;
+	}
+	return SAU_PARG_NO_ID;
+}
+
+/**
+ * Set the parameter values of \p od which use script arguments,
+ * from \p args, holding a value for each argument of the program.
+ */
+void SAU_ProgramOpData_bind_args(SAU_ProgramOpData *restrict od,
+		const float *restrict args) {
+	for (uint32_t i = 0; i < od->args->count; ++i) {
+		const SAU_ProgramArgSlot *slot = &od->args->slots[i];
+		float val = args[slot->arg_id] * slot->mul;
+		switch (slot->target) {
+		case SAU_PARG_FREQ: od->freq.v0 = val; break;
+		case SAU_PARG_FREQ_GOAL: od->freq.vt = val; break;
+		case SAU_PARG_FREQ2: od->freq2.v0 = val; break;
+		case SAU_PARG_FREQ2_GOAL: od->freq2.vt = val; break;
+		case SAU_PARG_AMP: od->amp.v0 = val; break;
+		case SAU_PARG_AMP_GOAL: od->amp.vt = val; break;
+		case SAU_PARG_AMP2: od->amp2.v0 = val; break;
+		case SAU_PARG_AMP2_GOAL: od->amp2.vt = val; break;
+		case SAU_PARG_PAN: od->pan.v0 = val; break;
+		case SAU_PARG_PAN_GOAL: od->pan.vt = val; break;
+		case SAU_PARG_PHASE:
+			val = fmod(val, 1.f);
+			if (val < 0.f) val += 1.f;
+			od->phase = val;
+			break;
+		}
+	}
+}
+
+/**
+ * Destroy instance. Handles both built programs and those
+ * loaded using SAU_load_ProgramFile().
  */
 void SAU_discard_Program(SAU_Program *restrict o) {
 	if (!o)
 		return;
+	if (!o->mem) {
+		SAU_unload_ProgramFile(o);
+		return;
+	}
 	SAU_destroy_MemPool(o->mem);
 }
 
@@ -513,14 +1181,32 @@ void SAU_Program_print_info(const SAU_Program *restrict o,
 	fprintf(stdout,
 		"%s%s%s\n", name_prefix, o->name, name_suffix);
 	fprintf(stdout,
-		"\tDuration: \t%d ms\n"
+		"\tDuration: \t%u ms\n"
 		"\tEvents:   \t%zd\n"
-		"\tVoices:   \t%hd\n"
+		"\tVoices:   \t%u\n"
 		"\tOperators:\t%d\n",
 		o->duration_ms,
 		o->ev_count,
 		o->vo_count,
 		o->op_count);
+	if (o->loop_count > 0) {
+		fputs("\tLoops:   ", stdout);
+		for (size_t i = 0; i < o->loop_count; ++i) {
+			const SAU_ProgramLoop *loop = &o->loops[i];
+			fprintf(stdout, "\t%zd-%zd x%u",
+					loop->first_ev,
+					loop->first_ev + loop->ev_count - 1,
+					loop->count);
+		}
+		putc('\n', stdout);
+	}
+	if (o->arg_count > 0) {
+		fputs("\tArguments:", stdout);
+		for (uint32_t i = 0; i < o->arg_count; ++i)
+			fprintf(stdout, "\t$%s=%.6g",
+					o->args[i].name, o->args[i].def_val);
+		putc('\n', stdout);
+	}
 }
 
 /**
@@ -531,7 +1217,7 @@ void SAU_ProgramEvent_print_voice(const SAU_ProgramEvent *restrict ev) {
 		if (!vd)
 			return;
 		fprintf(stdout,
-			"\n\tvo %d", ev->vo_id);
+			"\n\tvo %u", ev->vo_id);
 }
 
 /**
@@ -17,42 +17,75 @@
 #include "../arrtype.h"
 #include "../mempool.h"
 
+/** Operator ID array type. */
+sauArrType(SAU_OpIdArr, uint32_t, _)
+
 /**
  * Voice allocation state flags.
  */
 enum {
 	SAU_VAS_GRAPH = 1<<0,
+	SAU_VAS_FREE = 1<<1,
+	SAU_VAS_LATER_USED = 1<<2, // last event used later
+	SAU_VAS_REPEAT = 1<<3, // temporarily marked when repeated
 };
 
 /**
  * Per-voice state used during program data allocation.
+ *
+ * Operators allocated for a voice are kept with it, and freed for
+ * reuse only within it, so that no operator is ever placed in two
+ * voices.
  */
 typedef struct SAU_VoAllocState {
-	SAU_ScriptEvData *last_sev;
 	const SAU_ProgramOpList *carriers;
 	SAU_ProgramVoData *vo_prev;
 	uint32_t flags;
-	uint32_t duration_ms;
+	uint64_t end_ms;
+	SAU_OpIdArr op_ids; /* operators in use for voice */
+	SAU_OpIdArr free_op_ids; /* operators free for reuse */
 } SAU_VoAllocState;
 
-sauArrType(SAU_VoAlloc, SAU_VoAllocState, _)
+sauArrType(SAU_VoStateArr, SAU_VoAllocState, _)
+
+/**
+ * Min-heap item for voice allocation.
+ */
+typedef struct SAU_VoHeapItem {
+	uint64_t key;
+	uint32_t id;
+} SAU_VoHeapItem;
+
+sauArrType(SAU_VoHeap, SAU_VoHeapItem, _)
+
+/**
+ * Voice allocation state, with voices pending release kept in
+ * a heap by end time, and free voices in a heap by ID.
+ */
+typedef struct SAU_VoAlloc {
+	SAU_VoStateArr states;
+	SAU_VoHeap ends;
+	SAU_VoHeap free_ids;
+	uint64_t time_ms;
+} SAU_VoAlloc;
 
 /**
  * Operator allocation state flags.
  */
-//enum {
-//	SAU_OAS_VISITED = 1<<0,
-//};
+enum {
+	SAU_OAS_LATER_USED = 1<<0, // last node used later
+};
 
 /**
  * Per-operator state used during program data allocation.
+ *
+ * The last script data node is only valid for the current event.
  */
 typedef struct SAU_OpAllocState {
 	SAU_ScriptOpData *last_sod;
 	const SAU_ProgramOpList *mod_lists[SAU_POP_USES - 1];
 	SAU_ProgramOpData *op_prev;
 	uint32_t flags;
-	//uint32_t duration_ms;
 } SAU_OpAllocState;
 
 sauArrType(SAU_OpAlloc, SAU_OpAllocState, _)
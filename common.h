@@ -83,9 +83,12 @@ int SAU_getopt(int argc, char *const*restrict argv,
 /* Debug-friendly memory handling? (Slower.) */
 //#define SAU_MEM_DEBUG 1
 
-/* Print symbol table statistics for testing? */
+/* Print symbol table statistics for testing? Also counts lookups. */
 //#define SAU_SYMTAB_STATS 0
 
+/* Count memory pool allocations for testing? */
+//#define SAU_MEMPOOL_STATS 0
+
 /* Make test lexer quiet enough to time it. */
 #define SAU_LEXER_QUIET 1
 
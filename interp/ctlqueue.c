@@ -0,0 +1,113 @@
+/* saugns: Interpreter control command queue module.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "ctlqueue.h"
+#include <stdlib.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+# define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+# define LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+# define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+# error "atomic load and store builtins needed for control queue"
+#endif
+
+#define CACHE_LINE 64
+
+/*
+ * The read and write positions run freely, wrapping around,
+ * and are masked for the index. Each is stored only by one
+ * side, kept apart to not share a cache line.
+ */
+struct SAU_CtlQueue {
+	uint32_t read_pos; /* stored by consumer */
+	char pad1[CACHE_LINE - sizeof(uint32_t)];
+	uint32_t write_pos; /* stored by producer */
+	char pad2[CACHE_LINE - sizeof(uint32_t)];
+	uint32_t mask;
+	SAU_CtlCmd *cmds;
+};
+
+/**
+ * Create instance with room for at least \p size commands,
+ * rounded up to a power of two.
+ *
+ * \return instance or NULL on error
+ */
+SAU_CtlQueue *SAU_create_CtlQueue(uint32_t size) {
+	uint32_t len = 1;
+	if (size > (UINT32_C(1) << 31))
+		return NULL;
+	while (len < size) len <<= 1;
+	SAU_CtlQueue *o = calloc(1, sizeof(SAU_CtlQueue));
+	if (!o)
+		return NULL;
+	o->cmds = calloc(len, sizeof(SAU_CtlCmd));
+	if (!o->cmds) {
+		free(o);
+		return NULL;
+	}
+	o->mask = len - 1;
+	return o;
+}
+
+/**
+ * Destroy instance. It must no longer be used by an interpreter.
+ */
+void SAU_destroy_CtlQueue(SAU_CtlQueue *restrict o) {
+	if (!o)
+		return;
+	free(o->cmds);
+	free(o);
+}
+
+/**
+ * Add copy of command to the queue. To be called only from
+ * the producer thread.
+ *
+ * \return true, or false if the queue is full
+ */
+bool SAU_CtlQueue_push(SAU_CtlQueue *restrict o,
+		const SAU_CtlCmd *restrict cmd) {
+	uint32_t write_pos = LOAD_RELAXED(&o->write_pos);
+	uint32_t read_pos = LOAD_ACQUIRE(&o->read_pos);
+	if (write_pos - read_pos > o->mask)
+		return false;
+	o->cmds[write_pos & o->mask] = *cmd;
+	STORE_RELEASE(&o->write_pos, write_pos + 1);
+	return true;
+}
+
+/**
+ * Get the first command in the queue, without removing it.
+ * To be called only from the consumer thread.
+ *
+ * \return command, or NULL if the queue is empty
+ */
+const SAU_CtlCmd *SAU_CtlQueue_peek(SAU_CtlQueue *restrict o) {
+	uint32_t read_pos = LOAD_RELAXED(&o->read_pos);
+	uint32_t write_pos = LOAD_ACQUIRE(&o->write_pos);
+	if (read_pos == write_pos)
+		return NULL;
+	return &o->cmds[read_pos & o->mask];
+}
+
+/**
+ * Remove the first command in the queue, after use of
+ * the pointer from SAU_CtlQueue_peek(). To be called
+ * only from the consumer thread, for a non-empty queue.
+ */
+void SAU_CtlQueue_pop(SAU_CtlQueue *restrict o) {
+	uint32_t read_pos = LOAD_RELAXED(&o->read_pos);
+	STORE_RELEASE(&o->read_pos, read_pos + 1);
+}
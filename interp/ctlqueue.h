@@ -0,0 +1,71 @@
+/* saugns: Interpreter control command queue module.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "../ramp.h"
+
+/**
+ * Control command types.
+ */
+enum {
+	SAU_CTL_OP_AMP = 0,
+	SAU_CTL_OP_AMP2,
+	SAU_CTL_OP_FREQ,
+	SAU_CTL_OP_FREQ2,
+	SAU_CTL_OP_PHASE,
+	SAU_CTL_OP_TIME,
+	SAU_CTL_VO_PAN,
+	SAU_CTL_VO_TRIGGER,
+	SAU_CTL_TYPES
+};
+
+/**
+ * Control command, changing an operator or voice parameter
+ * at a given sample time of an interpreter.
+ *
+ * Operator ramps and voice pan use \a ramp. Phase uses
+ * \a value (0.0 = 0 deg., 1.0 = 360 deg.), and time uses
+ * \a time_ms for the operator, counted from when applied.
+ * A trigger (re)starts the voice, as for a program event
+ * for it, with duration from the times of its carriers.
+ *
+ * Operator IDs are reused within a voice, for operators added
+ * after the voice is reused, so a command applies to whichever
+ * operator has the ID at its time.
+ */
+typedef struct SAU_CtlCmd {
+	uint64_t time; /* in samples; 0 or passed means when next run */
+	uint32_t id;   /* operator or voice ID */
+	uint8_t type;
+	uint32_t time_ms;
+	float value;
+	SAU_Ramp ramp;
+} SAU_CtlCmd;
+
+/**
+ * Bounded single-producer, single-consumer command queue.
+ *
+ * Commands are pushed by one control thread and consumed by
+ * the interpreter in the thread running it, without locks or
+ * allocation on either side. Commands are applied in order,
+ * so times should not decrease.
+ */
+typedef struct SAU_CtlQueue SAU_CtlQueue;
+
+SAU_CtlQueue *SAU_create_CtlQueue(uint32_t size) sauMalloclike;
+void SAU_destroy_CtlQueue(SAU_CtlQueue *restrict o);
+
+bool SAU_CtlQueue_push(SAU_CtlQueue *restrict o,
+		const SAU_CtlCmd *restrict cmd);
+const SAU_CtlCmd *SAU_CtlQueue_peek(SAU_CtlQueue *restrict o);
+void SAU_CtlQueue_pop(SAU_CtlQueue *restrict o);
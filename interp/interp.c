@@ -14,11 +14,22 @@
 #include "interp.h"
 #include "prealloc.h"
 #include "mixer.h"
+#include "ctlqueue.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define BUF_LEN SAU_MIX_BUFLEN
 typedef float Buf[BUF_LEN];
 
+/*
+ * Event gathered for a block, to be handled by its voice.
+ */
+typedef struct BlockEvent {
+	uint32_t pos; /* within block */
+	uint32_t next; /* 1 + index of next for voice, or 0 */
+} BlockEvent;
+
 struct SAU_Interp {
 	const SAU_Program *prg;
 	uint32_t srate;
@@ -26,35 +37,107 @@ struct SAU_Interp {
 	Buf *bufs;
 	SAU_Mixer *mixer;
 	size_t event, ev_count;
-	EventNode **events;
+	EventNode *events;
 	uint32_t event_pos;
-	uint16_t voice, vo_count;
+	LoopNode *loops;
+	size_t loop, loop_count;
+	uint32_t repeats; /* runs left after the current of loop */
+	BlockEvent *block_evs;
+	uint32_t voice, vo_end, vo_count;
+	uint32_t op_count;
 	VoiceNode *voices;
 	OperatorNode *operators;
+	OperatorParams *op_params;
+	uint64_t time;
+	SAU_CtlQueue *ctl;
+	SAU_ProgramSource_f source;
+	void *source_data;
+	uint32_t vo_alloc, op_alloc;
 	SAU_MemPool *mem;
+	SAU_MemPool *ev_mem; /* for program continued with */
 };
 
+/*
+ * Copy of the state of an instance which changes when run.
+ */
+struct SAU_InterpState {
+	const SAU_Program *prg;
+	uint32_t srate;
+	size_t event;
+	uint32_t event_pos;
+	size_t loop;
+	uint32_t repeats;
+	uint32_t voice, vo_end, vo_count;
+	uint32_t op_count;
+	float mix_scale;
+	VoiceNode *voices;
+	OperatorNode *operators;
+	OperatorParams *op_params;
+	uint64_t time;
+	SAU_MemPool *mem;
+};
+
+/*
+ * Bind script argument values \p args to the operator data
+ * of events, using copies of the data arrays which use them.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool bind_args(SAU_Interp *restrict o, const float *restrict args) {
+	for (size_t i = 0; i < o->ev_count; ++i) {
+		EventNode *e = &o->events[i];
+		size_t j = 0;
+		while (j < e->op_data_count && !e->op_data[j].args)
+			++j;
+		if (j == e->op_data_count)
+			continue;
+		SAU_ProgramOpData *op_data = SAU_MemPool_memdup(o->mem,
+				e->op_data,
+				sizeof(SAU_ProgramOpData) * e->op_data_count);
+		if (!op_data)
+			return false;
+		for (; j < e->op_data_count; ++j) {
+			if (op_data[j].args != NULL)
+				SAU_ProgramOpData_bind_args(&op_data[j], args);
+		}
+		e->op_data = op_data;
+	}
+	return true;
+}
+
 static bool init_for_program(SAU_Interp *restrict o,
-		const SAU_Program *restrict prg, uint32_t srate) {
+		const SAU_Program *restrict prg, uint32_t srate,
+		const float *restrict args) {
 	SAU_PreAlloc pa;
-	if (!SAU_fill_PreAlloc(&pa, prg, srate, o->mem))
+	if (!SAU_fill_PreAlloc(&pa, prg, srate, NULL, o->mem))
 		return false;
 	o->prg = prg;
 	o->srate = srate;
 	o->events = pa.events;
 	o->ev_count = pa.ev_count;
+	o->loops = pa.loops;
+	o->loop_count = pa.loop_count;
+	o->repeats = (pa.loop_count > 0) ? pa.loops[0].count - 1 : 0;
 	o->operators = pa.operators;
+	o->op_params = pa.op_params;
+	o->op_count = pa.op_count;
 	o->voices = pa.voices;
-	o->vo_count = pa.vo_count;
+	o->vo_count = o->vo_alloc = pa.vo_count;
+	o->op_alloc = pa.op_count;
+	if (args != NULL && prg->arg_count > 0 && !bind_args(o, args))
+		goto ERROR;
+	if (pa.ev_count > 0) {
+		size_t count = (pa.ev_count < BUF_LEN) ? pa.ev_count : BUF_LEN;
+		o->block_evs = SAU_MemPool_alloc(o->mem,
+				count * sizeof(BlockEvent));
+		if (!o->block_evs) goto ERROR;
+	}
 	if (pa.max_bufs > 0) {
 		o->bufs = SAU_MemPool_alloc(o->mem,
 				pa.max_bufs * sizeof(Buf));
 		if (!o->bufs) goto ERROR;
 		o->buf_count = pa.max_bufs;
 	}
-	o->mixer = SAU_create_Mixer();
-	if (!o->mixer) goto ERROR;
-
 	float scale = 1.f;
 	if ((prg->mode & SAU_PMODE_AMP_DIV_VOICES) != 0)
 		scale /= o->vo_count;
@@ -67,24 +150,26 @@ ERROR:
 
 /**
  * Create instance for program \p prg and sample rate \p srate.
+ *
+ * If not NULL, \p args holds a value for each script argument of
+ * the program, used in place of the default values. The values
+ * are bound for the instance when created or reset.
  */
 SAU_Interp *SAU_create_Interp(const SAU_Program *restrict prg,
-		uint32_t srate) {
-	SAU_MemPool *mem = SAU_create_MemPool(0);
-	if (!mem)
-		return NULL;
-	SAU_Interp *o = SAU_MemPool_alloc(mem, sizeof(SAU_Interp));
-	if (!o) {
-		SAU_destroy_MemPool(mem);
-		return NULL;
-	}
-	o->mem = mem;
-	if (!init_for_program(o, prg, srate)) {
-		SAU_destroy_Interp(o);
+		uint32_t srate, const float *restrict args) {
+	SAU_Interp *o = calloc(1, sizeof(SAU_Interp));
+	if (!o)
 		return NULL;
-	}
+	o->mem = SAU_create_MemPool(0);
+	if (!o->mem) goto ERROR;
+	o->mixer = SAU_create_Mixer();
+	if (!o->mixer) goto ERROR;
+	if (!init_for_program(o, prg, srate, args)) goto ERROR;
 	SAU_global_init_Wave();
 	return o;
+ERROR:
+	SAU_destroy_Interp(o);
+	return NULL;
 }
 
 /**
@@ -95,6 +180,29 @@ void SAU_destroy_Interp(SAU_Interp *restrict o) {
 		return;
 	SAU_destroy_Mixer(o->mixer);
 	SAU_destroy_MemPool(o->mem);
+	SAU_destroy_MemPool(o->ev_mem);
+	free(o);
+}
+
+/**
+ * Reset instance for program \p prg, sample rate \p srate,
+ * and argument values \p args (or NULL for the defaults),
+ * as if newly created, but reusing the memory already allocated.
+ *
+ * \return true, or false on failure (instance then only to be
+ *         reset again or destroyed)
+ */
+bool SAU_Interp_reset(SAU_Interp *restrict o,
+		const SAU_Program *restrict prg, uint32_t srate,
+		const float *restrict args) {
+	SAU_MemPool *mem = o->mem;
+	SAU_Mixer *mixer = o->mixer;
+	SAU_MemPool_clear(mem);
+	SAU_destroy_MemPool(o->ev_mem);
+	*o = (SAU_Interp){0};
+	o->mem = mem;
+	o->mixer = mixer;
+	return init_for_program(o, prg, srate, args);
 }
 
 /*
@@ -136,17 +244,23 @@ static void handle_event(SAU_Interp *restrict o, EventNode *restrict e) {
 		 * Voice updates must be done last, to take into account
 		 * updates for their operators.
 		 */
-		const SAU_ProgramEvent *prg_e = e->prg_e;
 		VoiceNode *vn = NULL;
-		if (prg_e->vo_id != SAU_PVO_NO_ID)
-			vn = &o->voices[prg_e->vo_id];
-		for (size_t i = 0; i < prg_e->op_data_count; ++i) {
-			const SAU_ProgramOpData *od = &prg_e->op_data[i];
+		if (e->vo_id != SAU_PVO_NO_ID)
+			vn = &o->voices[e->vo_id];
+		for (size_t i = 0; i < e->op_data_count; ++i) {
+			const SAU_ProgramOpData *od = &e->op_data[i];
 			OperatorNode *on = &o->operators[od->id];
+			OperatorParams *op = &o->op_params[od->id];
 			uint32_t params = od->params;
-			on->fmods = od->fmods;
-			on->pmods = od->pmods;
-			on->amods = od->amods;
+			if (od->flags & SAU_PODF_INIT) {
+				/* may be reused; clear state from before */
+				*on = (OperatorNode){0};
+				SAU_init_Osc(&on->osc, o->srate);
+				*op = (OperatorParams){0};
+			}
+			op->fmods = od->fmods;
+			op->pmods = od->pmods;
+			op->amods = od->amods;
 			if (params & SAU_POPP_WAVE)
 				on->osc.lut = SAU_Osc_LUT(od->wave);
 			if (params & SAU_POPP_TIME) {
@@ -164,18 +278,18 @@ static void handle_event(SAU_Interp *restrict o, EventNode *restrict e) {
 				on->silence = SAU_MS_IN_SAMPLES(od->silence_ms,
 						o->srate);
 			if (params & SAU_POPP_FREQ)
-				handle_ramp_update(&on->freq,
+				handle_ramp_update(&op->freq,
 						&on->freq_pos, &od->freq);
 			if (params & SAU_POPP_FREQ2)
-				handle_ramp_update(&on->freq2,
+				handle_ramp_update(&op->freq2,
 						&on->freq2_pos, &od->freq2);
 			if (params & SAU_POPP_PHASE)
 				on->osc.phase = SAU_Osc_PHASE(od->phase);
 			if (params & SAU_POPP_AMP)
-				handle_ramp_update(&on->amp,
+				handle_ramp_update(&op->amp,
 						&on->amp_pos, &od->amp);
 			if (params & SAU_POPP_AMP2)
-				handle_ramp_update(&on->amp2,
+				handle_ramp_update(&op->amp2,
 						&on->amp2_pos, &od->amp2);
 			if (params & SAU_POPP_PAN)
 				handle_ramp_update(&vn->pan,
@@ -187,16 +301,92 @@ static void handle_event(SAU_Interp *restrict o, EventNode *restrict e) {
 				vn->graph_count = e->graph_count;
 			}
 			vn->flags |= VN_INIT;
-			vn->pos = 0;
-			if (o->voice > prg_e->vo_id) {
+			if (o->voice > e->vo_id) {
 				/* go back to re-activated node */
-				o->voice = prg_e->vo_id;
+				o->voice = e->vo_id;
 			}
+			if (o->vo_end <= e->vo_id)
+				o->vo_end = e->vo_id + 1;
 			set_voice_duration(o, vn);
 		}
 	}
 }
 
+/*
+ * Apply one control command.
+ *
+ * Commands with IDs outside the program are ignored.
+ */
+static void handle_ctl_cmd(SAU_Interp *restrict o,
+		const SAU_CtlCmd *restrict cmd) {
+	if (cmd->type < SAU_CTL_VO_PAN) {
+		if (cmd->id >= o->op_count)
+			return;
+		OperatorNode *on = &o->operators[cmd->id];
+		OperatorParams *op = &o->op_params[cmd->id];
+		switch (cmd->type) {
+		case SAU_CTL_OP_AMP:
+			handle_ramp_update(&op->amp, &on->amp_pos, &cmd->ramp);
+			break;
+		case SAU_CTL_OP_AMP2:
+			handle_ramp_update(&op->amp2,
+					&on->amp2_pos, &cmd->ramp);
+			break;
+		case SAU_CTL_OP_FREQ:
+			handle_ramp_update(&op->freq,
+					&on->freq_pos, &cmd->ramp);
+			break;
+		case SAU_CTL_OP_FREQ2:
+			handle_ramp_update(&op->freq2,
+					&on->freq2_pos, &cmd->ramp);
+			break;
+		case SAU_CTL_OP_PHASE:
+			on->osc.phase = SAU_Osc_PHASE(cmd->value);
+			break;
+		case SAU_CTL_OP_TIME:
+			on->time = SAU_MS_IN_SAMPLES(cmd->time_ms, o->srate);
+			on->flags &= ~ON_TIME_INF;
+			break;
+		}
+		return;
+	}
+	if (cmd->id >= o->vo_count)
+		return;
+	VoiceNode *vn = &o->voices[cmd->id];
+	switch (cmd->type) {
+	case SAU_CTL_VO_PAN:
+		handle_ramp_update(&vn->pan, &vn->pan_pos, &cmd->ramp);
+		break;
+	case SAU_CTL_VO_TRIGGER:
+		vn->flags |= VN_INIT;
+		if (o->voice > cmd->id)
+			o->voice = cmd->id;
+		if (o->vo_end <= cmd->id)
+			o->vo_end = cmd->id + 1;
+		set_voice_duration(o, vn);
+		break;
+	}
+}
+
+/*
+ * Apply the control commands due at the current time.
+ *
+ * \return samples until the next command is due, or
+ *         UINT32_MAX if none is queued or it's further off
+ */
+static uint32_t handle_ctl(SAU_Interp *restrict o) {
+	const SAU_CtlCmd *cmd;
+	while ((cmd = SAU_CtlQueue_peek(o->ctl)) != NULL) {
+		if (cmd->time > o->time) {
+			uint64_t wait = cmd->time - o->time;
+			return (wait < UINT32_MAX) ? wait : UINT32_MAX;
+		}
+		handle_ctl_cmd(o, cmd);
+		SAU_CtlQueue_pop(o->ctl);
+	}
+	return UINT32_MAX;
+}
+
 /*
  * Generate up to buf_len samples for an operator node,
  * the remainder (if any) zero-filled if acc_ind is zero.
@@ -204,13 +394,22 @@ static void handle_event(SAU_Interp *restrict o, EventNode *restrict e) {
  * Recursively visits the subnodes of the operator node,
  * if any.
  *
+ * The first of \p bufs is for output, the rest are used
+ * for parameters and modulator output as they are needed.
+ * Each modulator list is run before the parameter buffers
+ * it's combined with are filled, so that fewer are live
+ * during the recursion; the pre-allocation pass counts
+ * buffers for the same layout.
+ *
  * Returns number of samples generated for the node.
  */
 static uint32_t run_block(SAU_Interp *restrict o,
 		Buf *restrict bufs, uint32_t buf_len,
-		OperatorNode *restrict n,
+		uint32_t id,
 		float *restrict parent_freq,
 		bool wave_env, uint32_t acc_ind) {
+	OperatorNode *n = &o->operators[id];
+	OperatorParams *p = &o->op_params[id];
 	uint32_t i, len = buf_len;
 	float *s_buf = *(bufs++), *pm_buf;
 	float *freq, *amp;
@@ -253,50 +452,49 @@ static uint32_t run_block(SAU_Interp *restrict o,
 	 * if modulators linked.
 	 */
 	freq = *(bufs++);
-	SAU_Ramp_run(&n->freq, &n->freq_pos, freq, len, o->srate, parent_freq);
-	if (n->fmods->count > 0) {
-		float *freq2 = *(bufs++);
-		SAU_Ramp_run(&n->freq2, &n->freq2_pos,
+	SAU_Ramp_run(&p->freq, &n->freq_pos, freq, len, o->srate, parent_freq);
+	if (p->fmods->count > 0) {
+		const uint32_t *fmods = p->fmods->ids;
+		for (i = 0; i < p->fmods->count; ++i)
+			run_block(o, bufs, len, fmods[i], freq, true, i);
+		float *fm_buf = bufs[0];
+		float *freq2 = bufs[1];
+		SAU_Ramp_run(&p->freq2, &n->freq2_pos,
 				freq2, len, o->srate, parent_freq);
-		const uint32_t *fmods = n->fmods->ids;
-		for (i = 0; i < n->fmods->count; ++i)
-			run_block(o, bufs, len, &o->operators[fmods[i]],
-					freq, true, i);
-		float *fm_buf = *bufs;
 		for (i = 0; i < len; ++i)
 			freq[i] += (freq2[i] - freq[i]) * fm_buf[i];
 	} else {
-		SAU_Ramp_skip(&n->freq2, &n->freq2_pos, len, o->srate);
+		SAU_Ramp_skip(&p->freq2, &n->freq2_pos, len, o->srate);
 	}
 	/*
 	 * If phase modulators linked, get phase offsets for modulation.
 	 */
 	pm_buf = NULL;
-	if (n->pmods->count > 0) {
-		const uint32_t *pmods = n->pmods->ids;
-		for (i = 0; i < n->pmods->count; ++i)
-			run_block(o, bufs, len, &o->operators[pmods[i]],
-					freq, false, i);
+	if (p->pmods->count > 0) {
+		const uint32_t *pmods = p->pmods->ids;
+		for (i = 0; i < p->pmods->count; ++i)
+			run_block(o, bufs, len, pmods[i], freq, false, i);
 		pm_buf = *(bufs++);
 	}
 	/*
 	 * Handle amplitude parameter, including amplitude modulation if
 	 * modulators linked.
 	 */
-	amp = *(bufs++);
-	SAU_Ramp_run(&n->amp, &n->amp_pos, amp, len, o->srate, NULL);
-	if (n->amods->count > 0) {
-		float *amp2 = *(bufs++);
-		SAU_Ramp_run(&n->amp2, &n->amp2_pos, amp2, len, o->srate, NULL);
-		const uint32_t *amods = n->amods->ids;
-		for (i = 0; i < n->amods->count; ++i)
-			run_block(o, bufs, len, &o->operators[amods[i]],
-					freq, true, i);
-		float *am_buf = *bufs;
+	if (p->amods->count > 0) {
+		const uint32_t *amods = p->amods->ids;
+		for (i = 0; i < p->amods->count; ++i)
+			run_block(o, bufs, len, amods[i], freq, true, i);
+		float *am_buf = *(bufs++);
+		amp = bufs[0];
+		float *amp2 = bufs[1];
+		SAU_Ramp_run(&p->amp, &n->amp_pos, amp, len, o->srate, NULL);
+		SAU_Ramp_run(&p->amp2, &n->amp2_pos, amp2, len, o->srate, NULL);
 		for (i = 0; i < len; ++i)
 			amp[i] += (amp2[i] - amp[i]) * am_buf[i];
 	} else {
-		SAU_Ramp_skip(&n->amp2, &n->amp2_pos, len, o->srate);
+		amp = *bufs;
+		SAU_Ramp_run(&p->amp, &n->amp_pos, amp, len, o->srate, NULL);
+		SAU_Ramp_skip(&p->amp2, &n->amp2_pos, len, o->srate);
 	}
 	if (!wave_env) {
 		SAU_Osc_run(&n->osc, s_buf, len, acc_ind, freq, amp, pm_buf);
@@ -318,14 +516,117 @@ static uint32_t run_block(SAU_Interp *restrict o,
 	return zero_len + len;
 }
 
+/*
+ * Advance state for up to buf_len samples for an operator node,
+ * like run_block() but without generating output where skipping
+ * it gives the same resulting state. Buffers are only used for
+ * the parameter values which later state depends on.
+ *
+ * Recursively visits the subnodes of the operator node,
+ * if any.
+ *
+ * Returns number of samples skipped for the node.
+ */
+static uint32_t skip_block(SAU_Interp *restrict o,
+		Buf *restrict bufs, uint32_t buf_len,
+		uint32_t id,
+		float *restrict parent_freq) {
+	OperatorNode *n = &o->operators[id];
+	OperatorParams *p = &o->op_params[id];
+	uint32_t i, len = buf_len;
+	float *freq;
+	++bufs; /* output buffer not used */
+	/*
+	 * If silence, delay processing for duration.
+	 */
+	uint32_t zero_len = 0;
+	if (n->silence) {
+		zero_len = n->silence;
+		if (zero_len > len)
+			zero_len = len;
+		len -= zero_len;
+		if (!(n->flags & ON_TIME_INF)) n->time -= zero_len;
+		n->silence -= zero_len;
+		if (!len)
+			return zero_len;
+	}
+	/*
+	 * Guard against circular references.
+	 */
+	if ((n->flags & ON_VISITED) != 0)
+		return zero_len + len;
+	n->flags |= ON_VISITED;
+	/*
+	 * Limit length to time duration of operator.
+	 */
+	if (n->time < len && !(n->flags & ON_TIME_INF))
+		len = n->time;
+	/*
+	 * Handle frequency, including frequency modulation
+	 * if modulators linked. The values are only needed
+	 * if not constant, or if used by any modulators.
+	 */
+	bool fixed_freq = !(p->freq.flags & SAU_RAMPP_GOAL) &&
+		(!parent_freq || !(p->freq.flags & SAU_RAMPP_STATE_RATIO)) &&
+		(p->fmods->count == 0);
+	freq = *(bufs++);
+	if (!fixed_freq || p->pmods->count > 0 || p->amods->count > 0)
+		SAU_Ramp_run(&p->freq, &n->freq_pos,
+				freq, len, o->srate, parent_freq);
+	if (p->fmods->count > 0) {
+		const uint32_t *fmods = p->fmods->ids;
+		for (i = 0; i < p->fmods->count; ++i)
+			run_block(o, bufs, len, fmods[i], freq, true, i);
+		float *fm_buf = bufs[0];
+		float *freq2 = bufs[1];
+		SAU_Ramp_run(&p->freq2, &n->freq2_pos,
+				freq2, len, o->srate, parent_freq);
+		for (i = 0; i < len; ++i)
+			freq[i] += (freq2[i] - freq[i]) * fm_buf[i];
+	} else {
+		SAU_Ramp_skip(&p->freq2, &n->freq2_pos, len, o->srate);
+	}
+	/*
+	 * Phase modulation doesn't change state beyond the modulators.
+	 */
+	if (p->pmods->count > 0) {
+		const uint32_t *pmods = p->pmods->ids;
+		for (i = 0; i < p->pmods->count; ++i)
+			skip_block(o, bufs, len, pmods[i], freq);
+		++bufs;
+	}
+	/*
+	 * Nor does amplitude, or amplitude modulation.
+	 */
+	if (p->amods->count > 0) {
+		const uint32_t *amods = p->amods->ids;
+		for (i = 0; i < p->amods->count; ++i)
+			skip_block(o, bufs, len, amods[i], freq);
+	}
+	SAU_Ramp_skip(&p->amp, &n->amp_pos, len, o->srate);
+	SAU_Ramp_skip(&p->amp2, &n->amp2_pos, len, o->srate);
+	if (fixed_freq) {
+		SAU_Osc_skip_fixed(&n->osc, len, p->freq.v0);
+	} else {
+		SAU_Osc_skip(&n->osc, len, freq);
+	}
+	/*
+	 * Update time duration left.
+	 */
+	if (!(n->flags & ON_TIME_INF))
+		n->time -= len;
+	n->flags &= ~ON_VISITED;
+	return zero_len + len;
+}
+
 /*
  * Generate up to BUF_LEN samples for a voice, mixed into the
- * mix buffers.
+ * mix buffers from position \p pos.
  *
  * \return number of samples generated
  */
 static uint32_t run_voice(SAU_Interp *restrict o,
-		VoiceNode *restrict vn, uint32_t len) {
+		VoiceNode *restrict vn, uint32_t pos, uint32_t len) {
 	uint32_t out_len = 0;
 	const SAU_ProgramOpRef *ops = vn->graph;
 	uint32_t opc = vn->graph_count;
@@ -343,140 +644,465 @@ static uint32_t run_voice(SAU_Interp *restrict o,
 		if (ops[i].use != SAU_POP_CARR) continue;
 		OperatorNode *n = &o->operators[ops[i].id];
 		if (n->time == 0) continue;
-		last_len = run_block(o, o->bufs, time, n,
+		last_len = run_block(o, o->bufs, time, ops[i].id,
 				NULL, false, acc_ind++);
 		if (last_len > out_len) out_len = last_len;
 	}
 	if (out_len > 0) {
-		SAU_Mixer_add(o->mixer, o->bufs[0], out_len,
+		SAU_Mixer_add(o->mixer, pos, o->bufs[0], out_len,
 				&vn->pan, &vn->pan_pos);
 	}
 	vn->duration -= time;
-	vn->pos += time;
 	return out_len;
 }
 
 /*
- * Run voices for \p time, repeatedly generating up to BUF_LEN samples
- * and writing them into the 16-bit stereo (interleaved) buffer \p buf.
+ * Advance state for up to BUF_LEN samples for a voice,
+ * like run_voice() but without generating output.
  *
- * \return number of samples generated
+ * \return number of samples skipped
  */
-static uint32_t run_for_time(SAU_Interp *restrict o,
-		uint32_t time, int16_t *restrict buf) {
-	int16_t *sp = buf;
-	uint32_t gen_len = 0;
-	while (time > 0) {
-		uint32_t len = time;
-		if (len > BUF_LEN) len = BUF_LEN;
-		SAU_Mixer_clear(o->mixer);
-		uint32_t last_len = 0;
-		for (uint32_t i = o->voice; i < o->vo_count; ++i) {
-			VoiceNode *vn = &o->voices[i];
-			if (vn->pos < 0) {
-				/*
-				 * Wait times accumulate across nodes.
-				 *
-				 * Reduce length by wait time and
-				 * end if wait time(s) have swallowed it up.
-				 */
-				uint32_t wait_time = (uint32_t) -vn->pos;
-				if (wait_time >= len) {
-					vn->pos += len;
-					break;
-				}
-				sp += wait_time+wait_time; /* stereo double */
-				len -= wait_time;
-				gen_len += wait_time;
-				vn->pos = 0;
+static uint32_t skip_voice(SAU_Interp *restrict o,
+		VoiceNode *restrict vn, uint32_t len) {
+	uint32_t out_len = 0;
+	const SAU_ProgramOpRef *ops = vn->graph;
+	uint32_t opc = vn->graph_count;
+	if (!ops)
+		return 0;
+	uint32_t time;
+	uint32_t i;
+	time = vn->duration;
+	if (len > BUF_LEN) len = BUF_LEN;
+	if (time > len) time = len;
+	for (i = 0; i < opc; ++i) {
+		uint32_t last_len;
+		if (ops[i].use != SAU_POP_CARR) continue;
+		OperatorNode *n = &o->operators[ops[i].id];
+		if (n->time == 0) continue;
+		last_len = skip_block(o, o->bufs, time, ops[i].id, NULL);
+		if (last_len > out_len) out_len = last_len;
+	}
+	if (out_len > 0)
+		SAU_Ramp_skip(&vn->pan, &vn->pan_pos, out_len, o->srate);
+	vn->duration -= time;
+	return out_len;
+}
+
+static const SAU_ProgramOpList blank_oplist = {0};
+
+/*
+ * \return size of operator list, or 0 if empty
+ */
+static size_t oplist_size(const SAU_ProgramOpList *restrict op_list) {
+	if (!op_list->count)
+		return 0;
+	return sizeof(SAU_ProgramOpList) + sizeof(uint32_t) * op_list->count;
+}
+
+/*
+ * Copy operator list to \p *mp, unless empty, advancing it.
+ *
+ * \return list copy
+ */
+static const SAU_ProgramOpList *copy_oplist(
+		const SAU_ProgramOpList *restrict op_list,
+		char **restrict mp) {
+	size_t size = oplist_size(op_list);
+	if (!size)
+		return &blank_oplist;
+	const SAU_ProgramOpList *copy = memcpy(*mp, op_list, size);
+	*mp += size;
+	return copy;
+}
+
+/*
+ * Copy the operator lists and voice graphs in use into \p mem,
+ * to no longer depend on the memory of the current program.
+ * Nothing is changed on failure.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool copy_lists(SAU_Interp *restrict o, SAU_MemPool *restrict mem) {
+	size_t size = 0;
+	for (uint32_t i = 0; i < o->op_count; ++i) {
+		OperatorParams *op = &o->op_params[i];
+		size += oplist_size(op->fmods) + oplist_size(op->pmods) +
+			oplist_size(op->amods);
+	}
+	for (uint32_t i = 0; i < o->vo_count; ++i)
+		size += o->voices[i].graph_count * sizeof(SAU_ProgramOpRef);
+	if (!size)
+		return true;
+	char *mp = SAU_MemPool_alloc(mem, size);
+	if (!mp)
+		return false;
+	for (uint32_t i = 0; i < o->op_count; ++i) {
+		OperatorParams *op = &o->op_params[i];
+		op->fmods = copy_oplist(op->fmods, &mp);
+		op->pmods = copy_oplist(op->pmods, &mp);
+		op->amods = copy_oplist(op->amods, &mp);
+	}
+	for (uint32_t i = 0; i < o->vo_count; ++i) {
+		VoiceNode *vn = &o->voices[i];
+		size = vn->graph_count * sizeof(SAU_ProgramOpRef);
+		if (!size)
+			continue;
+		vn->graph = memcpy(mp, vn->graph, size);
+		mp += size;
+	}
+	return true;
+}
+
+/*
+ * Grow voice and operator arrays to the counts for \p prg,
+ * doubling the allocation when increased beyond it.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool grow_nodes(SAU_Interp *restrict o,
+		const SAU_Program *restrict prg) {
+	if (prg->vo_count > o->vo_alloc) {
+		uint32_t alloc = o->vo_alloc * 2;
+		if (alloc < prg->vo_count) alloc = prg->vo_count;
+		VoiceNode *voices = SAU_MemPool_alloc(o->mem,
+				alloc * sizeof(VoiceNode));
+		if (!voices)
+			return false;
+		if (o->vo_count > 0)
+			memcpy(voices, o->voices,
+					o->vo_count * sizeof(VoiceNode));
+		o->voices = voices;
+		o->vo_alloc = alloc;
+	}
+	if (prg->vo_count > o->vo_count)
+		o->vo_count = prg->vo_count;
+	if (prg->op_count > o->op_alloc) {
+		uint32_t alloc = o->op_alloc * 2;
+		if (alloc < prg->op_count) alloc = prg->op_count;
+		OperatorNode *operators = SAU_MemPool_alloc(o->mem,
+				alloc * sizeof(OperatorNode));
+		OperatorParams *op_params = SAU_MemPool_alloc(o->mem,
+				alloc * sizeof(OperatorParams));
+		if (!operators || !op_params)
+			return false;
+		if (o->op_count > 0) {
+			memcpy(operators, o->operators,
+					o->op_count * sizeof(OperatorNode));
+			memcpy(op_params, o->op_params,
+					o->op_count * sizeof(OperatorParams));
+		}
+		o->operators = operators;
+		o->op_params = op_params;
+		o->op_alloc = alloc;
+	}
+	for (; o->op_count < prg->op_count; ++o->op_count) {
+		OperatorParams *op = &o->op_params[o->op_count];
+		SAU_init_Osc(&o->operators[o->op_count].osc, o->srate);
+		op->fmods = op->pmods = op->amods = &blank_oplist;
+	}
+	return true;
+}
+
+/*
+ * Continue with the next program from the source, once all
+ * events of the current program have been handled. What is
+ * still used from the current program is copied first, as
+ * the source may then discard it.
+ *
+ * \return true if continued, or false at the end or on error
+ */
+static bool next_program(SAU_Interp *restrict o) {
+	SAU_MemPool *ev_mem = SAU_create_MemPool(0);
+	if (!ev_mem || !copy_lists(o, ev_mem)) goto MEM_ERR;
+	SAU_destroy_MemPool(o->ev_mem);
+	o->ev_mem = ev_mem;
+	o->events = NULL;
+	o->event = o->ev_count = 0;
+	o->loops = NULL;
+	o->loop = o->loop_count = 0;
+	const SAU_Program *prg = o->source(o->source_data);
+	if (!prg) goto END;
+	if (!grow_nodes(o, prg)) goto MEM_ERR;
+	SAU_PreAlloc from = (SAU_PreAlloc){0}, pa;
+	from.operators = o->operators;
+	from.op_params = o->op_params;
+	from.op_count = o->op_count;
+	from.voices = o->voices;
+	from.vo_count = o->vo_count;
+	if (!SAU_fill_PreAlloc(&pa, prg, o->srate, &from, ev_mem))
+		goto END;
+	if (pa.max_bufs > o->buf_count) {
+		Buf *bufs = SAU_MemPool_alloc(o->mem,
+				pa.max_bufs * sizeof(Buf));
+		if (!bufs) goto MEM_ERR;
+		o->bufs = bufs;
+		o->buf_count = pa.max_bufs;
+	}
+	o->prg = prg;
+	o->events = pa.events;
+	o->ev_count = pa.ev_count;
+	o->loops = pa.loops;
+	o->loop_count = pa.loop_count;
+	o->repeats = (pa.loop_count > 0) ? pa.loops[0].count - 1 : 0;
+	return true;
+MEM_ERR:
+	SAU_error("interp", "memory allocation failure");
+	if (ev_mem != o->ev_mem) SAU_destroy_MemPool(ev_mem);
+END:
+	o->source = NULL;
+	return false;
+}
+
+/*
+ * Get the wait for event \p i, which for the first event of
+ * the current loop differs after the first run.
+ */
+static inline uint32_t event_wait(const SAU_Interp *restrict o, size_t i) {
+	if (o->loop < o->loop_count) {
+		const LoopNode *l = &o->loops[o->loop];
+		if (i == l->first_ev && o->repeats < l->count - 1)
+			return l->wait;
+	}
+	return o->events[i].wait;
+}
+
+/*
+ * Go back to the first event of the current loop if its events
+ * have been handled and runs remain, or move on to the next loop
+ * if not.
+ */
+static void update_loop(SAU_Interp *restrict o) {
+	while (o->loop < o->loop_count) {
+		const LoopNode *l = &o->loops[o->loop];
+		if (o->event < l->end_ev)
+			return;
+		if (o->repeats > 0) {
+			--o->repeats;
+			o->event = l->first_ev;
+			return;
+		}
+		if (++o->loop < o->loop_count)
+			o->repeats = o->loops[o->loop].count - 1;
+	}
+}
+
+/*
+ * Get the loop which will next go back to its first event,
+ * or NULL if none.
+ */
+static const LoopNode *next_repeat(const SAU_Interp *restrict o) {
+	if (o->loop >= o->loop_count)
+		return NULL;
+	if (o->repeats > 0)
+		return &o->loops[o->loop];
+	return (o->loop + 1 < o->loop_count) ? &o->loops[o->loop + 1] : NULL;
+}
+
+/*
+ * Gather the events due within \p len samples from the current
+ * time, up to the first which needs processing split for all
+ * voices, or which doesn't fit. \p len is then reduced to its
+ * time, and \p split set.
+ *
+ * Events due at the current time must have been handled. When
+ * a program source is set, the last event of the program is
+ * also left out, to be handled before continuing with the next.
+ * Gathering also stops at the end of a loop going back, with
+ * \p len reduced to the time of the next run if within it.
+ *
+ * \return number of events gathered
+ */
+static uint32_t gather_events(SAU_Interp *restrict o,
+		uint32_t *restrict len, bool *restrict split) {
+	uint32_t count = 0;
+	uint32_t pos = 0;
+	uint32_t event_pos = o->event_pos;
+	const LoopNode *l = next_repeat(o);
+	size_t end = (l != NULL) ? l->end_ev : o->ev_count;
+	size_t i;
+	for (i = o->event; i < end; ++i) {
+		uint32_t wait = event_wait(o, i) - event_pos;
+		EventNode *e = &o->events[i];
+		event_pos = 0;
+		if (wait >= *len - pos)
+			return count;
+		pos += wait;
+		if ((e->flags & EN_SPLIT) != 0 || count == BUF_LEN) {
+			*len = pos;
+			*split = true;
+			return count;
+		}
+		o->block_evs[count].pos = pos;
+		++count;
+	}
+	if (l != NULL) {
+		uint32_t wait = l->wait - event_pos;
+		if (wait < *len - pos) {
+			*len = pos + wait;
+			*split = true;
+		}
+		return count;
+	}
+	if (o->source != NULL && count > 0) {
+		*len = o->block_evs[--count].pos;
+		*split = true;
+	}
+	return count;
+}
+
+/*
+ * Run voices for a block of up to BUF_LEN samples, writing
+ * them into the stereo (interleaved) buffer \p sp, as floats
+ * if \p f32 is true and otherwise 16-bit, or if it is NULL,
+ * only advancing state.
+ *
+ * The \p ev_count events gathered for the block are handled
+ * as each voice reaches their times, splitting the run of
+ * that voice only.
+ *
+ * \return length up to the end of the samples generated
+ */
+static uint32_t run_block_voices(SAU_Interp *restrict o,
+		void *sp, bool f32, uint32_t len, uint32_t ev_count) {
+	uint32_t vo_first = o->voice, vo_end = o->vo_end;
+	uint32_t i;
+	/*
+	 * Link events to their voices, in time order for each.
+	 */
+	for (i = ev_count; i-- > 0; ) {
+		uint32_t vo_id = o->events[o->event + i].vo_id;
+		VoiceNode *vn = &o->voices[vo_id];
+		o->block_evs[i].next = vn->ev_head;
+		vn->ev_head = i + 1;
+		if (vo_id < vo_first) vo_first = vo_id;
+		if (vo_id >= vo_end) vo_end = vo_id + 1;
+	}
+	if (sp != NULL) SAU_Mixer_clear(o->mixer);
+	uint32_t last_len = 0;
+	for (i = vo_first; i < vo_end; ++i) {
+		VoiceNode *vn = &o->voices[i];
+		uint32_t pos = 0, end;
+		do {
+			uint32_t ev_i = vn->ev_head;
+			end = (ev_i != 0) ? o->block_evs[ev_i - 1].pos : len;
+			if (vn->duration != 0 && end > pos) {
+				uint32_t voice_len = (sp != NULL) ?
+					run_voice(o, vn, pos, end - pos) :
+					skip_voice(o, vn, end - pos);
+				if (voice_len > 0 && pos + voice_len > last_len)
+					last_len = pos + voice_len;
 			}
-			if (vn->duration != 0) {
-				uint32_t voice_len = run_voice(o, vn, len);
-				if (voice_len > last_len) last_len = voice_len;
+			if (ev_i != 0) {
+				handle_event(o, &o->events[o->event + ev_i-1]);
+				vn->ev_head = o->block_evs[ev_i - 1].next;
 			}
-		}
-		time -= len;
-		if (last_len > 0) {
-			gen_len += last_len;
-			SAU_Mixer_write(o->mixer, &sp, last_len);
+			pos = end;
+		} while (end < len || vn->ev_head != 0);
+	}
+	if (sp != NULL && last_len > 0) {
+		if (f32) {
+			float *fp = sp;
+			SAU_Mixer_write_f32(o->mixer, &fp, last_len);
+		} else {
+			int16_t *ip = sp;
+			SAU_Mixer_write(o->mixer, &ip, last_len);
 		}
 	}
-	return gen_len;
+	return last_len;
 }
 
 /*
  * Any error checking following audio generation goes here.
  */
 static void check_final_state(SAU_Interp *restrict o) {
-	for (uint16_t i = 0; i < o->vo_count; ++i) {
+	for (uint32_t i = 0; i < o->vo_count; ++i) {
 		VoiceNode *vn = &o->voices[i];
 		if (!(vn->flags & VN_INIT)) {
 			SAU_warning("interp",
-"voice %hd left uninitialized (never used)", i);
+"voice %u left uninitialized (never used)", i);
 		}
 	}
 }
 
-/**
- * Main audio generation/processing function. Call repeatedly to write
- * buf_len new samples into the interleaved stereo buffer buf. Any values
- * after the end of the signal will be zero'd.
+/*
+ * Handle events and run voices for \p buf_len samples, writing
+ * them into the interleaved stereo buffer \p buf, of floats if
+ * \p f32 is true and otherwise 16-bit, or if it is NULL, only
+ * advancing state.
+ *
+ * Processing is done in blocks, split for all voices only at
+ * control commands and events marked for it; other events are
+ * handled by voice within a block.
  *
  * \return number of samples generated, buf_len unless signal ended
  */
-size_t SAU_Interp_run(SAU_Interp *restrict o,
-		int16_t *restrict buf, size_t buf_len) {
-	int16_t *sp = buf;
-	uint32_t i, len = buf_len;
-	for (i = len; i--; sp += 2) {
-		sp[0] = 0;
-		sp[1] = 0;
-	}
-	sp = buf;
-	uint32_t skip_len, last_len, gen_len = 0;
-PROCESS:
-	skip_len = 0;
-	while (o->event < o->ev_count) {
-		EventNode *e = o->events[o->event];
-		if (o->event_pos < e->wait) {
+static size_t run_or_skip(SAU_Interp *restrict o,
+		void *restrict buf, bool f32, size_t buf_len) {
+	size_t frame_size = f32 ? 2 * sizeof(float) : 2 * sizeof(int16_t);
+	if (buf != NULL) memset(buf, 0, buf_len * frame_size);
+	size_t done = 0, gen_len = 0;
+	while (done < buf_len) {
+		uint32_t len = BUF_LEN;
+		if (len > buf_len - done) len = buf_len - done;
+		bool split = false;
+		for (;;) {
+			update_loop(o);
+			if (o->event == o->ev_count) {
+				if (!o->source || !next_program(o)) break;
+				continue;
+			}
+			EventNode *e = &o->events[o->event];
+			if (o->event_pos < event_wait(o, o->event))
+				break;
+			handle_event(o, e);
+			++o->event;
+			o->event_pos = 0;
+		}
+		if (o->ctl != NULL) {
 			/*
-			 * Limit voice running len to wait.
-			 *
-			 * Split processing into two blocks when needed to
-			 * ensure event handling runs before voices.
+			 * Control commands go after any events at the same
+			 * time, and also split processing when needed.
 			 */
-			uint32_t wait = e->wait - o->event_pos;
+			uint32_t wait = handle_ctl(o);
 			if (wait < len) {
-				skip_len = len - wait;
 				len = wait;
+				split = true;
 			}
+		}
+		uint32_t ev_count = gather_events(o, &len, &split);
+		uint32_t last_len = run_block_voices(o,
+				(buf != NULL) ?
+				(char*)buf + done*frame_size : NULL,
+				f32, len, ev_count);
+		if (ev_count > 0) {
+			uint32_t last_pos = o->block_evs[ev_count - 1].pos;
+			o->event += ev_count;
+			o->event_pos = len - last_pos;
+			if (done + last_pos > gen_len)
+				gen_len = done + last_pos;
+		} else if (o->event < o->ev_count) {
 			o->event_pos += len;
-			break;
 		}
-		handle_event(o, e);
-		++o->event;
-		o->event_pos = 0;
-	}
-	last_len = run_for_time(o, len, sp);
-	if (skip_len > 0) {
-		gen_len += len;
-		sp += len+len; /* stereo double */
-		len = skip_len;
-		goto PROCESS;
-	} else {
-		gen_len += last_len;
+		o->time += len;
+		if (split)
+			gen_len = done + len;
+		else if (last_len > 0 && done + last_len > gen_len)
+			gen_len = done + last_len;
+		done += len;
 	}
 	/*
 	 * Advance starting voice and check for end of signal.
 	 */
+	update_loop(o);
 	for(;;) {
 		VoiceNode *vn;
 		if (o->voice == o->vo_count) {
-			if (o->event != o->ev_count) break;
+			if (o->event != o->ev_count || o->source != NULL)
+				break;
 			/*
 			 * The end.
 			 */
-			check_final_state(o);
+			if (buf != NULL) check_final_state(o);
 			return gen_len;
 		}
 		vn = &o->voices[o->voice];
@@ -489,6 +1115,200 @@ PROCESS:
 	return buf_len;
 }
 
+/**
+ * Main audio generation/processing function. Call repeatedly to write
+ * buf_len new samples into the interleaved stereo buffer buf. Any values
+ * after the end of the signal will be zero'd.
+ *
+ * \return number of samples generated, buf_len unless signal ended
+ */
+size_t SAU_Interp_run(SAU_Interp *restrict o,
+		int16_t *restrict buf, size_t buf_len) {
+	return run_or_skip(o, buf, false, buf_len);
+}
+
+/**
+ * Like SAU_Interp_run(), but writes float samples, clipped
+ * to [-1.0, 1.0], without conversion to 16-bit integers.
+ *
+ * \return number of samples generated, buf_len unless signal ended
+ */
+size_t SAU_Interp_run_f32(SAU_Interp *restrict o,
+		float *restrict buf, size_t buf_len) {
+	return run_or_skip(o, buf, true, buf_len);
+}
+
+/**
+ * Set control command queue to consume from when running,
+ * or NULL for none. Commands are applied at their times,
+ * counted in samples from the start of the program.
+ */
+void SAU_Interp_set_ctl(SAU_Interp *restrict o,
+		SAU_CtlQueue *restrict ctl) {
+	o->ctl = ctl;
+}
+
+/**
+ * Set program source to continue from when all events of the
+ * current program have been handled, or NULL for none. The
+ * source function is called with \p data to get the next
+ * program, and returns NULL at the end. After it's called,
+ * the program from before is no longer used.
+ *
+ * The voice and operator counts of each program must include
+ * those before it, as when converted using the same state.
+ * Amplitude scaling by voice count uses the first program.
+ *
+ * \return true, or false on allocation failure
+ */
+bool SAU_Interp_set_source(SAU_Interp *restrict o,
+		SAU_ProgramSource_f next, void *restrict data) {
+	if (next != NULL && !o->source &&
+			o->ev_count < BUF_LEN) {
+		BlockEvent *block_evs = SAU_MemPool_alloc(o->mem,
+				BUF_LEN * sizeof(BlockEvent));
+		if (!block_evs)
+			return false;
+		o->block_evs = block_evs;
+	}
+	o->source = next;
+	o->source_data = data;
+	return true;
+}
+
+/**
+ * Get the current time, counted in samples from the start
+ * of the program, including time skipped.
+ *
+ * \return time in samples
+ */
+uint64_t SAU_Interp_time(const SAU_Interp *restrict o) {
+	return o->time;
+}
+
+/**
+ * Skip ahead \p time_ms milliseconds, handling events and advancing
+ * ramp positions and oscillator phases without generating audio.
+ * Audio generated by SAU_Interp_run() afterwards is the same as for
+ * the same span of time in an uninterrupted run.
+ *
+ * \return number of samples skipped, less than the time
+ *         given if the signal ended
+ */
+size_t SAU_Interp_seek(SAU_Interp *restrict o, uint32_t time_ms) {
+	uint64_t time = ((uint64_t) time_ms * o->srate) / 1000;
+	size_t skip_len = 0;
+	while (time > 0) {
+		uint32_t len = (time > UINT32_MAX) ? UINT32_MAX : time;
+		size_t last_len = run_or_skip(o, NULL, false, len);
+		skip_len += last_len;
+		if (last_len < len) break;
+		time -= len;
+	}
+	return skip_len;
+}
+
+/**
+ * Skip ahead \p len samples, like SAU_Interp_seek()
+ * but with the time given as a sample count.
+ *
+ * \return number of samples skipped, len unless signal ended
+ */
+size_t SAU_Interp_skip(SAU_Interp *restrict o, size_t len) {
+	return run_or_skip(o, NULL, false, len);
+}
+
+/**
+ * Save a copy of the current state of the instance, for restoring
+ * it in the same or another instance for the same program and
+ * sample rate. Running from a restored state gives the same audio
+ * as running on from where it was saved.
+ *
+ * Not supported while a program source is set.
+ *
+ * \return instance or NULL on error
+ */
+SAU_InterpState *SAU_Interp_save(const SAU_Interp *restrict o) {
+	if (o->source != NULL)
+		return NULL;
+	SAU_MemPool *mem = SAU_create_MemPool(0);
+	if (!mem)
+		return NULL;
+	SAU_InterpState *s = SAU_MemPool_alloc(mem, sizeof(SAU_InterpState));
+	if (!s) goto ERROR;
+	s->mem = mem;
+	s->prg = o->prg;
+	s->srate = o->srate;
+	s->event = o->event;
+	s->event_pos = o->event_pos;
+	s->loop = o->loop;
+	s->repeats = o->repeats;
+	s->voice = o->voice;
+	s->vo_end = o->vo_end;
+	s->vo_count = o->vo_count;
+	s->op_count = o->op_count;
+	s->mix_scale = o->mixer->scale;
+	s->time = o->time;
+	if (o->vo_count > 0) {
+		s->voices = SAU_MemPool_memdup(mem, o->voices,
+				o->vo_count * sizeof(VoiceNode));
+		if (!s->voices) goto ERROR;
+	}
+	if (o->op_count > 0) {
+		s->operators = SAU_MemPool_memdup(mem, o->operators,
+				o->op_count * sizeof(OperatorNode));
+		if (!s->operators) goto ERROR;
+		s->op_params = SAU_MemPool_memdup(mem, o->op_params,
+				o->op_count * sizeof(OperatorParams));
+		if (!s->op_params) goto ERROR;
+	}
+	return s;
+ERROR:
+	SAU_destroy_MemPool(mem);
+	return NULL;
+}
+
+/**
+ * Restore state saved using SAU_Interp_save(). Fails if the
+ * state is for a different program or sample rate.
+ *
+ * \return true unless the state doesn't match the instance
+ */
+bool SAU_Interp_restore(SAU_Interp *restrict o,
+		const SAU_InterpState *restrict s) {
+	if (s->prg != o->prg || s->srate != o->srate ||
+			s->vo_count != o->vo_count ||
+			s->op_count != o->op_count)
+		return false;
+	o->event = s->event;
+	o->event_pos = s->event_pos;
+	o->loop = s->loop;
+	o->repeats = s->repeats;
+	o->voice = s->voice;
+	o->vo_end = s->vo_end;
+	o->mixer->scale = s->mix_scale;
+	o->time = s->time;
+	if (o->vo_count > 0)
+		memcpy(o->voices, s->voices,
+				o->vo_count * sizeof(VoiceNode));
+	if (o->op_count > 0) {
+		memcpy(o->operators, s->operators,
+				o->op_count * sizeof(OperatorNode));
+		memcpy(o->op_params, s->op_params,
+				o->op_count * sizeof(OperatorParams));
+	}
+	return true;
+}
+
+/**
+ * Destroy saved state.
+ */
+void SAU_destroy_InterpState(SAU_InterpState *restrict o) {
+	if (!o)
+		return;
+	SAU_destroy_MemPool(o->mem);
+}
+
 static void print_graph(const SAU_ProgramOpRef *restrict graph,
 		uint32_t count) {
 	static const char *const uses[SAU_POP_USES] = {
@@ -523,12 +1343,23 @@ static void print_graph(const SAU_ProgramOpRef *restrict graph,
  */
 void SAU_Interp_print(const SAU_Interp *restrict o) {
 	SAU_Program_print_info(o->prg, "Program: \"", "\"");
+	fprintf(stdout,
+		"\tBuffers:  \t%d (%zd bytes)\n",
+		o->buf_count, o->buf_count * sizeof(Buf));
+	size_t loop_id = 0;
 	for (size_t ev_id = 0; ev_id < o->ev_count; ++ev_id) {
-		const EventNode *ev = o->events[ev_id];
+		const EventNode *ev = &o->events[ev_id];
 		const SAU_ProgramEvent *prg_ev = ev->prg_e;
 		const SAU_ProgramVoData *prg_vd = prg_ev->vo_data;
+		if (loop_id < o->loop_count &&
+				ev_id == o->loops[loop_id].first_ev) {
+			const SAU_ProgramLoop *pl = &o->prg->loops[loop_id];
+			fprintf(stdout,
+				"LOOP x%u \t(period %u ms)\n",
+				pl->count, pl->period_ms);
+		}
 		fprintf(stdout,
-			"\\%d \tEV %zd \t(VO %hd)",
+			"\\%d \tEV %zd \t(VO %u)",
 			prg_ev->wait_ms, ev_id, prg_ev->vo_id);
 		if (prg_vd != NULL) {
 			SAU_ProgramEvent_print_voice(prg_ev);
@@ -537,5 +1368,10 @@ void SAU_Interp_print(const SAU_Interp *restrict o) {
 		}
 		SAU_ProgramEvent_print_operators(prg_ev);
 		putc('\n', stdout);
+		if (loop_id < o->loop_count &&
+				ev_id + 1 == o->loops[loop_id].end_ev) {
+			fputs("END LOOP\n", stdout);
+			++loop_id;
+		}
 	}
 }
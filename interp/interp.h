@@ -16,12 +16,40 @@
 
 struct SAU_Interp;
 typedef struct SAU_Interp SAU_Interp;
+struct SAU_InterpState;
+typedef struct SAU_InterpState SAU_InterpState;
+struct SAU_CtlQueue;
 
 SAU_Interp* SAU_create_Interp(const SAU_Program *restrict prg,
-		uint32_t srate) sauMalloclike;
+		uint32_t srate, const float *restrict args) sauMalloclike;
 void SAU_destroy_Interp(SAU_Interp *restrict o);
+bool SAU_Interp_reset(SAU_Interp *restrict o,
+		const SAU_Program *restrict prg, uint32_t srate,
+		const float *restrict args);
 
 size_t SAU_Interp_run(SAU_Interp *restrict o,
 		int16_t *restrict buf, size_t buf_len);
+size_t SAU_Interp_run_f32(SAU_Interp *restrict o,
+		float *restrict buf, size_t buf_len);
+size_t SAU_Interp_seek(SAU_Interp *restrict o, uint32_t time_ms);
+size_t SAU_Interp_skip(SAU_Interp *restrict o, size_t len);
+
+void SAU_Interp_set_ctl(SAU_Interp *restrict o,
+		struct SAU_CtlQueue *restrict ctl);
+
+/**
+ * Function returning the next program to continue with.
+ */
+typedef const SAU_Program *(*SAU_ProgramSource_f)(void *restrict data);
+
+bool SAU_Interp_set_source(SAU_Interp *restrict o,
+		SAU_ProgramSource_f next, void *restrict data);
+uint64_t SAU_Interp_time(const SAU_Interp *restrict o);
+
+SAU_InterpState *SAU_Interp_save(const SAU_Interp *restrict o)
+	sauMalloclike;
+bool SAU_Interp_restore(SAU_Interp *restrict o,
+		const SAU_InterpState *restrict s);
+void SAU_destroy_InterpState(SAU_InterpState *restrict o);
 
 void SAU_Interp_print(const SAU_Interp *restrict o);
@@ -59,27 +59,30 @@ void SAU_Mixer_clear(SAU_Mixer *restrict o) {
 
 /**
  * Add \p len samples from \p buf into the mix buffers,
- * using \p pan for panning and scaling each sample.
+ * starting at position \p pos in them, using \p pan
+ * for panning and scaling each sample.
  *
  * Sample rate needs to be set if \p pan has curve enabled.
  */
-void SAU_Mixer_add(SAU_Mixer *restrict o,
+void SAU_Mixer_add(SAU_Mixer *restrict o, size_t pos,
 		float *restrict buf, size_t len,
 		SAU_Ramp *restrict pan, uint32_t *restrict pan_pos) {
+	float *mix_l = o->mix_l + pos;
+	float *mix_r = o->mix_r + pos;
 	if (pan->flags & SAU_RAMPP_GOAL) {
 		SAU_Ramp_run(pan, pan_pos, o->pan_buf, len, o->srate, NULL);
 		for (size_t i = 0; i < len; ++i) {
 			float s = buf[i] * o->scale;
 			float s_r = s * o->pan_buf[i];
-			o->mix_l[i] += s - s_r;
-			o->mix_r[i] += s + s_r;
+			mix_l[i] += s - s_r;
+			mix_r[i] += s + s_r;
 		}
 	} else {
 		for (size_t i = 0; i < len; ++i) {
 			float s = buf[i] * o->scale;
 			float s_r = s * pan->v0;
-			o->mix_l[i] += s - s_r;
-			o->mix_r[i] += s + s_r;
+			mix_l[i] += s - s_r;
+			mix_r[i] += s + s_r;
 		}
 	}
 }
@@ -102,3 +105,23 @@ void SAU_Mixer_write(SAU_Mixer *restrict o,
 		*(*spp)++ += lrintf(s_r * (float) INT16_MAX);
 	}
 }
+
+/**
+ * Write \p len samples from the mix buffers
+ * into a float stereo (interleaved) buffer
+ * pointed to by \p spp, clipped to [-1.0, 1.0].
+ * Advances \p spp.
+ */
+void SAU_Mixer_write_f32(SAU_Mixer *restrict o,
+		float **restrict spp, size_t len) {
+	for (size_t i = 0; i < len; ++i) {
+		float s_l = o->mix_l[i];
+		float s_r = o->mix_r[i];
+		if (s_l > 1.f) s_l = 1.f;
+		else if (s_l < -1.f) s_l = -1.f;
+		if (s_r > 1.f) s_r = 1.f;
+		else if (s_r < -1.f) s_r = -1.f;
+		*(*spp)++ += s_l;
+		*(*spp)++ += s_r;
+	}
+}
@@ -41,8 +41,10 @@ static inline void SAU_Mixer_set_scale(SAU_Mixer *restrict o, float scale) {
 }
 
 void SAU_Mixer_clear(SAU_Mixer *restrict o);
-void SAU_Mixer_add(SAU_Mixer *restrict o,
+void SAU_Mixer_add(SAU_Mixer *restrict o, size_t pos,
 		float *restrict buf, size_t len,
 		SAU_Ramp *restrict pan, uint32_t *restrict pan_pos);
 void SAU_Mixer_write(SAU_Mixer *restrict o,
 		int16_t **restrict spp, size_t len);
+void SAU_Mixer_write_f32(SAU_Mixer *restrict o,
+		float **restrict spp, size_t len);
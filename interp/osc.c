@@ -71,3 +71,16 @@ void SAU_Osc_run_env(SAU_Osc *restrict o,
 		buf[i] = s;
 	}
 }
+
+/**
+ * Advance phase for \p buf_len samples, without generating
+ * output. Gives the same phase as SAU_Osc_run() and
+ * SAU_Osc_run_env(), which PM input does not affect.
+ */
+void SAU_Osc_skip(SAU_Osc *restrict o, size_t buf_len,
+		const float *restrict freq) {
+	uint32_t phase = o->phase;
+	for (size_t i = 0; i < buf_len; ++i)
+		phase += lrintf(o->coeff * freq[i]);
+	o->phase = phase;
+}
@@ -99,6 +99,15 @@ static inline float SAU_Osc_get(SAU_Osc *restrict o,
 	return s;
 }
 
+/**
+ * Advance phase for \p len samples at fixed \p freq, without
+ * generating output. Gives the same phase as SAU_Osc_run().
+ */
+static inline void SAU_Osc_skip_fixed(SAU_Osc *restrict o,
+		uint32_t len, float freq) {
+	o->phase += (uint32_t) lrintf(o->coeff * freq) * len;
+}
+
 void SAU_Osc_run(SAU_Osc *restrict o,
 		float *restrict buf, size_t buf_len,
 		uint32_t layer,
@@ -111,3 +120,5 @@ void SAU_Osc_run_env(SAU_Osc *restrict o,
 		const float *restrict freq,
 		const float *restrict amp,
 		const float *restrict pm_f);
+void SAU_Osc_skip(SAU_Osc *restrict o, size_t buf_len,
+		const float *restrict freq);
@@ -13,27 +13,38 @@
 
 #include "prealloc.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 /*
  * Voice graph traverser and data allocator.
  */
 
 static bool traverse_op_node(SAU_PreAlloc *restrict o,
-		SAU_ProgramOpRef *restrict op_ref);
+		SAU_ProgramOpRef *restrict op_ref,
+		uint32_t *restrict buf_count);
 
 /*
  * Traverse operator list, as part of building a graph for the voice.
  *
+ * The operators in a list share an output buffer, and use
+ * the same buffers after it, so \p buf_count is set to the
+ * maximum number needed for any one of them.
+ *
  * \return true, or false on allocation failure
  */
 static bool traverse_op_list(SAU_PreAlloc *restrict o,
-		const SAU_ProgramOpList *restrict op_list, uint8_t mod_use) {
+		const SAU_ProgramOpList *restrict op_list, uint8_t mod_use,
+		uint32_t *restrict buf_count) {
 	SAU_ProgramOpRef op_ref = {0, mod_use, o->vg.nest_level};
+	uint32_t max_count = 0;
 	for (uint32_t i = 0; i < op_list->count; ++i) {
+		uint32_t count;
 		op_ref.id = op_list->ids[i];
-		if (!traverse_op_node(o, &op_ref))
+		if (!traverse_op_node(o, &op_ref, &count))
 			return false;
+		if (count > max_count) max_count = count;
 	}
+	*buf_count = max_count;
 	return true;
 }
 
@@ -41,15 +52,25 @@ static bool traverse_op_list(SAU_PreAlloc *restrict o,
  * Traverse parts of voice operator graph reached from operator node,
  * adding reference after traversal of modulator lists.
  *
+ * Also counts the buffers live at most at a time while running the
+ * operator, set in \p buf_count. This follows the buffer layout used
+ * by the interpreter: output and frequency buffers first, then the
+ * modulator output for each list and the buffers it's combined with,
+ * keeping only the phase modulation buffer after its use.
+ *
  * \return true, or false on allocation failure
  */
 static bool traverse_op_node(SAU_PreAlloc *restrict o,
-		SAU_ProgramOpRef *restrict op_ref) {
+		SAU_ProgramOpRef *restrict op_ref,
+		uint32_t *restrict buf_count) {
 	OperatorNode *on = &o->operators[op_ref->id];
+	const OperatorParams *op = &o->op_params[op_ref->id];
+	uint32_t count, max_count;
 	if (on->flags & ON_VISITED) {
 		SAU_warning("voicegraph",
 "skipping operator %d; circular references unsupported",
 			op_ref->id);
+		*buf_count = 1; /* output zero-filled */
 		return true;
 	}
 	if (o->vg.nest_level > o->vg.nest_max) {
@@ -57,16 +78,32 @@ static bool traverse_op_node(SAU_PreAlloc *restrict o,
 	}
 	++o->vg.nest_level;
 	on->flags |= ON_VISITED;
-	if (!traverse_op_list(o, on->fmods, SAU_POP_FMOD))
+	uint32_t used = 2; /* output and frequency */
+	max_count = used + 1; /* amplitude */
+	if (!traverse_op_list(o, op->fmods, SAU_POP_FMOD, &count))
 		return false;
-	if (!traverse_op_list(o, on->pmods, SAU_POP_PMOD))
+	if (op->fmods->count > 0) {
+		if (count < 2) count = 2; /* FM output and freq2 */
+		if (used + count > max_count) max_count = used + count;
+	}
+	if (!traverse_op_list(o, op->pmods, SAU_POP_PMOD, &count))
 		return false;
-	if (!traverse_op_list(o, on->amods, SAU_POP_AMOD))
+	if (op->pmods->count > 0) {
+		if (used + count > max_count) max_count = used + count;
+		++used; /* PM output kept */
+		if (used + 1 > max_count) max_count = used + 1;
+	}
+	if (!traverse_op_list(o, op->amods, SAU_POP_AMOD, &count))
 		return false;
+	if (op->amods->count > 0) {
+		if (count < 3) count = 3; /* AM output, amp, and amp2 */
+		if (used + count > max_count) max_count = used + count;
+	}
 	on->flags &= ~ON_VISITED;
 	--o->vg.nest_level;
 	if (!SAU_OpRefArr_add(&o->vg.vo_graph, op_ref))
 		return false;
+	*buf_count = max_count;
 	return true;
 }
 
@@ -80,9 +117,12 @@ static bool traverse_op_node(SAU_PreAlloc *restrict o,
 static bool set_voice_graph(SAU_PreAlloc *restrict o,
 		const SAU_ProgramVoData *restrict pvd,
 		EventNode *restrict ev) {
+	uint32_t buf_count;
 	if (!pvd->carriers->count) goto DONE;
-	if (!traverse_op_list(o, pvd->carriers, SAU_POP_CARR))
+	if (!traverse_op_list(o, pvd->carriers, SAU_POP_CARR, &buf_count))
 		return false;
+	if (buf_count > o->vg.buf_max)
+		o->vg.buf_max = buf_count;
 	if (!SAU_OpRefArr_mpmemdup(&o->vg.vo_graph,
 				(SAU_ProgramOpRef**) &ev->graph, o->mem))
 		return false;
@@ -96,9 +136,6 @@ DONE:
  * Main interpreter pre-allocation code.
  */
 
-// maximum number of buffers needed for op nesting depth
-#define COUNT_BUFS(op_nest_depth) ((1 + (op_nest_depth)) * 7)
-
 static void init_operators(SAU_PreAlloc *restrict o) {
 	for (size_t i = 0; i < o->prg->op_count; ++i) {
 		OperatorNode *on = &o->operators[i];
@@ -106,39 +143,154 @@ static void init_operators(SAU_PreAlloc *restrict o) {
 	}
 }
 
+/*
+ * Check whether the event only changes its own voice and
+ * operators last placed in that voice by a graph.
+ */
+static bool event_is_local(const EventNode *restrict e,
+		const uint32_t *restrict op_voices) {
+	if (e->vo_id == SAU_PVO_NO_ID)
+		return false;
+	for (size_t i = 0; i < e->op_data_count; ++i) {
+		if (op_voices[e->op_data[i].id] != e->vo_id + 1)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Record voice for operators in graph, in \p op_voices.
+ *
+ * \return true if an operator was already placed in another voice
+ */
+static bool set_op_voices(uint32_t *restrict op_voices,
+		const SAU_ProgramOpRef *restrict graph, uint32_t graph_count,
+		uint32_t vo_id) {
+	bool shared = false;
+	for (uint32_t j = 0; j < graph_count; ++j) {
+		uint32_t *op_vo = &op_voices[graph[j].id];
+		if (*op_vo != 0 && *op_vo != vo_id + 1)
+			shared = true;
+		*op_vo = vo_id + 1;
+	}
+	return shared;
+}
+
+/*
+ * Record voice for operators placed by event, in \p op_voices,
+ * and mark the event for split processing unless local.
+ *
+ * \return true if an operator was already placed in another voice
+ */
+static bool place_event(EventNode *restrict e,
+		uint32_t *restrict op_voices) {
+	bool shared = false;
+	if (e->prg_e->vo_data != NULL)
+		shared = set_op_voices(op_voices,
+				e->graph, e->graph_count, e->vo_id);
+	if (!event_is_local(e, op_voices))
+		e->flags |= EN_SPLIT;
+	return shared;
+}
+
+/*
+ * Fill event nodes, building voice graphs.
+ *
+ * Events are also marked for processing split for all voices at
+ * them, unless local to one voice. If any operator is placed in
+ * more than one voice, all events are marked, as the order such
+ * an operator is run in by the voices then matters. The events
+ * of a loop are checked again as placed after its first run.
+ *
+ * \return true, or false on allocation failure
+ */
 static bool init_events(SAU_PreAlloc *restrict o) {
 	const SAU_Program *prg = o->prg;
-	uint32_t vo_wait_time = 0;
+	uint32_t *op_voices = NULL; /* 1 + voice ID, or 0 if none */
+	bool shared_ops = false;
+	size_t loop = 0;
+	if (o->op_count > 0) {
+		op_voices = calloc(o->op_count, sizeof(uint32_t));
+		if (!op_voices)
+			return false;
+	}
+	for (uint32_t i = 0; i < o->vo_count; ++i) {
+		const VoiceNode *vn = &o->voices[i];
+		if (set_op_voices(op_voices, vn->graph, vn->graph_count, i))
+			shared_ops = true;
+	}
 	for (size_t i = 0; i < prg->ev_count; ++i) {
 		const SAU_ProgramEvent *prg_e = prg->events[i];
-		EventNode *e = SAU_MemPool_alloc(o->mem, sizeof(EventNode));
-		if (!e)
-			return false;
-		uint16_t vo_id = prg_e->vo_id;
+		EventNode *e = &o->events[i];
+		uint32_t vo_id = prg_e->vo_id;
 		e->wait = SAU_MS_IN_SAMPLES(prg_e->wait_ms, o->srate);
-		vo_wait_time += e->wait;
+		e->vo_id = vo_id;
+		e->op_data_count = prg_e->op_data_count;
+		e->op_data = prg_e->op_data;
 		e->prg_e = prg_e;
 		for (size_t i = 0; i < prg_e->op_data_count; ++i) {
 			const SAU_ProgramOpData *od = &prg_e->op_data[i];
-			OperatorNode *on = &o->operators[od->id];
+			OperatorParams *op = &o->op_params[od->id];
 			/*
 			 * Apply linkage updates for use in init traversal.
 			 */
-			on->fmods = od->fmods;
-			on->pmods = od->pmods;
-			on->amods = od->amods;
+			op->fmods = od->fmods;
+			op->pmods = od->pmods;
+			op->amods = od->amods;
 		}
 		if (prg_e->vo_data) {
 			const SAU_ProgramVoData *pvd = prg_e->vo_data;
 			uint32_t params = pvd->params;
 			if (params & SAU_PVOP_GRAPH) {
-				if (!set_voice_graph(o, pvd, e))
+				if (!set_voice_graph(o, pvd, e)) {
+					free(op_voices);
 					return false;
+				}
 			}
-			o->voices[vo_id].pos = -vo_wait_time;
-			vo_wait_time = 0;
 		}
-		o->events[i] = e;
+		if (place_event(e, op_voices))
+			shared_ops = true;
+		if (loop < o->loop_count && i + 1 == o->loops[loop].end_ev) {
+			const LoopNode *l = &o->loops[loop++];
+			for (size_t j = l->first_ev; j < l->end_ev; ++j)
+				if (place_event(&o->events[j], op_voices))
+					shared_ops = true;
+		}
+	}
+	if (shared_ops) {
+		for (size_t i = 0; i < prg->ev_count; ++i)
+			o->events[i].flags |= EN_SPLIT;
+	}
+	free(op_voices);
+	return true;
+}
+
+/*
+ * Fill loop nodes, setting the wait for the first event of
+ * each run after the first.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool init_loops(SAU_PreAlloc *restrict o) {
+	const SAU_Program *prg = o->prg;
+	if (!prg->loop_count)
+		return true;
+	o->loops = SAU_MemPool_alloc(o->mem,
+			prg->loop_count * sizeof(LoopNode));
+	if (!o->loops)
+		return false;
+	o->loop_count = prg->loop_count;
+	for (size_t i = 0; i < prg->loop_count; ++i) {
+		const SAU_ProgramLoop *pl = &prg->loops[i];
+		LoopNode *l = &o->loops[i];
+		uint64_t body_ms = 0;
+		for (size_t j = 1; j < pl->ev_count; ++j)
+			body_ms += prg->events[pl->first_ev + j]->wait_ms;
+		l->first_ev = pl->first_ev;
+		l->end_ev = pl->first_ev + pl->ev_count;
+		l->count = pl->count;
+		l->wait = SAU_MS_IN_SAMPLES((pl->period_ms > body_ms) ?
+				pl->period_ms - body_ms : 0, o->srate);
 	}
 	return true;
 }
@@ -156,11 +308,31 @@ static bool check_validity(SAU_PreAlloc *restrict o) {
 			o->prg->name, o->vg.nest_max, UINT8_MAX);
 		error = true;
 	}
+	if (o->vg.buf_max > UINT16_MAX) {
+		fprintf(stderr,
+"%s: error: operators need %d buffers, maximum is %d buffers\n",
+			o->prg->name, o->vg.buf_max, UINT16_MAX);
+		error = true;
+	}
 	return !error;
 }
 
+/**
+ * Fill in pre-allocation data for program \p prg, allocating
+ * using \p mem.
+ *
+ * If \p from is not NULL, the program continues from a running
+ * state, with the voice and operator nodes given in it used
+ * instead of allocating new. There must then be at least as
+ * many as in the program. Only the events and the data for
+ * them are allocated, and a copy of the operator parameters
+ * for use during allocation.
+ *
+ * \return true, or false on error
+ */
 bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
 		const SAU_Program *restrict prg, uint32_t srate,
+		const SAU_PreAlloc *restrict from,
 		SAU_MemPool *restrict mem) {
 	size_t i;
 	bool error = false;
@@ -171,31 +343,48 @@ bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
 	i = prg->ev_count;
 	if (i > 0) {
 		o->events = SAU_MemPool_alloc(o->mem,
-				i * sizeof(EventNode*));
+				i * sizeof(EventNode));
 		if (!o->events) goto MEM_ERR;
 		o->ev_count = i;
 	}
-	i = prg->op_count;
-	if (i > 0) {
-		o->operators = SAU_MemPool_alloc(o->mem,
-				i * sizeof(OperatorNode));
-		if (!o->operators) goto MEM_ERR;
-		o->op_count = i;
-	}
-	i = prg->vo_count;
-	if (i > 0) {
-		o->voices = SAU_MemPool_alloc(o->mem,
-				i * sizeof(VoiceNode));
-		if (!o->voices) goto MEM_ERR;
-		o->vo_count = i;
+	if (from != NULL) {
+		o->operators = from->operators;
+		o->voices = from->voices;
+		o->op_count = from->op_count;
+		o->vo_count = from->vo_count;
+		i = o->op_count;
+		if (i > 0) {
+			o->op_params = SAU_MemPool_memdup(o->mem,
+					from->op_params,
+					i * sizeof(OperatorParams));
+			if (!o->op_params) goto MEM_ERR;
+		}
+	} else {
+		i = prg->op_count;
+		if (i > 0) {
+			o->operators = SAU_MemPool_alloc(o->mem,
+					i * sizeof(OperatorNode));
+			if (!o->operators) goto MEM_ERR;
+			o->op_params = SAU_MemPool_alloc(o->mem,
+					i * sizeof(OperatorParams));
+			if (!o->op_params) goto MEM_ERR;
+			o->op_count = i;
+		}
+		i = prg->vo_count;
+		if (i > 0) {
+			o->voices = SAU_MemPool_alloc(o->mem,
+					i * sizeof(VoiceNode));
+			if (!o->voices) goto MEM_ERR;
+			o->vo_count = i;
+		}
+		init_operators(o);
 	}
 
-	init_operators(o);
-	if (!init_events(o)) goto MEM_ERR;
+	if (!init_loops(o) || !init_events(o)) goto MEM_ERR;
 	if (!check_validity(o)) {
 		error = true;
 	}
-	o->max_bufs = COUNT_BUFS(o->vg.nest_max);
+	o->max_bufs = o->vg.buf_max;
 	if (false)
 	MEM_ERR: {
 		SAU_error("prealloc", "memory allocation failure");
@@ -25,19 +25,30 @@ enum {
 	ON_TIME_INF = 1<<1, /* used for SAU_TIMEP_LINKED */
 };
 
+/*
+ * Operator state is split in two arrays indexed by operator ID.
+ *
+ * The node holds what changes each block, and what is checked
+ * for operators which are not run (time left). The parameters
+ * hold ramp definitions and modulator lists, mostly changed
+ * only by events, and read only when the operator is run.
+ */
 typedef struct OperatorNode {
 	SAU_Osc osc;
 	uint32_t time;
 	uint32_t silence;
+	uint32_t amp_pos, freq_pos;
+	uint32_t amp2_pos, freq2_pos;
 	uint8_t flags;
+} OperatorNode;
+
+typedef struct OperatorParams {
+	SAU_Ramp amp, freq;
+	SAU_Ramp amp2, freq2;
 	const SAU_ProgramOpList *fmods;
 	const SAU_ProgramOpList *pmods;
 	const SAU_ProgramOpList *amods;
-	SAU_Ramp amp, freq;
-	SAU_Ramp amp2, freq2;
-	uint32_t amp_pos, freq_pos;
-	uint32_t amp2_pos, freq2_pos;
-} OperatorNode;
+} OperatorParams;
 
 /*
  * Voice node flags.
@@ -47,22 +58,51 @@ enum {
 };
 
 typedef struct VoiceNode {
-	int32_t pos; /* negative for wait time */
 	uint32_t duration;
 	uint8_t flags;
+	uint32_t ev_head; /* 1 + index of next event within block, or 0 */
 	const SAU_ProgramOpRef *graph;
 	uint32_t graph_count;
 	SAU_Ramp pan;
 	uint32_t pan_pos;
 } VoiceNode;
 
+/*
+ * Event node flags.
+ */
+enum {
+	EN_SPLIT = 1<<0, /* may affect other voices; split all at it */
+};
+
+/*
+ * Event node, with the program event data used when handling it
+ * copied in. Nodes are stored in one array, read through in order.
+ *
+ * Events which only change their own voice and its operators are
+ * handled by voice within a block, as each voice reaches its time.
+ */
 typedef struct EventNode {
 	uint32_t wait;
+	uint32_t vo_id;
+	uint8_t flags;
+	uint32_t op_data_count;
+	const SAU_ProgramOpData *op_data;
 	uint32_t graph_count;
 	const SAU_ProgramOpRef *graph;
 	const SAU_ProgramEvent *prg_e;
 } EventNode;
 
+/*
+ * Loop over events \a first_ev up to \a end_ev, run \a count times.
+ * For each run after the first, \a wait replaces the wait of the
+ * first event, placing it the loop period after the last run began.
+ */
+typedef struct LoopNode {
+	size_t first_ev, end_ev;
+	uint32_t count;
+	uint32_t wait;
+} LoopNode;
+
 sauArrType(SAU_OpRefArr, SAU_ProgramOpRef, )
 
 /*
@@ -72,6 +112,7 @@ typedef struct SAU_VoiceGraph {
 	SAU_OpRefArr vo_graph;
 	uint32_t nest_level;
 	uint32_t nest_max; // for all traversals
+	uint32_t buf_max; // for all traversals
 } SAU_VoiceGraph;
 
 /*
@@ -82,15 +123,19 @@ typedef struct SAU_PreAlloc {
 	uint32_t srate;
 	size_t ev_count;
 	uint32_t op_count;
-	uint16_t vo_count;
+	uint32_t vo_count;
 	uint16_t max_bufs;
-	EventNode **events;
+	EventNode *events;
+	LoopNode *loops;
+	size_t loop_count;
 	VoiceNode *voices;
 	OperatorNode *operators;
+	OperatorParams *op_params;
 	SAU_MemPool *mem;
 	SAU_VoiceGraph vg;
 } SAU_PreAlloc;
 
 bool SAU_fill_PreAlloc(SAU_PreAlloc *restrict o,
 		const SAU_Program *restrict prg, uint32_t srate,
+		const SAU_PreAlloc *restrict from,
 		SAU_MemPool *restrict mem);
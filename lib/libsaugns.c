@@ -0,0 +1,362 @@
+/* saugns: Library interface for building and rendering scripts.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "libsaugns.h"
+#include "../script.h"
+#include "../interp/interp.h"
+#include "../interp/ctlqueue.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct SAU_LibProgram {
+	SAU_Program *prg;
+};
+
+struct SAU_LibRenderer {
+	SAU_Interp *interp;
+	char *text; // copy of script, used by stream
+	SAU_ProgramStream *stream;
+	SAU_LibCtlQueue *ctl;
+};
+
+struct SAU_LibCtlQueue {
+	SAU_CtlQueue *queue;
+};
+
+/*
+ * Copy script \p text of \p len bytes, which does not
+ * need to be NUL-terminated, into a string.
+ *
+ * \return allocated string or NULL on error
+ */
+static char *copy_script(const char *restrict text, size_t len) {
+	if (!text)
+		return NULL;
+	char *str = malloc(len + 1);
+	if (!str)
+		return NULL;
+	memcpy(str, text, len);
+	str[len] = '\0';
+	return str;
+}
+
+/*
+ * Parse script \p text of \p len bytes,
+ * which does not need to be NUL-terminated.
+ *
+ * \return instance or NULL on error
+ */
+static SAU_Script *load_script(const char *restrict text, size_t len) {
+	char *str = copy_script(text, len);
+	if (!str)
+		return NULL;
+	SAU_Script *sd = SAU_load_Script(str, false, NULL);
+	free(str);
+	return sd;
+}
+
+/**
+ * Build program from script \p text of \p len bytes,
+ * which does not need to be NUL-terminated.
+ *
+ * \return instance or NULL on error
+ */
+SAU_LibProgram *SAU_LibProgram_build(const char *restrict text, size_t len) {
+	SAU_LibProgram *o = calloc(1, sizeof(SAU_LibProgram));
+	if (!o)
+		return NULL;
+	SAU_Script *sd = load_script(text, len);
+	if (!sd) goto ERROR;
+	o->prg = SAU_build_Program(sd);
+	SAU_discard_Script(sd);
+	if (!o->prg) goto ERROR;
+	return o;
+ERROR:
+	free(o);
+	return NULL;
+}
+
+/**
+ * Discard program. Renderers must no longer use it.
+ */
+void SAU_LibProgram_discard(SAU_LibProgram *restrict o) {
+	if (!o)
+		return;
+	SAU_discard_Program(o->prg);
+	free(o);
+}
+
+/**
+ * \return duration of program in milliseconds
+ */
+uint32_t SAU_LibProgram_duration_ms(const SAU_LibProgram *restrict o) {
+	return o->prg->duration_ms;
+}
+
+/**
+ * \return number of script arguments of program
+ */
+uint32_t SAU_LibProgram_arg_count(const SAU_LibProgram *restrict o) {
+	return o->prg->arg_count;
+}
+
+/**
+ * Look up script argument of program by \p name.
+ *
+ * \return index of argument, or -1 if not found
+ */
+int32_t SAU_LibProgram_find_arg(const SAU_LibProgram *restrict o,
+		const char *restrict name) {
+	uint32_t id = SAU_Program_find_arg(o->prg, name);
+	return (id != SAU_PARG_NO_ID) ? (int32_t) id : -1;
+}
+
+/**
+ * Set \p args to the default value of each script argument
+ * of program, as used unless other values are given.
+ */
+void SAU_LibProgram_get_args(const SAU_LibProgram *restrict o,
+		float *restrict args) {
+	for (uint32_t i = 0; i < o->prg->arg_count; ++i)
+		args[i] = o->prg->args[i].def_val;
+}
+
+static pthread_once_t global_init = PTHREAD_ONCE_INIT;
+
+/**
+ * Create renderer for program \p prg at sample rate \p srate.
+ *
+ * If not NULL, \p args holds a value for each script argument
+ * of the program, used instead of the default values. Only the
+ * renderer is affected, so one program may be rendered with any
+ * number of different argument values.
+ *
+ * Renderers are independent of each other, and may be used
+ * from different threads, also sharing programs.
+ *
+ * \return instance or NULL on error
+ */
+SAU_LibRenderer *SAU_create_LibRenderer(const SAU_LibProgram *restrict prg,
+		uint32_t srate, const float *restrict args) {
+	pthread_once(&global_init, SAU_global_init_Wave);
+	SAU_LibRenderer *o = calloc(1, sizeof(SAU_LibRenderer));
+	if (!o)
+		return NULL;
+	o->interp = SAU_create_Interp(prg->prg, srate, args);
+	if (!o->interp) {
+		free(o);
+		return NULL;
+	}
+	return o;
+}
+
+/*
+ * Program source function for stream.
+ */
+static const SAU_Program *next_program(void *restrict data) {
+	return SAU_ProgramStream_next(data);
+}
+
+/*
+ * Stop using stream, if any.
+ */
+static void close_stream(SAU_LibRenderer *restrict o) {
+	SAU_Interp_set_source(o->interp, NULL, NULL);
+	SAU_close_ProgramStream(o->stream);
+	free(o->text);
+	o->stream = NULL;
+	o->text = NULL;
+}
+
+/**
+ * Create renderer for script \p text of \p len bytes at sample
+ * rate \p srate, streaming the program instead of building all
+ * of it first. The script is parsed and converted in a thread,
+ * each \p chunk_len events at a time, kept at most two chunks
+ * ahead of the renderer, so that memory use is bounded by the
+ * chunk length rather than the script length. Voice IDs are
+ * assigned as for a program built at once, and the audio is
+ * the same.
+ *
+ * The script must set the amplitude multiplier before its first
+ * event, as amplitude can't be scaled by the number of voices
+ * when not all are known; creation fails otherwise.
+ *
+ * \return instance or NULL on error
+ */
+SAU_LibRenderer *SAU_create_LibStreamRenderer(const char *restrict text,
+		size_t len, uint32_t srate, size_t chunk_len) {
+	pthread_once(&global_init, SAU_global_init_Wave);
+	SAU_LibRenderer *o = calloc(1, sizeof(SAU_LibRenderer));
+	if (!o)
+		return NULL;
+	const SAU_Program *prg;
+	if (!(o->text = copy_script(text, len)) ||
+			!(o->stream = SAU_open_ProgramStream(o->text,
+					false, NULL, chunk_len)) ||
+			!(prg = SAU_ProgramStream_next(o->stream)) ||
+			!(o->interp = SAU_create_Interp(prg, srate, NULL)) ||
+			!SAU_Interp_set_source(o->interp,
+				next_program, o->stream))
+		goto ERROR;
+	return o;
+ERROR:
+	SAU_destroy_LibRenderer(o);
+	return NULL;
+}
+
+/**
+ * Destroy instance.
+ */
+void SAU_destroy_LibRenderer(SAU_LibRenderer *restrict o) {
+	if (!o)
+		return;
+	SAU_destroy_Interp(o->interp);
+	SAU_close_ProgramStream(o->stream);
+	free(o->text);
+	free(o);
+}
+
+/**
+ * Reset renderer for program \p prg at sample rate \p srate,
+ * with script argument values \p args (or NULL for defaults),
+ * as if newly created, but reusing memory allocated before.
+ * A control queue set is kept, with the time counted anew.
+ *
+ * \return true, or false on failure (instance then only to be
+ *         reset again or destroyed)
+ */
+bool SAU_LibRenderer_reset(SAU_LibRenderer *restrict o,
+		const SAU_LibProgram *restrict prg, uint32_t srate,
+		const float *restrict args) {
+	if (o->stream != NULL)
+		close_stream(o);
+	if (!SAU_Interp_reset(o->interp, prg->prg, srate, args))
+		return false;
+	if (o->ctl != NULL)
+		SAU_Interp_set_ctl(o->interp, o->ctl->queue);
+	return true;
+}
+
+/**
+ * Render up to \p frames frames of audio into \p buf, in the
+ * sample \p format given, with SAU_LIB_CHANNELS interleaved.
+ *
+ * \return number of frames rendered, less than \p frames
+ *         if the signal ended, 0 after the end or for
+ *         an invalid format
+ */
+size_t SAU_LibRenderer_pull(SAU_LibRenderer *restrict o,
+		void *restrict buf, size_t frames, int format) {
+	if (format == SAU_LIB_FMT_S16)
+		return SAU_Interp_run(o->interp, buf, frames);
+	if (format == SAU_LIB_FMT_F32)
+		return SAU_Interp_run_f32(o->interp, buf, frames);
+	return 0;
+}
+
+/**
+ * Skip ahead \p time_ms milliseconds without rendering audio,
+ * as for the audio pulled afterwards to match that time.
+ *
+ * \return number of frames skipped, less than the time
+ *         given if the signal ended
+ */
+size_t SAU_LibRenderer_seek(SAU_LibRenderer *restrict o, uint32_t time_ms) {
+	return SAU_Interp_seek(o->interp, time_ms);
+}
+
+/**
+ * \return time of renderer in frames, counted from the start of the
+ *         program, as used for control commands
+ */
+uint64_t SAU_LibRenderer_time(const SAU_LibRenderer *restrict o) {
+	return SAU_Interp_time(o->interp);
+}
+
+/**
+ * Create control command queue with room for at least \p size
+ * commands, rounded up to a power of two.
+ *
+ * \return instance or NULL on error
+ */
+SAU_LibCtlQueue *SAU_create_LibCtlQueue(uint32_t size) {
+	SAU_LibCtlQueue *o = calloc(1, sizeof(SAU_LibCtlQueue));
+	if (!o)
+		return NULL;
+	o->queue = SAU_create_CtlQueue(size);
+	if (!o->queue) {
+		free(o);
+		return NULL;
+	}
+	return o;
+}
+
+/**
+ * Destroy instance. It must no longer be set for a renderer.
+ */
+void SAU_destroy_LibCtlQueue(SAU_LibCtlQueue *restrict o) {
+	if (!o)
+		return;
+	SAU_destroy_CtlQueue(o->queue);
+	free(o);
+}
+
+/**
+ * Add copy of command to the queue. To be called from only
+ * one thread at a time, which may differ from the one pulling
+ * the renderer.
+ *
+ * \return true, or false if the queue is full or the command
+ *         type or ramp curve is invalid
+ */
+bool SAU_LibCtlQueue_push(SAU_LibCtlQueue *restrict o,
+		const SAU_LibCtl *restrict cmd) {
+	if (cmd->type >= SAU_LIB_CTL_TYPES || cmd->ramp >= SAU_LIB_RAMPS)
+		return false;
+	/* Types and curves are numbered as inside the library. */
+	SAU_CtlCmd ctl = {
+		.time = cmd->time,
+		.id = cmd->id,
+		.type = cmd->type,
+		.time_ms = cmd->time_ms,
+		.value = cmd->value,
+	};
+	if (cmd->type != SAU_LIB_CTL_OP_PHASE &&
+			cmd->type != SAU_LIB_CTL_OP_TIME &&
+			cmd->type != SAU_LIB_CTL_VO_TRIGGER) {
+		if ((cmd->flags & SAU_LIB_CTLF_VALUE) != 0) {
+			ctl.ramp.v0 = cmd->value;
+			ctl.ramp.flags |= SAU_RAMPP_STATE;
+		}
+		if ((cmd->flags & SAU_LIB_CTLF_GOAL) != 0) {
+			ctl.ramp.vt = cmd->goal;
+			ctl.ramp.time_ms = cmd->time_ms;
+			ctl.ramp.type = cmd->ramp;
+			ctl.ramp.flags |= SAU_RAMPP_GOAL;
+		}
+	}
+	return SAU_CtlQueue_push(o->queue, &ctl);
+}
+
+/**
+ * Set control command queue for renderer, or NULL for none.
+ * Commands are applied as the renderer is pulled, each at
+ * the frame of its time. A queue is used by one renderer.
+ */
+void SAU_LibRenderer_set_ctl(SAU_LibRenderer *restrict o,
+		SAU_LibCtlQueue *restrict ctl) {
+	o->ctl = ctl;
+	SAU_Interp_set_ctl(o->interp, (ctl != NULL) ? ctl->queue : NULL);
+}
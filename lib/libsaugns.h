@@ -0,0 +1,153 @@
+/* saugns: Library interface for building and rendering scripts.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Self-contained header for use of the library;
+ * no other headers from the source tree are needed.
+ *
+ * Scripts are only read from memory, and audio only
+ * produced into caller buffers. Errors and warnings
+ * for scripts are still printed to stderr.
+ */
+
+/**
+ * Number of channels in rendered audio, interleaved.
+ */
+#define SAU_LIB_CHANNELS 2
+
+/**
+ * Sample formats for rendered audio.
+ */
+enum {
+	SAU_LIB_FMT_S16 = 0, /* native-endian signed 16-bit integer */
+	SAU_LIB_FMT_F32,     /* native-endian float in [-1.0, 1.0] */
+	SAU_LIB_FORMATS
+};
+
+/**
+ * Program built from a script, usable by any number of renderers.
+ */
+typedef struct SAU_LibProgram SAU_LibProgram;
+
+SAU_LibProgram *SAU_LibProgram_build(const char *restrict text, size_t len);
+void SAU_LibProgram_discard(SAU_LibProgram *restrict o);
+uint32_t SAU_LibProgram_duration_ms(const SAU_LibProgram *restrict o);
+uint32_t SAU_LibProgram_arg_count(const SAU_LibProgram *restrict o);
+int32_t SAU_LibProgram_find_arg(const SAU_LibProgram *restrict o,
+		const char *restrict name);
+void SAU_LibProgram_get_args(const SAU_LibProgram *restrict o,
+		float *restrict args);
+
+/**
+ * Renderer for one program at a time, pulled for audio.
+ */
+typedef struct SAU_LibRenderer SAU_LibRenderer;
+
+SAU_LibRenderer *SAU_create_LibRenderer(const SAU_LibProgram *restrict prg,
+		uint32_t srate, const float *restrict args);
+SAU_LibRenderer *SAU_create_LibStreamRenderer(const char *restrict text,
+		size_t len, uint32_t srate, size_t chunk_len);
+void SAU_destroy_LibRenderer(SAU_LibRenderer *restrict o);
+bool SAU_LibRenderer_reset(SAU_LibRenderer *restrict o,
+		const SAU_LibProgram *restrict prg, uint32_t srate,
+		const float *restrict args);
+size_t SAU_LibRenderer_pull(SAU_LibRenderer *restrict o,
+		void *restrict buf, size_t frames, int format);
+size_t SAU_LibRenderer_seek(SAU_LibRenderer *restrict o, uint32_t time_ms);
+uint64_t SAU_LibRenderer_time(const SAU_LibRenderer *restrict o);
+
+/**
+ * Control command types, for changing what a renderer plays.
+ */
+enum {
+	SAU_LIB_CTL_OP_AMP = 0, /* operator amplitude, ramp */
+	SAU_LIB_CTL_OP_AMP2,    /* operator amplitude, modulated to, ramp */
+	SAU_LIB_CTL_OP_FREQ,    /* operator frequency, ramp */
+	SAU_LIB_CTL_OP_FREQ2,   /* operator frequency, modulated to, ramp */
+	SAU_LIB_CTL_OP_PHASE,   /* operator phase, value */
+	SAU_LIB_CTL_OP_TIME,    /* operator time, time_ms from when applied */
+	SAU_LIB_CTL_VO_PAN,     /* voice panning, ramp */
+	SAU_LIB_CTL_VO_TRIGGER, /* (re)start voice, as for an event for it */
+	SAU_LIB_CTL_TYPES
+};
+
+/**
+ * Ramp curves for control command goals.
+ */
+enum {
+	SAU_LIB_RAMP_HOLD = 0,
+	SAU_LIB_RAMP_LIN,
+	SAU_LIB_RAMP_EXP,
+	SAU_LIB_RAMP_LOG,
+	SAU_LIB_RAMP_ESD,
+	SAU_LIB_RAMP_LSD,
+	SAU_LIB_RAMPS
+};
+
+/**
+ * Flags for what a ramp control command sets.
+ */
+enum {
+	SAU_LIB_CTLF_VALUE = 1<<0, /* jump to value */
+	SAU_LIB_CTLF_GOAL  = 1<<1, /* ramp to goal over time_ms */
+};
+
+/**
+ * Control command, applied to a renderer at the exact frame given
+ * by \a time, counted from the start of the program. A command for
+ * a time already passed is applied at the start of the next pull.
+ *
+ * The \a id is an operator or voice ID of the program, as listed
+ * by "saugns -p". Operator IDs are only unique among operators
+ * playing at the same time. An ID may be reused for a later
+ * operator in the same voice, once the voice is reused after
+ * the operator ended, and a command then applies to whichever
+ * operator has the ID at its time. IDs outside the program
+ * are ignored.
+ *
+ * For ramp types, \a flags select setting \a value and/or
+ * ramping to \a goal in \a time_ms using curve \a ramp. For
+ * phase, \a value is used (0.0 = 0 deg., 1.0 = 360 deg.),
+ * and for operator time, \a time_ms.
+ */
+typedef struct SAU_LibCtl {
+	uint64_t time;
+	uint32_t id;
+	uint8_t type;
+	uint8_t flags;
+	uint8_t ramp;
+	uint32_t time_ms;
+	float value;
+	float goal;
+} SAU_LibCtl;
+
+/**
+ * Queue of control commands for a renderer, bounded in size.
+ *
+ * Commands may be pushed from one thread while the renderer is
+ * pulled from another, without locking, and are applied in the
+ * order pushed, so times should not decrease.
+ */
+typedef struct SAU_LibCtlQueue SAU_LibCtlQueue;
+
+SAU_LibCtlQueue *SAU_create_LibCtlQueue(uint32_t size);
+void SAU_destroy_LibCtlQueue(SAU_LibCtlQueue *restrict o);
+bool SAU_LibCtlQueue_push(SAU_LibCtlQueue *restrict o,
+		const SAU_LibCtl *restrict cmd);
+void SAU_LibRenderer_set_ctl(SAU_LibRenderer *restrict o,
+		SAU_LibCtlQueue *restrict ctl);
@@ -29,18 +29,29 @@
 
 #define DEFAULT_START_SIZE 512
 
+#ifndef SAU_MEMPOOL_STATS
+/*
+ * Count allocations for testing?
+ */
+# define SAU_MEMPOOL_STATS 0
+#endif
+
 #define ALIGN_BYTES      sizeof(void*)
 #define ALIGN_SIZE(size) (((size) + (ALIGN_BYTES - 1)) & ~(ALIGN_BYTES - 1))
 
 typedef struct MemBlock {
 	size_t free;
 	char *mem;
+	size_t size;
 } MemBlock;
 
 struct SAU_MemPool {
 	MemBlock *a;
 	size_t count, first_i, alloc_len;
 	size_t block_size, skip_size;
+#if SAU_MEMPOOL_STATS
+	size_t alloc_count, alloc_bytes;
+#endif
 };
 
 /*
@@ -90,6 +101,7 @@ static void *add(SAU_MemPool *restrict o, size_t size_used) {
 	size_t i = o->count++;
 	o->a[i].free = block_size - size_used;
 	o->a[i].mem = mem;
+	o->a[i].size = block_size;
 	/*
 	 * Skip fully used blocks in binary searches.
 	 */
@@ -168,6 +180,15 @@ static void copy_up_one(SAU_MemPool *restrict o,
 		o->a[higher_from] = o->a[from];
 	}
 }
+
+/*
+ * Compare blocks by free space, for sorting.
+ */
+static int cmp_free(const void *restrict _a, const void *restrict _b) {
+	const MemBlock *a = _a, *b = _b;
+	if (a->free < b->free) return -1;
+	return (a->free > b->free);
+}
 #endif
 
 /**
@@ -212,6 +233,44 @@ void SAU_destroy_MemPool(SAU_MemPool *restrict o) {
 	free(o);
 }
 
+/**
+ * Clear instance, making all memory free for new allocations
+ * while keeping the memory blocks. Memory allocated before
+ * must no longer be used.
+ */
+void SAU_MemPool_clear(SAU_MemPool *restrict o) {
+#if !SAU_MEM_DEBUG
+	for (size_t i = 0; i < o->count; ++i) {
+		MemBlock *b = &o->a[i];
+		/* used memory is at the end of each block */
+		memset(b->mem + b->free, 0, b->size - b->free);
+		b->free = b->size;
+	}
+	qsort(o->a, o->count, sizeof(MemBlock), cmp_free);
+	o->first_i = 0;
+#else /* SAU_MEM_DEBUG */
+	for (size_t i = 0; i < o->count; ++i) {
+		free(o->a[i].mem);
+	}
+	o->count = 0;
+#endif
+}
+
+/**
+ * Get usage counts for the memory pool.
+ */
+void SAU_MemPool_get_stats(const SAU_MemPool *restrict o,
+		SAU_MemPoolStats *restrict stats) {
+#if SAU_MEMPOOL_STATS
+	stats->allocs = o->alloc_count;
+	stats->bytes = o->alloc_bytes;
+#else
+	stats->allocs = 0;
+	stats->bytes = 0;
+#endif
+	stats->blocks = o->count;
+}
+
 /**
  * Allocate block of \p size within the memory pool,
  * initialized to zero bytes.
@@ -262,6 +321,10 @@ void *SAU_MemPool_alloc(SAU_MemPool *restrict o, size_t size) {
 			o->a[i].free = i_free;
 		}
 	}
+#if SAU_MEMPOOL_STATS
+	++o->alloc_count;
+	o->alloc_bytes += size;
+#endif
 	return mem;
 #else /* SAU_MEM_DEBUG */
 	if (o->count == o->alloc_len && !upsize(o))
@@ -270,6 +333,10 @@ void *SAU_MemPool_alloc(SAU_MemPool *restrict o, size_t size) {
 	if (!mem)
 		return NULL;
 	o->a[o->count++].mem = mem;
+#if SAU_MEMPOOL_STATS
+	++o->alloc_count;
+	o->alloc_bytes += size;
+#endif
 	return mem;
 #endif
 }
@@ -23,6 +23,21 @@ typedef struct SAU_MemPool SAU_MemPool;
 
 SAU_MemPool *SAU_create_MemPool(size_t start_size) sauMalloclike;
 void SAU_destroy_MemPool(SAU_MemPool *restrict o);
+void SAU_MemPool_clear(SAU_MemPool *restrict o);
+
+/**
+ * Usage counts for a memory pool, totalled since creation.
+ * Allocations are only counted if built with SAU_MEMPOOL_STATS,
+ * otherwise those counts are zero.
+ */
+typedef struct SAU_MemPoolStats {
+	size_t allocs; // number of allocations made
+	size_t bytes; // bytes allocated, after alignment
+	size_t blocks; // memory blocks held
+} SAU_MemPoolStats;
+
+void SAU_MemPool_get_stats(const SAU_MemPool *restrict o,
+		SAU_MemPoolStats *restrict stats);
 
 void *SAU_MemPool_alloc(SAU_MemPool *restrict o, size_t size) sauMalloclike;
 void *SAU_MemPool_memdup(SAU_MemPool *restrict o,
@@ -11,24 +11,60 @@
  * <https://www.gnu.org/licenses/>.
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include "../saugns.h"
 #include "../interp/interp.h"
 #include "audiodev.h"
 #include "wavfile.h"
+#include "watch.h"
 #include "../time.h"
+#include "../math.h"
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
 
 #define BUF_TIME_MS  256
 #define CH_MIN_LEN   1
 #define NUM_CHANNELS 2
+#define SEG_CHUNKS   16 /* length of segments rendered in parallel */
+#define FADE_MS      20 /* crossfade time for swapping in changed program */
+#define REBUILD_MS   10 /* wait between checks when idle and rebuilding */
+#define IDLE_MS      250 /* wait between checks for stop when idle */
+
+/*
+ * Time segment of audio, rendered in a separate thread
+ * from interpreter state saved at its start.
+ *
+ * The interpreter and buffer are kept for further segments.
+ */
+typedef struct SAU_Segment {
+	const SAU_Program *prg;
+	uint32_t srate;
+	const float *args;
+	SAU_InterpState *state;
+	SAU_Interp *gen;
+	const SAU_Program *gen_prg;
+	uint32_t gen_srate;
+	int16_t *buf;
+	size_t buf_len, len;
+	bool error;
+	pthread_t thread;
+} SAU_Segment;
 
 typedef struct SAU_Output {
 	SAU_AudioDev *ad;
 	SAU_WAVFile *wf;
 	int16_t *buf;
 	uint32_t options;
+	uint32_t start_ms;
+	uint32_t threads;
 	size_t buf_len;
 	size_t ch_len;
+	const SAU_PtrArr *arg_defs;
+	float *args; /* for current program, or NULL */
+	SAU_Interp *gen;
+	SAU_Segment *segs;
 } SAU_Output;
 
 /*
@@ -36,6 +72,15 @@ typedef struct SAU_Output {
  */
 static bool SAU_fini_Output(SAU_Output *restrict o) {
 	free(o->buf);
+	free(o->args);
+	SAU_destroy_Interp(o->gen);
+	if (o->segs != NULL) {
+		for (uint32_t i = 0; i < o->threads; ++i) {
+			SAU_destroy_Interp(o->segs[i].gen);
+			free(o->segs[i].buf);
+		}
+		free(o->segs);
+	}
 	if (o->ad != NULL) SAU_close_AudioDev(o->ad);
 	if (o->wf != NULL)
 		return (SAU_close_WAVFile(o->wf) == 0);
@@ -81,53 +126,282 @@ ERROR:
 	return SAU_fini_Output(o);
 }
 
+/*
+ * Write \p len samples from \p buf to the outputs enabled.
+ *
+ * \return true unless error occurred
+ */
+static bool SAU_Output_write(SAU_Output *restrict o,
+		const int16_t *restrict buf, size_t len,
+		bool use_audiodev, bool use_wavfile) {
+	bool error = false;
+	if (use_audiodev && !SAU_AudioDev_write(o->ad, buf, len)) {
+		error = true;
+		SAU_error(NULL, "audio device write failed");
+	}
+	if (use_wavfile && !SAU_WAVFile_write(o->wf, buf, len)) {
+		error = true;
+		SAU_error(NULL, "WAV file write failed");
+	}
+	return !error;
+}
+
+/*
+ * Run \p gen until the end of the signal.
+ *
+ * \return true unless error occurred
+ */
+static bool SAU_Output_run_serial(SAU_Output *restrict o,
+		SAU_Interp *restrict gen,
+		bool use_audiodev, bool use_wavfile) {
+	bool error = false;
+	for (;;) {
+		size_t len = SAU_Interp_run(gen, o->buf, o->ch_len);
+		if (!len) break;
+		if (!SAU_Output_write(o, o->buf, len,
+					use_audiodev, use_wavfile))
+			error = true;
+	}
+	return !error;
+}
+
+/*
+ * Get the script argument values to use for program \p prg,
+ * from the "name=value" strings of \p arg_defs, setting \p argsp
+ * to a new array of them, or NULL if none are set. Names not found
+ * among the arguments of the program are warned about.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool get_args(const SAU_PtrArr *restrict arg_defs,
+		const SAU_Program *restrict prg, float **restrict argsp) {
+	float *args = NULL;
+	*argsp = NULL;
+	if (!arg_defs || !arg_defs->count)
+		return true;
+	if (prg->arg_count > 0) {
+		args = malloc(sizeof(float) * prg->arg_count);
+		if (!args) {
+			SAU_error(NULL, "memory allocation failure");
+			return false;
+		}
+		for (uint32_t i = 0; i < prg->arg_count; ++i)
+			args[i] = prg->args[i].def_val;
+	}
+	const char **defs = (const char**) SAU_PtrArr_ITEMS(arg_defs);
+	for (size_t i = 0; i < arg_defs->count; ++i) {
+		const char *def = defs[i];
+		size_t len = strcspn(def, "=");
+		uint32_t id = 0;
+		while (id < prg->arg_count &&
+				(strncmp(prg->args[id].name, def, len) ||
+				 prg->args[id].name[len] != '\0'))
+			++id;
+		if (id == prg->arg_count) {
+			SAU_warning(NULL, "script \"%s\" has no argument \"%.*s\"",
+					prg->name, (int) len, def);
+			continue;
+		}
+		args[id] = strtod(def + len + 1, NULL);
+	}
+	*argsp = args;
+	return true;
+}
+
+/*
+ * Set the script argument values to use for program \p prg,
+ * from the "name=value" strings of o->arg_defs.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool SAU_Output_set_args(SAU_Output *restrict o,
+		const SAU_Program *restrict prg) {
+	free(o->args);
+	return get_args(o->arg_defs, prg, &o->args);
+}
+
+/*
+ * Get interpreter for program \p prg at \p srate, reusing
+ * the previous one kept in \p o if any. The argument values
+ * set for the program are used.
+ *
+ * \return instance or NULL on error
+ */
+static SAU_Interp *SAU_Output_get_interp(SAU_Output *restrict o,
+		const SAU_Program *restrict prg, uint32_t srate) {
+	if (!o->gen) {
+		o->gen = SAU_create_Interp(prg, srate, o->args);
+	} else if (!SAU_Interp_reset(o->gen, prg, srate, o->args)) {
+		SAU_destroy_Interp(o->gen);
+		o->gen = NULL;
+	}
+	return o->gen;
+}
+
+/*
+ * Thread function for rendering a segment.
+ *
+ * The interpreter of the segment is only reset when the
+ * program or sample rate differs from the previous use.
+ * (The argument values used are set per program.)
+ */
+static void *render_segment(void *restrict arg) {
+	SAU_Segment *seg = arg;
+	seg->len = 0;
+	if (!seg->gen) {
+		seg->gen = SAU_create_Interp(seg->prg, seg->srate, seg->args);
+	} else if (seg->gen_prg != seg->prg || seg->gen_srate != seg->srate) {
+		if (!SAU_Interp_reset(seg->gen, seg->prg, seg->srate,
+					seg->args)) {
+			SAU_destroy_Interp(seg->gen);
+			seg->gen = NULL;
+		}
+	}
+	seg->gen_prg = seg->gen ? seg->prg : NULL;
+	seg->gen_srate = seg->srate;
+	if (!seg->gen || !SAU_Interp_restore(seg->gen, seg->state)) {
+		seg->error = true;
+		return NULL;
+	}
+	seg->len = SAU_Interp_run(seg->gen, seg->buf, seg->buf_len);
+	return NULL;
+}
+
+/*
+ * Run \p gen until the end of the signal, splitting the audio into
+ * time segments rendered in parallel by up to o->threads threads.
+ *
+ * Only state is advanced through each segment by \p gen, which
+ * is saved at the start of each segment to render it from.
+ * Segments are written in order, giving the same audio as
+ * when running serially.
+ *
+ * \return true unless error occurred
+ */
+static bool SAU_Output_run_parallel(SAU_Output *restrict o,
+		SAU_Interp *restrict gen,
+		const SAU_Program *restrict prg, uint32_t srate,
+		bool use_audiodev, bool use_wavfile) {
+	const size_t seg_len = o->ch_len * SEG_CHUNKS;
+	uint32_t count = o->threads;
+	uint32_t i;
+	bool end = false, error = false;
+	if (!o->segs) {
+		o->segs = calloc(count, sizeof(SAU_Segment));
+		if (!o->segs) goto MEM_ERR;
+		for (i = 0; i < count; ++i) {
+			o->segs[i].buf = calloc(seg_len * NUM_CHANNELS,
+					sizeof(int16_t));
+			if (!o->segs[i].buf) goto MEM_ERR;
+		}
+	}
+	while (!end && !error) {
+		uint32_t started = 0;
+		for (i = 0; i < count && !end; ++i) {
+			SAU_Segment *seg = &o->segs[i];
+			seg->prg = prg;
+			seg->srate = srate;
+			seg->args = o->args;
+			seg->buf_len = seg_len;
+			seg->error = false;
+			seg->state = SAU_Interp_save(gen);
+			if (!seg->state) {
+				SAU_error(NULL, "memory allocation failure");
+				error = true;
+				break;
+			}
+			if (pthread_create(&seg->thread, NULL,
+					render_segment, seg) != 0) {
+				SAU_destroy_InterpState(seg->state);
+				seg->state = NULL;
+				SAU_error(NULL, "couldn't start render thread");
+				error = true;
+				break;
+			}
+			++started;
+			if (SAU_Interp_skip(gen, seg_len) < seg_len)
+				end = true;
+		}
+		for (i = 0; i < started; ++i) {
+			SAU_Segment *seg = &o->segs[i];
+			pthread_join(seg->thread, NULL);
+			SAU_destroy_InterpState(seg->state);
+			seg->state = NULL;
+			if (seg->error) {
+				SAU_error(NULL, "render thread failed");
+				error = true;
+			}
+			if (!error && seg->len > 0 &&
+					!SAU_Output_write(o, seg->buf, seg->len,
+						use_audiodev, use_wavfile))
+				error = true;
+		}
+	}
+	return !error;
+MEM_ERR:
+	SAU_error(NULL, "memory allocation failure");
+	if (o->segs != NULL) {
+		for (i = 0; i < count; ++i)
+			free(o->segs[i].buf);
+		free(o->segs);
+		o->segs = NULL;
+	}
+	return false;
+}
+
 /*
  * Produce audio for program \p prg, optionally sending it
  * to the audio device and/or WAV file.
  *
+ * The interpreter is kept in \p o and reset for each run,
+ * reusing its memory for following programs.
+ *
  * \return true unless error occurred
  */
 static bool SAU_Output_run(SAU_Output *restrict o,
 		const SAU_Program *restrict prg,
 		bool split_gen, uint32_t other_srate) {
 	uint32_t srate = (o->ad != NULL) ? o->ad->srate : other_srate;
-	SAU_Interp *gen = SAU_create_Interp(prg, srate);
+	if (!SAU_Output_set_args(o, prg))
+		return false;
+	SAU_Interp *gen = SAU_Output_get_interp(o, prg, srate);
 	if (!gen)
 		return false;
-	size_t len;
 	bool error = false;
 	bool run = !(o->options & SAU_ARG_MODE_CHECK);
 	if ((o->options & SAU_ARG_PRINT_INFO) != 0)
 		SAU_Interp_print(gen);
+	if (run && o->start_ms > 0)
+		SAU_Interp_seek(gen, o->start_ms);
 	if (run && split_gen && (o->ad != NULL)) {
-		for (;;) {
-			len = SAU_Interp_run(gen, o->buf, o->ch_len);
-			if (!len) break;
-			if (!SAU_AudioDev_write(o->ad, o->buf, len)) {
+		if (o->threads > 1) {
+			if (!SAU_Output_run_parallel(o, gen, prg, srate,
+						true, false))
+				error = true;
+		} else {
+			if (!SAU_Output_run_serial(o, gen, true, false))
 				error = true;
-				SAU_error(NULL, "audio device write failed");
-			}
 		}
-		SAU_destroy_Interp(gen);
-		gen = SAU_create_Interp(prg, other_srate);
+		gen = SAU_Output_get_interp(o, prg, other_srate);
 		if (!gen)
 			return false;
+		if (o->start_ms > 0)
+			SAU_Interp_seek(gen, o->start_ms);
+		srate = other_srate;
 	}
 	bool use_audiodev = !split_gen && (o->ad != NULL);
 	bool use_wavfile = (o->wf != NULL);
-	if (run) for (;;) {
-		len = SAU_Interp_run(gen, o->buf, o->ch_len);
-		if (!len) break;
-		if (use_audiodev && !SAU_AudioDev_write(o->ad, o->buf, len)) {
-			error = true;
-			SAU_error(NULL, "audio device write failed");
-		}
-		if (use_wavfile && !SAU_WAVFile_write(o->wf, o->buf, len)) {
-			error = true;
-			SAU_error(NULL, "WAV file write failed");
+	if (run) {
+		if (o->threads > 1) {
+			if (!SAU_Output_run_parallel(o, gen, prg, srate,
+						use_audiodev, use_wavfile))
+				error = true;
+		} else {
+			if (!SAU_Output_run_serial(o, gen,
+						use_audiodev, use_wavfile))
+				error = true;
 		}
 	}
-	SAU_destroy_Interp(gen);
 	return !error;
 }
 
@@ -136,18 +410,27 @@ static bool SAU_Output_run(SAU_Output *restrict o,
  * ignoring NULL entries.
  *
  * The output is sent to either none, one, or both of the audio device
- * or a WAV file.
+ * or a WAV file. If \p start_ms is non-zero, output begins at that time,
+ * skipping ahead in each program without generating the audio before.
+ * If \p threads is greater than 1, audio is rendered in parallel time
+ * segments using that many threads. If not NULL, \p arg_defs lists
+ * "name=value" strings, setting script arguments of the programs.
  *
  * \return true unless error occurred
  */
 bool SAU_play(const SAU_PtrArr *restrict prg_objs, uint32_t srate,
-		uint32_t options, const char *restrict wav_path) {
+		uint32_t options, uint32_t start_ms, uint32_t threads,
+		const char *restrict wav_path,
+		const SAU_PtrArr *restrict arg_defs) {
 	if (!prg_objs->count)
 		return true;
 
 	SAU_Output out;
 	if (!SAU_init_Output(&out, srate, options, wav_path))
 		return false;
+	out.start_ms = start_ms;
+	out.threads = threads;
+	out.arg_defs = arg_defs;
 	bool status = true;
 	bool split_gen = false;
 	if (out.ad != NULL && out.wf != NULL && (out.ad->srate != srate)) {
@@ -167,3 +450,358 @@ bool SAU_play(const SAU_PtrArr *restrict prg_objs, uint32_t srate,
 		status = false;
 	return status;
 }
+
+/*
+ * Start program \p prg for watch mode, at the start time if set.
+ *
+ * \return interpreter or NULL on error
+ */
+static SAU_Interp *SAU_Output_start_watched(SAU_Output *restrict o,
+		const SAU_Program *restrict prg, uint32_t srate) {
+	if (!SAU_Output_set_args(o, prg))
+		return NULL;
+	SAU_Interp *gen = SAU_Output_get_interp(o, prg, srate);
+	if (!gen)
+		return NULL;
+	if ((o->options & SAU_ARG_PRINT_INFO) != 0)
+		SAU_Interp_print(gen);
+	if (o->start_ms > 0)
+		SAU_Interp_seek(gen, o->start_ms);
+	return gen;
+}
+
+/*
+ * Replace the interpreter kept in \p o with \p gen for the changed
+ * program \p prg, continuing from the same time position if \p resume
+ * is true. The next chunk is written crossfaded from the old program
+ * to the new, using \p fade_buf for the old.
+ *
+ * If \p gen is NULL, an interpreter is created for \p prg. Otherwise,
+ * it's only skipped ahead to the time reached after it was readied.
+ *
+ * \return new interpreter, or NULL on error
+ */
+static SAU_Interp *SAU_Output_swap_watched(SAU_Output *restrict o,
+		const SAU_Program *restrict prg, SAU_Interp *restrict gen,
+		uint32_t srate, bool resume, int16_t *restrict fade_buf) {
+	if (!gen) {
+		if (!SAU_Output_set_args(o, prg))
+			return NULL;
+		gen = SAU_create_Interp(prg, srate, o->args);
+		if (!gen)
+			return NULL;
+		if ((o->options & SAU_ARG_PRINT_INFO) != 0)
+			SAU_Interp_print(gen);
+		if (!resume && o->start_ms > 0)
+			SAU_Interp_seek(gen, o->start_ms);
+	}
+	if (resume) {
+		uint64_t time = SAU_Interp_time(o->gen);
+		uint64_t gen_time = SAU_Interp_time(gen);
+		if (time > gen_time)
+			SAU_Interp_skip(gen, time - gen_time);
+	}
+	size_t old_len = SAU_Interp_run(o->gen, fade_buf, o->ch_len);
+	SAU_destroy_Interp(o->gen);
+	o->gen = gen;
+	size_t len = SAU_Interp_run(gen, o->buf, o->ch_len);
+	/*
+	 * Fade only while the old program has audio. If the new one
+	 * ends before the fade does, it's silent for the rest.
+	 */
+	size_t fade_len = SAU_MS_IN_SAMPLES(FADE_MS, srate);
+	if (fade_len > old_len) fade_len = old_len;
+	if (len < fade_len) {
+		memset(&o->buf[len * NUM_CHANNELS], 0,
+				(fade_len - len) * NUM_CHANNELS *
+				sizeof(int16_t));
+		len = fade_len;
+	}
+	for (size_t i = 0; i < fade_len; ++i) {
+		float x = (float) i / fade_len;
+		for (size_t j = i * NUM_CHANNELS;
+				j < (i + 1) * NUM_CHANNELS; ++j)
+			o->buf[j] = lrintf(fade_buf[j] +
+					(o->buf[j] - fade_buf[j]) * x);
+	}
+	if (len > 0 && !SAU_Output_write(o, o->buf, len, true, false))
+		return NULL;
+	return gen;
+}
+
+/*
+ * Rebuild of a changed script, run in a thread of its own so that
+ * audio keeps being written meanwhile. If the old program is playing
+ * when it begins, an interpreter is also readied for the new one,
+ * skipped ahead to the time then reached if resuming, otherwise to
+ * the start time.
+ */
+typedef struct SAU_Rebuild {
+	const char *script_arg;
+	const char *cache_dir;
+	const SAU_PtrArr *arg_defs;
+	uint32_t options;
+	uint32_t srate;
+	uint32_t start_ms;
+	uint64_t skip_len;
+	size_t script_i;
+	bool make_gen;
+	bool joinable;
+	bool done; // set when finished, under lock
+	SAU_Program *prg;
+	SAU_Interp *gen;
+	pthread_mutex_t lock;
+	pthread_t thread;
+} SAU_Rebuild;
+
+/*
+ * Rebuild the script \p script_arg after a change.
+ *
+ * \return program or NULL on error
+ */
+static SAU_Program *rebuild_watched(const char *restrict script_arg,
+		uint32_t options, const char *restrict cache_dir) {
+	SAU_PtrArr args = (SAU_PtrArr){0}, prg_objs = (SAU_PtrArr){0};
+	SAU_Program *prg = NULL;
+	if (SAU_PtrArr_add(&args, (void*) script_arg) &&
+			SAU_build(&args, options, cache_dir, &prg_objs) > 0)
+		prg = SAU_PtrArr_GET(&prg_objs, 0);
+	SAU_PtrArr_clear(&args);
+	SAU_PtrArr_clear(&prg_objs);
+	return prg;
+}
+
+/*
+ * Thread function for rebuilding a script.
+ */
+static void *run_rebuild(void *restrict arg) {
+	SAU_Rebuild *rb = arg;
+	SAU_Program *prg = rebuild_watched(rb->script_arg,
+			rb->options, rb->cache_dir);
+	SAU_Interp *gen = NULL;
+	float *args;
+	if (prg != NULL && rb->make_gen &&
+			get_args(rb->arg_defs, prg, &args)) {
+		gen = SAU_create_Interp(prg, rb->srate, args);
+		free(args);
+	}
+	if (gen != NULL) {
+		if ((rb->options & SAU_ARG_PRINT_INFO) != 0)
+			SAU_Interp_print(gen);
+		if ((rb->options & SAU_ARG_WATCH_RESUME) != 0)
+			SAU_Interp_skip(gen, rb->skip_len);
+		else if (rb->start_ms > 0)
+			SAU_Interp_seek(gen, rb->start_ms);
+	}
+	pthread_mutex_lock(&rb->lock);
+	rb->prg = prg;
+	rb->gen = gen;
+	rb->done = true;
+	pthread_mutex_unlock(&rb->lock);
+	return NULL;
+}
+
+/*
+ * Check whether the rebuild begun is finished.
+ */
+static bool SAU_Rebuild_done(SAU_Rebuild *restrict rb) {
+	pthread_mutex_lock(&rb->lock);
+	bool done = rb->done;
+	pthread_mutex_unlock(&rb->lock);
+	return done;
+}
+
+/*
+ * Begin rebuilding script \p i in a new thread. If \p gen is not
+ * NULL, it's the interpreter playing the old program for the script,
+ * and one is readied for the new program. If no thread can be
+ * created, rebuild directly instead.
+ *
+ * The thread is started with stop signals blocked, so that they
+ * reach the playback loop.
+ */
+static void SAU_Rebuild_start(SAU_Rebuild *restrict rb, size_t i,
+		const char *restrict script_arg,
+		const SAU_Interp *restrict gen) {
+	rb->script_arg = script_arg;
+	rb->script_i = i;
+	rb->make_gen = (gen != NULL);
+	rb->skip_len = (gen != NULL) ? SAU_Interp_time(gen) : 0;
+	rb->done = false;
+	rb->prg = NULL;
+	rb->gen = NULL;
+	sigset_t set, old_set;
+	sigemptyset(&set);
+	sigaddset(&set, SIGINT);
+	sigaddset(&set, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &set, &old_set);
+	rb->joinable = (pthread_create(&rb->thread, NULL,
+				run_rebuild, rb) == 0);
+	pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+	if (!rb->joinable)
+		run_rebuild(rb);
+}
+
+/*
+ * Wait for the rebuild begun to finish.
+ */
+static void SAU_Rebuild_join(SAU_Rebuild *restrict rb) {
+	if (rb->joinable) {
+		pthread_join(rb->thread, NULL);
+		rb->joinable = false;
+	}
+}
+
+static volatile sig_atomic_t watch_stop;
+
+/*
+ * Handle SIGINT and SIGTERM in watch mode, ending it.
+ */
+static void stop_watch(int sig sauMaybeUnused) {
+	watch_stop = 1;
+}
+
+/**
+ * Run the listed programs like SAU_play(), through the audio device
+ * only, then keep it open and watch the listed script files they were
+ * built from, until interrupted by SIGINT or SIGTERM, which ends it
+ * normally.
+ *
+ * When a script file is saved, only it is rebuilt, in a separate
+ * thread while audio keeps playing. If its program is playing, the
+ * new one replaces it at the end of the chunk of audio during which
+ * the rebuild finished, crossfaded, and with SAU_ARG_WATCH_RESUME,
+ * continuing from the same time position. Otherwise, the new program
+ * plays when reached in the list, or at once if the list has ended.
+ * Upon errors in a changed script, the old program is kept. Script
+ * arguments are set from \p arg_defs like for SAU_play(), also for
+ * rebuilt programs.
+ *
+ * \return false on error
+ */
+bool SAU_play_watched(SAU_PtrArr *restrict prg_objs,
+		const SAU_PtrArr *restrict script_args,
+		const char *restrict cache_dir,
+		uint32_t srate, uint32_t options, uint32_t start_ms,
+		const SAU_PtrArr *restrict arg_defs) {
+	SAU_Output out;
+	SAU_Watch *watch = NULL;
+	int16_t *fade_buf = NULL;
+	bool *changed = NULL;
+	SAU_Rebuild rb = {0};
+	bool building = false;
+	bool error = false;
+	if (!SAU_init_Output(&out, srate, options, NULL))
+		return false;
+	pthread_mutex_init(&rb.lock, NULL);
+	struct sigaction sa = {0}, old_int, old_term;
+	sa.sa_handler = stop_watch;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	watch_stop = 0;
+	sigaction(SIGINT, &sa, &old_int);
+	sigaction(SIGTERM, &sa, &old_term);
+	if (!out.ad) {
+		error = true;
+		goto DONE;
+	}
+	out.start_ms = start_ms;
+	out.threads = 1;
+	out.arg_defs = arg_defs;
+	srate = out.ad->srate;
+	bool resume = (options & SAU_ARG_WATCH_RESUME) != 0;
+	const char **args = (const char**) SAU_PtrArr_ITEMS(script_args);
+	size_t count = script_args->count;
+	rb.cache_dir = cache_dir;
+	rb.arg_defs = arg_defs;
+	rb.options = options;
+	rb.srate = srate;
+	rb.start_ms = start_ms;
+	fade_buf = calloc(out.buf_len, sizeof(int16_t));
+	changed = calloc(count, sizeof(bool));
+	watch = SAU_create_Watch(args, count);
+	if (!fade_buf || !changed || !watch) {
+		SAU_error(NULL, "couldn't watch script files");
+		error = true;
+		goto DONE;
+	}
+	SAU_Program **prgs = (SAU_Program**) SAU_PtrArr_ITEMS(prg_objs);
+	SAU_Interp *gen = NULL;
+	size_t cur = 0;
+	while (!watch_stop) {
+		if (!gen) {
+			while (cur < count && !prgs[cur]) ++cur;
+			if (cur < count) {
+				gen = SAU_Output_start_watched(&out,
+						prgs[cur], srate);
+				if (!gen) break;
+			}
+		}
+		if (gen != NULL) {
+			size_t len = SAU_Interp_run(gen, out.buf, out.ch_len);
+			if (len > 0 && !SAU_Output_write(&out, out.buf, len,
+						true, false))
+				break;
+			if (len < out.ch_len) {
+				gen = NULL;
+				++cur;
+			}
+		}
+		if (building && SAU_Rebuild_done(&rb)) {
+			SAU_Rebuild_join(&rb);
+			building = false;
+			size_t i = rb.script_i;
+			if (!rb.prg) {
+				SAU_warning(NULL,
+"keeping previous program for \"%s\"", args[i]);
+			} else if (gen != NULL && i == cur) {
+				gen = SAU_Output_swap_watched(&out, rb.prg,
+						rb.gen, srate, resume, fade_buf);
+				SAU_discard_Program(prgs[i]);
+				prgs[i] = rb.prg;
+				if (!gen) break;
+			} else {
+				SAU_destroy_Interp(rb.gen);
+				SAU_discard_Program(prgs[i]);
+				prgs[i] = rb.prg;
+				if (!gen) cur = i;
+			}
+			rb.prg = NULL;
+			rb.gen = NULL;
+			if (!gen) continue;
+		}
+		int32_t wait_ms = (gen != NULL) ? 0 :
+			(building ? REBUILD_MS : IDLE_MS);
+		for (int32_t i; (i = SAU_Watch_poll(watch, wait_ms)) >= 0; ) {
+			changed[i] = true;
+			wait_ms = 0;
+		}
+		if (building)
+			continue;
+		for (size_t i = 0; i < count; ++i) {
+			if (changed[i]) {
+				changed[i] = false;
+				SAU_Rebuild_start(&rb, i, args[i],
+						(i == cur) ? gen : NULL);
+				building = true;
+				break;
+			}
+		}
+	}
+	if (building) {
+		SAU_Rebuild_join(&rb);
+		SAU_destroy_Interp(rb.gen);
+		SAU_discard_Program(rb.prg);
+	}
+	if (!watch_stop) error = true; // loop left on error
+DONE:
+	sigaction(SIGINT, &old_int, NULL);
+	sigaction(SIGTERM, &old_term, NULL);
+	SAU_destroy_Watch(watch);
+	pthread_mutex_destroy(&rb.lock);
+	free(changed);
+	free(fade_buf);
+	if (!SAU_fini_Output(&out))
+		error = true;
+	return !error;
+}
@@ -0,0 +1,208 @@
+/* saugns: Script file watcher module.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "watch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef __linux
+# include <poll.h>
+# include <unistd.h>
+# include <sys/inotify.h>
+#else
+# include <time.h>
+# define CHECK_MS 100 /* interval for checking files without inotify */
+#endif
+
+typedef struct WatchFile {
+	const char *path;
+#ifdef __linux
+	const char *name; // part of path after directory
+	int wd; // watch descriptor for directory
+#else
+	time_t mtime;
+	off_t size;
+#endif
+	bool changed;
+} WatchFile;
+
+/*
+ * On Linux, inotify is used to watch the directory of each file,
+ * so that files replaced on saving (written to a new file renamed
+ * over the old) are still followed. Elsewhere, the modification
+ * time and size of each file is checked at intervals.
+ */
+struct SAU_Watch {
+	WatchFile *files;
+	size_t count;
+#ifdef __linux
+	int fd;
+#endif
+};
+
+#ifdef __linux
+/*
+ * Add inotify watch for the directory of the file.
+ *
+ * \return true, or false on error
+ */
+static bool watch_dir(SAU_Watch *restrict o, WatchFile *restrict file) {
+	const char *slash = strrchr(file->path, '/');
+	char *dir;
+	if (!slash) {
+		file->name = file->path;
+		dir = strdup(".");
+	} else {
+		file->name = slash + 1;
+		size_t len = (slash > file->path) ? slash - file->path : 1;
+		dir = strndup(file->path, len);
+	}
+	if (!dir)
+		return false;
+	file->wd = inotify_add_watch(o->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+	free(dir);
+	return (file->wd >= 0);
+}
+
+/*
+ * Read pending inotify events, marking the files changed.
+ */
+static void read_events(SAU_Watch *restrict o) {
+	union {
+		struct inotify_event ev;
+		char buf[4096];
+	} u;
+	ssize_t len;
+	while ((len = read(o->fd, u.buf, sizeof(u.buf))) > 0) {
+		const char *p = u.buf;
+		while (p < u.buf + len) {
+			const struct inotify_event *ev = (const void*) p;
+			for (size_t i = 0; i < o->count; ++i) {
+				WatchFile *file = &o->files[i];
+				if (ev->len > 0 && ev->wd == file->wd &&
+						!strcmp(ev->name, file->name))
+					file->changed = true;
+			}
+			p += sizeof(struct inotify_event) + ev->len;
+		}
+	}
+}
+#else
+/*
+ * Check the files for changes in modification time or size,
+ * marking the files changed.
+ *
+ * \return true if any file changed
+ */
+static bool check_files(SAU_Watch *restrict o) {
+	bool changed = false;
+	for (size_t i = 0; i < o->count; ++i) {
+		WatchFile *file = &o->files[i];
+		struct stat st;
+		if (stat(file->path, &st) != 0)
+			continue;
+		if (st.st_mtime != file->mtime || st.st_size != file->size) {
+			file->mtime = st.st_mtime;
+			file->size = st.st_size;
+			file->changed = changed = true;
+		}
+	}
+	return changed;
+}
+#endif
+
+/**
+ * Create instance for watching the \p count files in \p paths,
+ * which must remain available until destroyed.
+ *
+ * \return instance, or NULL on error
+ */
+SAU_Watch *SAU_create_Watch(const char *const*restrict paths,
+		size_t count) {
+	SAU_Watch *o = calloc(1, sizeof(SAU_Watch));
+	if (!o)
+		return NULL;
+#ifdef __linux
+	o->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (o->fd < 0) {
+		free(o);
+		return NULL;
+	}
+#endif
+	o->files = calloc(count, sizeof(WatchFile));
+	if (!o->files) goto ERROR;
+	o->count = count;
+	for (size_t i = 0; i < count; ++i) {
+		WatchFile *file = &o->files[i];
+		file->path = paths[i];
+#ifdef __linux
+		if (!watch_dir(o, file)) goto ERROR;
+#endif
+	}
+#ifndef __linux
+	check_files(o);
+	for (size_t i = 0; i < count; ++i)
+		o->files[i].changed = false;
+#endif
+	return o;
+ERROR:
+	SAU_destroy_Watch(o);
+	return NULL;
+}
+
+/**
+ * Destroy instance.
+ */
+void SAU_destroy_Watch(SAU_Watch *restrict o) {
+	if (!o)
+		return;
+#ifdef __linux
+	close(o->fd);
+#endif
+	free(o->files);
+	free(o);
+}
+
+/**
+ * Check for a changed file, waiting up to \p wait_ms milliseconds
+ * for one, or without time limit if negative. Each change is given
+ * once, in the order of the paths if several are pending.
+ *
+ * \return index of changed file, or -1 if none
+ */
+int32_t SAU_Watch_poll(SAU_Watch *restrict o, int32_t wait_ms) {
+	for (;;) {
+		for (size_t i = 0; i < o->count; ++i) {
+			if (o->files[i].changed) {
+				o->files[i].changed = false;
+				return i;
+			}
+		}
+#ifdef __linux
+		struct pollfd pfd = {.fd = o->fd, .events = POLLIN};
+		if (poll(&pfd, 1, wait_ms) <= 0)
+			return -1;
+		read_events(o);
+#else
+		if (check_files(o))
+			continue;
+		if (!wait_ms)
+			return -1;
+		struct timespec ts = {0, CHECK_MS * 1000000L};
+		nanosleep(&ts, NULL);
+		if (wait_ms > 0)
+			wait_ms = (wait_ms > CHECK_MS) ? wait_ms - CHECK_MS : 0;
+#endif
+	}
+}
@@ -0,0 +1,24 @@
+/* saugns: Script file watcher module.
+ * Copyright (c) 2021 Joel K. Pettersson
+ * <joelkpettersson@gmail.com>.
+ *
+ * This file and the software of which it is part is distributed under the
+ * terms of the GNU Lesser General Public License, either version 3 or (at
+ * your option) any later version, WITHOUT ANY WARRANTY, not even of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * View the file COPYING for details, or if missing, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "../common.h"
+
+struct SAU_Watch;
+typedef struct SAU_Watch SAU_Watch;
+
+SAU_Watch *SAU_create_Watch(const char *const*restrict paths,
+		size_t count) sauMalloclike;
+void SAU_destroy_Watch(SAU_Watch *restrict o);
+
+int32_t SAU_Watch_poll(SAU_Watch *restrict o, int32_t wait_ms);
@@ -44,11 +44,18 @@ enum {
 	SAU_POP_PARAMS = (1<<9) - 1
 };
 
+/**
+ * Operator data flags.
+ */
+enum {
+	SAU_PODF_INIT = 1<<0, /* first data for operator; reset its state */
+};
+
 /*
  * Voice ID constants.
  */
-#define SAU_PVO_NO_ID  UINT16_MAX       /* voice ID missing */
-#define SAU_PVO_MAX_ID (UINT16_MAX - 1) /* error if exceeded */
+#define SAU_PVO_NO_ID  UINT32_MAX       /* voice ID missing */
+#define SAU_PVO_MAX_ID (UINT32_MAX - 1) /* error if exceeded */
 
 /*
  * Operator ID constants.
@@ -78,6 +85,54 @@ typedef struct SAU_ProgramOpList {
 	uint32_t ids[];
 } SAU_ProgramOpList;
 
+/**
+ * Operator parameter values which may be set from script arguments.
+ */
+enum {
+	SAU_PARG_FREQ = 0,
+	SAU_PARG_FREQ_GOAL,
+	SAU_PARG_FREQ2,
+	SAU_PARG_FREQ2_GOAL,
+	SAU_PARG_AMP,
+	SAU_PARG_AMP_GOAL,
+	SAU_PARG_AMP2,
+	SAU_PARG_AMP2_GOAL,
+	SAU_PARG_PAN,
+	SAU_PARG_PAN_GOAL,
+	SAU_PARG_PHASE,
+	SAU_PARG_TARGETS
+};
+
+/*
+ * Script argument ID constants.
+ */
+#define SAU_PARG_NO_ID  UINT32_MAX       /* argument ID missing */
+#define SAU_PARG_MAX_ID (UINT32_MAX - 1) /* error if exceeded */
+
+/**
+ * Script argument, with the value used unless another is
+ * given when the program is instantiated.
+ */
+typedef struct SAU_ProgramArg {
+	const char *name;
+	float def_val;
+} SAU_ProgramArg;
+
+/**
+ * Use of a script argument for an operator parameter value,
+ * which is set to the argument value times  mul.
+ */
+typedef struct SAU_ProgramArgSlot {
+	uint32_t arg_id;
+	uint8_t target; /* SAU_PARG_* value */
+	float mul;
+} SAU_ProgramArgSlot;
+
+typedef struct SAU_ProgramArgList {
+	uint32_t count;
+	SAU_ProgramArgSlot slots[];
+} SAU_ProgramArgList;
+
 typedef struct SAU_ProgramVoData {
 	const SAU_ProgramOpList *carriers;
 	uint32_t params;
@@ -93,21 +148,35 @@ typedef struct SAU_ProgramOpData {
 	SAU_Time time;
 	uint32_t silence_ms;
 	uint8_t wave;
+	uint8_t flags;
 	SAU_Ramp freq, freq2;
 	SAU_Ramp amp, amp2;
 	SAU_Ramp pan;
 	float phase;
+	const SAU_ProgramArgList *args; /* NULL unless arguments used */
 	const struct SAU_ProgramOpData *prev;
 } SAU_ProgramOpData;
 
 typedef struct SAU_ProgramEvent {
 	uint32_t wait_ms;
-	uint16_t vo_id;
+	uint32_t vo_id;
 	uint32_t op_data_count;
 	const SAU_ProgramVoData *vo_data;
 	const SAU_ProgramOpData *op_data;
 } SAU_ProgramEvent;
 
+/**
+ * Repetition of events \a first_ev up to \a first_ev + \a ev_count,
+ * played \a count times in all, each time \a period_ms after the
+ * first event of the previous. The events are kept only once, and
+ * the repetitions expanded when run.
+ */
+typedef struct SAU_ProgramLoop {
+	size_t first_ev, ev_count;
+	uint32_t count;
+	uint32_t period_ms;
+} SAU_ProgramLoop;
+
 /**
  * Program flags affecting interpretation.
  */
@@ -123,17 +192,41 @@ struct SAU_MemPool;
 typedef struct SAU_Program {
 	const SAU_ProgramEvent **events;
 	size_t ev_count;
+	const SAU_ProgramLoop *loops; // in order of events, not overlapping
+	size_t loop_count;
 	uint16_t mode;
-	uint16_t vo_count;
+	uint32_t vo_count;
 	uint32_t op_count;
 	uint32_t duration_ms;
+	uint32_t arg_count;
+	const SAU_ProgramArg *args;
 	const char *name;
 	struct SAU_MemPool *mem; // internally used, provided until destroy
+	                         // (NULL if loaded from a program file)
 } SAU_Program;
 
 struct SAU_Script;
 SAU_Program* SAU_build_Program(struct SAU_Script *restrict sd) sauMalloclike;
+SAU_Program* SAU_build_piped_Program(const char *restrict script_arg,
+		bool is_path, const char *restrict name) sauMalloclike;
 void SAU_discard_Program(SAU_Program *restrict o);
+uint32_t SAU_Program_find_arg(const SAU_Program *restrict o,
+		const char *restrict name);
+void SAU_ProgramOpData_bind_args(SAU_ProgramOpData *restrict od,
+		const float *restrict args);
+
+/**
+ * Stream of programs converted from a script a chunk of events
+ * at a time, for running with bounded memory use.
+ */
+struct SAU_ProgramStream;
+typedef struct SAU_ProgramStream SAU_ProgramStream;
+
+SAU_ProgramStream *SAU_open_ProgramStream(const char *restrict script_arg,
+		bool is_path, const char *restrict name,
+		size_t chunk_len) sauMalloclike;
+void SAU_close_ProgramStream(SAU_ProgramStream *restrict o);
+const SAU_Program *SAU_ProgramStream_next(SAU_ProgramStream *restrict o);
 
 void SAU_Program_print_info(const SAU_Program *restrict o,
 		const char *restrict name_prefix,
@@ -17,6 +17,8 @@
 
 #include "file.h"
 #include "../math.h"
+#include <float.h>
+#include <inttypes.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -245,7 +247,12 @@ static size_t mode_strread(SAU_File *restrict o) {
 	size_t len;
 	// Move to and fill at the first character of the buffer area.
 	o->pos &= (SAU_FILE_BUFSIZ - 1) & ~(SAU_FILE_ALEN - 1);
-	len = strlen(str);
+	/*
+	 * Only look as far as one buffer area ahead for the end,
+	 * so that long strings aren't scanned again for each area.
+	 */
+	const char *end = memchr(str, '\0', SAU_FILE_ALEN);
+	len = (end != NULL) ? (size_t) (end - str) : SAU_FILE_ALEN;
 	if (len >= SAU_FILE_ALEN) {
 		len = SAU_FILE_ALEN;
 		o->ref = &((char*)o->ref)[len];
@@ -317,23 +324,51 @@ bool SAU_File_getstr(SAU_File *restrict o,
 	return !truncate;
 }
 
-/**
- * Read integer into \p var.
- *
- * Expects the number to begin at the current position.
- * The number sub-string must have the form:
- * optional sign, then digits.
- *
- * If \p lenp is not NULL, it will be set to the number of characters
- * read. 0 implies that no number was read and that \p var is unchanged.
+/*
+ * Number of contiguous characters which can be read from the current
+ * position without passing the callback position or the buffer end.
+ */
+static inline size_t contiguous_len(SAU_File *restrict o) {
+	size_t len = SAU_File_CREM(o), brem = SAU_File_BREM(o) + 1;
+	return (len < brem) ? len : brem;
+}
+
+/*
+ * Limit for accumulating another decimal digit in a 64-bit integer,
+ * allowing up to 19 significant digits.
+ */
+#define DEC_MANT_LIMIT UINT64_C(1000000000000000000)
+
+/*
+ * Scan digits in \p s from \p i up to \p n, accumulating them in
+ * \p mant. Stops at the first non-digit, or at the first digit which
+ * would no longer fit (leaving \p mant at or above DEC_MANT_LIMIT).
  *
- * \return true unless number too large and result truncated
+ * \return position stopped at
  */
-bool SAU_File_geti(SAU_File *restrict o,
+static inline size_t scan_digits(const uint8_t *restrict s,
+		size_t i, size_t n, uint64_t *restrict mant) {
+	uint64_t num = *mant;
+	for (; i < n; ++i) {
+		uint8_t c = s[i];
+		if (!IS_DIGIT(c) || num >= DEC_MANT_LIMIT) break;
+		num = num * 10 + (c - '0');
+	}
+	*mant = num;
+	return i;
+}
+
+/*
+ * Read integer one character at a time, for when it may continue
+ * past the contiguous part of the buffer. Otherwise the same as
+ * SAU_File_geti().
+ */
+static sauNoinline bool geti_slow(SAU_File *restrict o,
 		int32_t *restrict var, bool allow_sign,
 		size_t *restrict lenp) {
+	const uint64_t max = (uint64_t) INT32_MAX + 1;
 	uint8_t c;
-	int32_t num = 0;
+	uint64_t num = 0;
 	bool minus = false;
 	bool truncate = false;
 	size_t len = 0;
@@ -349,26 +384,18 @@ bool SAU_File_geti(SAU_File *restrict o,
 		if (lenp) *lenp = 0;
 		return true;
 	}
+	do {
+		if (num <= max) num = num * 10 + (c - '0');
+		c = SAU_File_GETC(o);
+		++len;
+	} while (IS_DIGIT(c));
 	if (minus) {
-		do {
-			int32_t new_num = num * 10 - (c - '0');
-			if (new_num > num) truncate = true;
-			else num = new_num;
-			c = SAU_File_GETC(o);
-			++len;
-		} while (IS_DIGIT(c));
-		if (truncate) num = INT32_MIN;
+		if (num > max) truncate = true;
+		*var = truncate ? INT32_MIN : (int32_t) -(int64_t) num;
 	} else {
-		do {
-			int32_t new_num = num * 10 + (c - '0');
-			if (new_num < num) truncate = true;
-			else num = new_num;
-			c = SAU_File_GETC(o);
-			++len;
-		} while (IS_DIGIT(c));
-		if (truncate) num = INT32_MAX;
+		if (num > max - 1) truncate = true;
+		*var = truncate ? INT32_MAX : (int32_t) num;
 	}
-	*var = num;
 	SAU_File_DECP(o);
 	--len;
 	if (lenp) *lenp = len;
@@ -376,71 +403,218 @@ bool SAU_File_geti(SAU_File *restrict o,
 }
 
 /**
- * Read double-precision floating point number into \p var.
+ * Read integer into \p var.
  *
  * Expects the number to begin at the current position.
  * The number sub-string must have the form:
- * optional sign, then digits and/or point followed by digits.
+ * optional sign, then digits.
  *
  * If \p lenp is not NULL, it will be set to the number of characters
  * read. 0 implies that no number was read and that \p var is unchanged.
  *
  * \return true unless number too large and result truncated
  */
-bool SAU_File_getd(SAU_File *restrict o,
-		double *restrict var, bool allow_sign,
+bool SAU_File_geti(SAU_File *restrict o,
+		int32_t *restrict var, bool allow_sign,
 		size_t *restrict lenp) {
-	uint8_t c;
-	long double num = 0.f, pos_mul = 1.f;
-	double res;
+	const uint64_t max = (uint64_t) INT32_MAX + 1;
+	uint64_t num = 0;
 	bool minus = false;
 	bool truncate = false;
-	size_t len = 0;
+	SAU_File_UPDATE(o);
+	const uint8_t *s = &o->buf[o->pos];
+	size_t i = 0, start, n = contiguous_len(o);
+	if (i < n && allow_sign && (s[i] == '+' || s[i] == '-')) {
+		if (s[i] == '-') minus = true;
+		++i;
+	}
+	start = i;
+	i = scan_digits(s, i, n, &num);
+	while (i < n && IS_DIGIT(s[i])) ++i; /* too large, skip */
+	if (i == n)
+		return geti_slow(o, var, allow_sign, lenp);
+	if (i == start) {
+		if (lenp) *lenp = 0;
+		return true;
+	}
+	if (minus) {
+		if (num > max) truncate = true;
+		*var = truncate ? INT32_MIN : (int32_t) -(int64_t) num;
+	} else {
+		if (num > max - 1) truncate = true;
+		*var = truncate ? INT32_MAX : (int32_t) num;
+	}
+	o->pos += i;
+	if (lenp) *lenp = i;
+	return !truncate;
+}
+
+/*
+ * Significant digits kept as text for strtod() when a number has more
+ * than fit in a 64-bit integer. A double halfway between two others
+ * has at most 767 significant digits, so keeping more than that plus
+ * a "sticky" digit marking any non-zero digits dropped is enough for
+ * correct rounding.
+ */
+#define DEC_TEXT_MAX 800
+
+/*
+ * Read number one character at a time, for when it may continue past
+ * the contiguous part of the buffer or has too many digits for the
+ * fast path. Converts the significant digits using strtod().
+ *
+ * \return number of characters read, 0 if none (position unchanged)
+ */
+static sauNoinline size_t getd_slow(SAU_File *restrict o,
+		double *restrict var, bool allow_sign) {
+	char str[DEC_TEXT_MAX + 16];
+	size_t text_len = 0, len = 0;
+	int32_t exp = 0;
+	bool digits = false, frac = false, sticky = false;
+	uint8_t c;
 	c = SAU_File_GETC(o);
 	++len;
 	if (allow_sign && (c == '+' || c == '-')) {
-		if (c == '-') minus = true;
+		if (c == '-') str[text_len++] = '-';
 		c = SAU_File_GETC(o);
 		++len;
 	}
-	if (c != '.') {
-		if (!IS_DIGIT(c)) {
-			SAU_File_UNGETN(o, len);
-			if (lenp) *lenp = 0;
-			return true;
+	size_t lead_len = text_len;
+	for (;; c = SAU_File_GETC(o), ++len) {
+		if (c == '.' && !frac) {
+			frac = true;
+			continue;
 		}
-		do {
-			num = num * 10.f + (c - '0');
-			c = SAU_File_GETC(o);
-			++len;
-		} while (IS_DIGIT(c));
-		if (c != '.') goto DONE;
-		c = SAU_File_GETC(o);
-		++len;
-	} else {
-		c = SAU_File_GETC(o);
-		++len;
-		if (!IS_DIGIT(c)) {
-			SAU_File_UNGETN(o, len);
-			if (lenp) *lenp = 0;
-			return true;
+		if (!IS_DIGIT(c))
+			break;
+		digits = true;
+		if (text_len == lead_len && c == '0') {
+			/* leading zero, not significant */
+			if (frac) --exp;
+		} else if (text_len < lead_len + DEC_TEXT_MAX) {
+			str[text_len++] = c;
+			if (frac) --exp;
+		} else {
+			if (!frac) ++exp;
+			if (c != '0') sticky = true;
 		}
 	}
-	while (IS_DIGIT(c)) {
-		pos_mul *= 0.1f;
-		num += (c - '0') * pos_mul;
-		c = SAU_File_GETC(o);
-		++len;
+	if (!digits) {
+		SAU_File_UNGETN(o, len);
+		return 0;
 	}
-DONE:
-	res = (double) num;
-	if (isinf(res)) truncate = true;
-	if (minus) res = -res;
-	*var = res;
 	SAU_File_DECP(o);
 	--len;
+	if (sticky) {
+		str[text_len++] = '1';
+		--exp;
+	}
+	if (text_len == lead_len) str[text_len++] = '0';
+	sprintf(&str[text_len], "e%" PRId32, exp);
+	*var = strtod(str, NULL);
+	return len;
+}
+
+/*
+ * Powers of 10 which are exact as doubles.
+ */
+static const double exact_pow10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+#define EXACT_POW10_MAX 22
+#define EXACT_MANT_MAX  (UINT64_C(1) << 53)
+
+/*
+ * Get correctly rounded value of \p mant * 10^\p exp.
+ *
+ * Short mantissas with small exponents are handled using a single
+ * exact floating point multiply or divide (Clinger's fast path),
+ * the rest using strtod().
+ */
+static double dec_to_double(uint64_t mant, int32_t exp) {
+	if (!mant)
+		return 0.0;
+#if FLT_EVAL_METHOD == 0 || FLT_EVAL_METHOD == 1
+	/* move exponent into mantissa if it still fits exactly */
+	while (exp > EXACT_POW10_MAX && mant < EXACT_MANT_MAX / 10) {
+		mant *= 10;
+		--exp;
+	}
+	if (mant <= EXACT_MANT_MAX) {
+		if (exp >= 0 && exp <= EXACT_POW10_MAX)
+			return (double) mant * exact_pow10[exp];
+		if (exp < 0 && exp >= -EXACT_POW10_MAX)
+			return (double) mant / exact_pow10[-exp];
+	}
+#endif
+	char str[48];
+	sprintf(str, "%" PRIu64 "e%" PRId32, mant, exp);
+	return strtod(str, NULL);
+}
+
+/**
+ * Read double-precision floating point number into \p var.
+ *
+ * Expects the number to begin at the current position.
+ * The number sub-string must have the form:
+ * optional sign, then digits and/or point followed by digits.
+ *
+ * The result is correctly rounded. Numbers with up to 19 significant
+ * digits which do not cross a buffer area boundary, the common case,
+ * are scanned directly in the buffer and mostly converted without
+ * going through strtod().
+ *
+ * If \p lenp is not NULL, it will be set to the number of characters
+ * read. 0 implies that no number was read and that \p var is unchanged.
+ *
+ * \return true unless number too large and result truncated
+ */
+bool SAU_File_getd(SAU_File *restrict o,
+		double *restrict var, bool allow_sign,
+		size_t *restrict lenp) {
+	uint64_t mant = 0;
+	int32_t exp = 0;
+	double res;
+	bool minus = false;
+	bool truncate = false;
+	size_t len;
+	SAU_File_UPDATE(o);
+	const uint8_t *s = &o->buf[o->pos];
+	size_t i = 0, start, n = contiguous_len(o);
+	if (i < n && allow_sign && (s[i] == '+' || s[i] == '-')) {
+		if (s[i] == '-') minus = true;
+		++i;
+	}
+	start = i;
+	i = scan_digits(s, i, n, &mant);
+	if (i < n && s[i] == '.') {
+		size_t frac_start = ++i;
+		i = scan_digits(s, i, n, &mant);
+		if (i == frac_start && frac_start - 1 == start && i < n)
+			goto NONE;
+		exp = - (int32_t) (i - frac_start);
+	} else if (i == start && i < n) {
+		goto NONE;
+	}
+	if (i == n || IS_DIGIT(s[i])) {
+		/* may continue past buffer area, or too many digits */
+		len = getd_slow(o, &res, allow_sign);
+		if (!len) goto NONE;
+	} else {
+		res = dec_to_double(mant, exp);
+		if (minus) res = -res;
+		o->pos += i;
+		len = i;
+	}
+	if (isinf(res)) truncate = true;
+	*var = res;
 	if (lenp) *lenp = len;
 	return !truncate;
+NONE:
+	if (lenp) *lenp = 0;
+	return true;
 }
 
 /**
@@ -459,35 +633,154 @@ size_t SAU_File_skipstr(SAU_File *restrict o, SAU_FileFilter_f filter_f) {
 	return i;
 }
 
+/*
+ * Use word-at-a-time scanning (SIMD within a register) when skipping runs
+ * of characters? Requires little-endian byte order, for the first match
+ * in a word to be found by counting trailing zero bits.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && \
+	defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+# define USE_WORD_SCAN 1
+#else
+# define USE_WORD_SCAN 0
+#endif
+
+#if USE_WORD_SCAN
+#define WORD_ONES  UINT64_C(0x0101010101010101)
+#define WORD_LOW7  UINT64_C(0x7F7F7F7F7F7F7F7F)
+#define WORD_HIGHS UINT64_C(0x8080808080808080)
+
+/*
+ * Get word with the high bit set for each zero byte in \p w,
+ * and all other bits clear.
+ */
+static inline uint64_t word_zeros(uint64_t w) {
+	return ~(((w & WORD_LOW7) + WORD_LOW7) | w | WORD_LOW7);
+}
+
+/*
+ * Get word with the high bit set for each byte in \p w equal to \p c,
+ * and all other bits clear.
+ */
+static inline uint64_t word_eq(uint64_t w, uint8_t c) {
+	return word_zeros(w ^ (WORD_ONES * c));
+}
+
+/*
+ * Get index of first byte marked in non-zero \p mask.
+ */
+static inline size_t word_first(uint64_t mask) {
+	return __builtin_ctzll(mask) >> 3;
+}
+#endif
+
+/*
+ * Get length of leading run of spaces and tabs in \p s, up to \p n.
+ */
+static size_t span_space(const uint8_t *restrict s, size_t n) {
+	size_t i = 0;
+#if USE_WORD_SCAN
+	for (; i + 8 <= n; i += 8) {
+		uint64_t w;
+		memcpy(&w, &s[i], 8);
+		uint64_t mask = ~(word_eq(w, ' ') | word_eq(w, '\t')) & WORD_HIGHS;
+		if (mask != 0)
+			return i + word_first(mask);
+	}
+#endif
+	while (i < n && IS_SPACE(s[i])) ++i;
+	return i;
+}
+
+/*
+ * Get length of leading run of characters in \p s, up to \p n, which
+ * are neither a linebreak nor \p stop_c nor possibly a status marker.
+ */
+static size_t span_line(const uint8_t *restrict s, size_t n, uint8_t stop_c) {
+	size_t i = 0;
+#if USE_WORD_SCAN
+	for (; i + 8 <= n; i += 8) {
+		uint64_t w;
+		memcpy(&w, &s[i], 8);
+		/* values up to SAU_FILE_MARKER (0x07) have no bits above 0x07 */
+		uint64_t mask = word_eq(w, '\n') | word_eq(w, '\r') |
+			word_eq(w, stop_c) |
+			word_zeros(w & (WORD_ONES * (uint8_t) ~SAU_FILE_MARKER));
+		if (mask != 0)
+			return i + word_first(mask);
+	}
+#endif
+	for (; i < n; ++i) {
+		uint8_t c = s[i];
+		if (IS_LNBRK(c) || c == stop_c || c <= SAU_FILE_MARKER) break;
+	}
+	return i;
+}
+
 /**
  * Advance past characters until the next is neither a space nor a tab.
  *
+ * Runs of characters in the buffer are scanned in bulk.
+ *
  * \return number of characters skipped
  */
 size_t SAU_File_skipspace(SAU_File *restrict o) {
 	size_t i = 0;
 	for (;;) {
+		SAU_File_UPDATE(o);
+		size_t n = contiguous_len(o);
+		size_t len = span_space(&o->buf[o->pos], n);
+		o->pos += len;
+		i += len;
+		if (len < n) break;
+		/*
+		 * At end of buffered data; handle next character normally.
+		 */
 		uint8_t c = SAU_File_GETC(o);
-		if (!IS_SPACE(c)) break;
+		if (!IS_SPACE(c)) {
+			SAU_File_DECP(o);
+			break;
+		}
 		++i;
 	}
-	SAU_File_DECP(o);
 	return i;
 }
 
 /**
- * Advance past characters until the next marks the end of the line (or file).
+ * Advance past characters until the next marks the end of the line (or file),
+ * or is \p stop_c.
+ *
+ * Runs of characters in the buffer are scanned in bulk. Useful for
+ * quickly moving past comment text.
  *
  * \return number of characters skipped
  */
-size_t SAU_File_skipline(SAU_File *restrict o) {
+size_t SAU_File_skiplinec(SAU_File *restrict o, uint8_t stop_c) {
 	size_t i = 0;
 	for (;;) {
+		SAU_File_UPDATE(o);
+		size_t len = span_line(&o->buf[o->pos], contiguous_len(o),
+				stop_c);
+		o->pos += len;
+		i += len;
+		/*
+		 * Check the character stopped at, or at end of buffered data,
+		 * normally. It may be a status marker value not at the end.
+		 */
 		uint8_t c = SAU_File_GETC(o);
-		if (IS_LNBRK(c) ||
+		if (IS_LNBRK(c) || c == stop_c ||
 			(c <= SAU_FILE_MARKER && SAU_File_AFTER_EOF(o))) break;
 		++i;
 	}
 	SAU_File_DECP(o);
 	return i;
 }
+
+/**
+ * Advance past characters until the next marks the end of the line (or file).
+ *
+ * \return number of characters skipped
+ */
+size_t SAU_File_skipline(SAU_File *restrict o) {
+	return SAU_File_skiplinec(o, '\n');
+}
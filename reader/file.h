@@ -384,3 +384,4 @@ bool SAU_File_getd(SAU_File *restrict o,
 size_t SAU_File_skipstr(SAU_File *restrict o, SAU_FileFilter_f filter_f);
 size_t SAU_File_skipspace(SAU_File *restrict o);
 size_t SAU_File_skipline(SAU_File *restrict o);
+size_t SAU_File_skiplinec(SAU_File *restrict o, uint8_t stop_c);
@@ -90,7 +90,7 @@ void SAU_destroy_Lexer(SAU_Lexer *restrict o) {
  */
 bool SAU_Lexer_open(SAU_Lexer *restrict o,
 		const char *restrict script, bool is_path) {
-	return SAU_Scanner_open(o->sc, script, is_path);
+	return SAU_Scanner_open(o->sc, script, is_path, NULL);
 }
 
 /**
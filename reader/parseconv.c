@@ -12,6 +12,15 @@
  */
 
 #include "parser.h"
+#include "../arrtype.h"
+#include <string.h>
+#include <inttypes.h>
+
+/*
+ * Latest end time for the last run of a repetition, leaving room
+ * within the 32-bit times of programs for events after it.
+ */
+#define LOOP_END_MAX_MS INT32_MAX
 
 /*
  * Script data construction from parse data.
@@ -21,44 +30,6 @@
  * recursive traversal in scriptconv.
  */
 
-/*
- * Adjust timing for a duration group; the script syntax for time grouping is
- * only allowed on the "top" operator level, so the algorithm only deals with
- * this for the events involved.
- */
-static void time_durgroup(SAU_ParseEvData *restrict e_last) {
-	SAU_ParseDurGroup *dur = e_last->dur;
-	SAU_ParseEvData *e, *e_after = e_last->next;
-	uint32_t wait = 0, waitcount = 0;
-	for (e = dur->range.first; e != e_after; ) {
-		SAU_ParseOpData *op = e->op_data;
-		if (op != NULL) {
-			if (wait < op->time.v_ms)
-				wait = op->time.v_ms;
-		}
-		e = e->next;
-		if (e != NULL) {
-			waitcount += e->wait_ms;
-		}
-	}
-	for (e = dur->range.first; e != e_after; ) {
-		SAU_ParseOpData *op = e->op_data;
-		if (op != NULL) {
-			if (!(op->time.flags & SAU_TIMEP_SET)) {
-				/* fill in sensible default time */
-				op->time.v_ms = wait + waitcount;
-				op->time.flags |= SAU_TIMEP_SET;
-			}
-		}
-		e = e->next;
-		if (e != NULL) {
-			waitcount -= e->wait_ms;
-		}
-	}
-	if (e_after != NULL)
-		e_after->wait_ms += wait;
-}
-
 static inline void time_ramp(SAU_Ramp *restrict ramp,
 		uint32_t default_time_ms) {
 	if (!(ramp->flags & SAU_RAMPP_TIME))
@@ -145,76 +116,145 @@ static void time_event(SAU_ParseEvData *restrict e) {
 }
 
 /*
- * Deals with events that are "composite" (attached to a main event as
- * successive "sub-events" rather than part of the big, linear event sequence).
+ * Composite event pending placement, ordered by time,
+ * then by placing the sequence of a later event first.
+ */
+typedef struct CompositeItem {
+	uint64_t time_ms;
+	uint32_t order;
+	SAU_ParseEvData *e;
+} CompositeItem;
+
+sauArrType(CompositeHeap, CompositeItem, _)
+
+static inline bool CompositeItem_before(const CompositeItem *restrict a,
+		const CompositeItem *restrict b) {
+	return (a->time_ms < b->time_ms ||
+		(a->time_ms == b->time_ms && a->order > b->order));
+}
+
+/*
+ * Add item to min-heap.
  *
- * Such events, if attached to the passed event, will be given their place in
- * the ordinary event list.
+ * \return true, or false on allocation failure
  */
-static void flatten_events(SAU_ParseEvData *restrict e) {
-	SAU_ParseEvData *ce = e->composite;
-	SAU_ParseEvData *se = e->next, *se_prev = e;
-	uint32_t wait_ms = 0;
-	uint32_t added_wait_ms = 0;
-	while (ce != NULL) {
-		if (!se) {
-			/*
-			 * No more events in the ordinary sequence,
-			 * so append all composites.
-			 */
-			se_prev->next = ce;
+static bool CompositeHeap_push(CompositeHeap *restrict o,
+		const CompositeItem *restrict item) {
+	if (!_CompositeHeap_add(o, NULL))
+		return false;
+	CompositeItem *a = o->a;
+	size_t i = o->count - 1;
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!CompositeItem_before(item, &a[parent]))
 			break;
-		}
-		/*
-		 * If several events should pass in the ordinary sequence
-		 * before the next composite is inserted, skip ahead.
-		 */
-		wait_ms += se->wait_ms;
-		if (se->next && (wait_ms + se->next->wait_ms)
-				<= (ce->wait_ms + added_wait_ms)) {
-			se_prev = se;
-			se = se->next;
-			continue;
-		}
-		/*
-		 * Insert next composite before or after
-		 * the next event of the ordinary sequence.
-		 */
-		SAU_ParseEvData *ce_next = ce->next;
-		if (se->wait_ms >= (ce->wait_ms + added_wait_ms)) {
-			se->wait_ms -= ce->wait_ms + added_wait_ms;
-			added_wait_ms = 0;
-			wait_ms = 0;
-			se_prev->next = ce;
-			se_prev = ce;
-			se_prev->next = se;
-		} else {
-			SAU_ParseEvData *se_next = se->next;
-			ce->wait_ms -= wait_ms;
-			added_wait_ms += ce->wait_ms;
-			wait_ms = 0;
-			se->next = ce;
-			ce->next = se_next;
-			se_prev = ce;
-			se = se_next;
-		}
-		ce = ce_next;
+		a[i] = a[parent];
+		i = parent;
+	}
+	a[i] = *item;
+	return true;
+}
+
+/*
+ * Remove first item from non-empty min-heap, copying it to \p item.
+ */
+static void CompositeHeap_pop(CompositeHeap *restrict o,
+		CompositeItem *restrict item) {
+	CompositeItem *a = o->a;
+	*item = a[0];
+	CompositeItem last = a[--o->count];
+	size_t i = 0;
+	for (;;) {
+		size_t child = 2*i + 1;
+		if (child >= o->count)
+			break;
+		if (child + 1 < o->count &&
+				CompositeItem_before(&a[child + 1], &a[child]))
+			++child;
+		if (!CompositeItem_before(&a[child], &last))
+			break;
+		a[i] = a[child];
+		i = child;
 	}
-	e->composite = NULL;
+	if (o->count > 0)
+		a[i] = last;
 }
 
+/*
+ * Event converted when pipelined, held back until the later use
+ * of its operators is known.
+ */
+typedef struct HeldEvent {
+	SAU_ScriptEvData *e;
+	SAU_ParseChunk *chunk;
+} HeldEvent;
+
+sauArrType(HeldEventArr, HeldEvent, _)
+
+/*
+ * Top-level events are taken in one at a time, and each converted
+ * as soon as its timing is final, along with composite events due.
+ *
+ * Composite events are given their place in the ordinary event list
+ * in an ordered merge by time. Each sequence of composites waits in
+ * a heap, one event at a time, while the ordinary sequence is taken
+ * in. At equal times, composites are placed before ordinary events,
+ * and those of an event placed later before those of an earlier one.
+ *
+ * The events of a duration group are held back from the first with
+ * an operator time left to set, until the end of the group.
+ *
+ * Repeated events are converted once, the repetition kept as a loop
+ * set for them. Its timing is applied at the end of its last duration
+ * group, the time of the events which follow moved past it.
+ *
+ * When pipelined, events are passed on in order once converted, except
+ * that labeled operators may be used again by any later event. Their
+ * events are held back, along with all after, until a later node for
+ * each such operator is converted, or the script ends, so that voices
+ * and operators are allocated the same as when the script is whole.
+ */
 typedef struct ParseConv {
 	SAU_ScriptEvData *ev, *first_ev;
 	SAU_MemPool *mem, *tmp;
+	SAU_MemPool *keep; // for data of labeled operators, if pipelined
+	/* timing */
+	SAU_ParseDurGroup *dur;
+	SAU_ParseEvData *dur_ev; // first held back for duration group
+	uint32_t dur_wait_ms;
+	uint64_t main_time_ms, time_ms;
+	SAU_ParseLoop *dur_loop; // repetition of duration group, if any
+	uint64_t loop_time_ms; // time of first event of repetition
+	/* flattening */
+	CompositeHeap composites;
+	uint32_t composite_order;
+	/* pipelining */
+	SAU_ScriptEv_f ev_f;
+	void *ev_data;
+	SAU_ScriptOptions sopt; // as of the last event from parser
+	bool ev_f_error;
+	HeldEventArr held;
+	size_t held_first; // first of the held not yet passed on
 } ParseConv;
 
 /*
  * Per-operator data pointed to by all its nodes during conversion.
  */
 typedef struct OpContext {
-	SAU_ParseOpData *last_use;
+	SAU_ScriptOpData *last_use;
+	SAU_ScriptEvData *root_event;
 } OpContext;
 
+/*
+ * Get memory pool for data which may be used at any later point,
+ * if \p labeled. Such data is kept outside of the parse data chunks
+ * when pipelined.
+ */
+static inline SAU_MemPool *ParseConv_mem(ParseConv *restrict o,
+		SAU_MemPool *restrict mem, bool labeled) {
+	return (labeled && o->keep != NULL) ? o->keep : mem;
+}
+
 /*
  * Get operator context for node, updating associated data.
  *
@@ -230,9 +270,12 @@ static OpContext *ParseConv_update_opcontext(ParseConv *restrict o,
 	OpContext *oc = NULL;
 	SAU_ScriptEvData *e = o->ev;
 	if (!pod->prev) {
-		oc = SAU_MemPool_alloc(o->tmp, sizeof(OpContext));
+		oc = SAU_MemPool_alloc(ParseConv_mem(o, o->tmp,
+					pod->op_flags & SAU_PDOP_LABELED),
+				sizeof(OpContext));
 		if (!oc)
 			return NULL;
+		oc->root_event = pod->root_event->ev_conv;
 		if (od->use_type == SAU_POP_CARR) {
 			e->ev_flags |= SAU_SDEV_NEW_OPGRAPH;
 			od->op_flags |= SAU_SDOP_ADD_CARRIER;
@@ -251,13 +294,32 @@ static OpContext *ParseConv_update_opcontext(ParseConv *restrict o,
 		if (od->use_type == SAU_POP_CARR) {
 			od->op_flags |= SAU_SDOP_ADD_CARRIER;
 		}
-		SAU_ScriptOpData *prev_use = oc->last_use->op_conv;
+		SAU_ScriptOpData *prev_use = oc->last_use;
 		od->prev_use = prev_use;
 		prev_use->next_use = od;
-		prev_use->event->ev_flags |= SAU_SDEV_LATER_USED;
-		e->root_ev = od->root_event;
+		if (!o->ev_f ||
+				(prev_use->op_flags & SAU_SDOP_USE_PENDING) != 0) {
+			prev_use->op_flags &= ~SAU_SDOP_USE_PENDING;
+			prev_use->op_flags |= SAU_SDOP_LATER_USED;
+			prev_use->event->ev_flags |= SAU_SDEV_LATER_USED;
+		}
+		e->root_ev = oc->root_event;
+	}
+	od->root_event = oc->root_event;
+	if (o->ev_f != NULL) {
+		/*
+		 * Passed on before later nodes are converted. Later use
+		 * is known if a later node is parsed; otherwise, unknown
+		 * while any later reference to a label may follow.
+		 */
+		if (pod->op_flags & SAU_PDOP_LATER_USED) {
+			od->op_flags |= SAU_SDOP_LATER_USED;
+			e->ev_flags |= SAU_SDEV_LATER_USED;
+		} else if (pod->op_flags & SAU_PDOP_LABELED) {
+			od->op_flags |= SAU_SDOP_USE_PENDING;
+		}
 	}
-	oc->last_use = pod;
+	oc->last_use = od;
 	pod->op_context = oc;
 	return oc;
 }
@@ -268,12 +330,14 @@ static OpContext *ParseConv_update_opcontext(ParseConv *restrict o,
  */
 static bool ParseConv_add_opdata(ParseConv *restrict o,
 		SAU_ParseOpData *restrict pod) {
-	SAU_ScriptOpData *od = SAU_MemPool_alloc(o->mem,
+	SAU_MemPool *mem = ParseConv_mem(o, o->mem,
+			pod->op_flags & SAU_PDOP_LABELED);
+	SAU_ScriptOpData *od = SAU_MemPool_alloc(mem,
 			sizeof(SAU_ScriptOpData));
 	if (!od) goto ERROR;
 	SAU_ScriptEvData *e = o->ev;
 	pod->op_conv = od;
-	od->root_event = pod->root_event->ev_conv;
+	/* root_event */
 	od->event = e;
 	/* next_bound */
 	/* op_flags */
@@ -288,6 +352,12 @@ static bool ParseConv_add_opdata(ParseConv *restrict o,
 	od->amp2 = pod->amp2;
 	od->pan = pod->pan;
 	od->phase = pod->phase;
+	if (pod->args != NULL) {
+		od->args = SAU_MemPool_memdup(mem, pod->args,
+				sizeof(SAU_ProgramArgList) +
+				sizeof(SAU_ProgramArgSlot) * pod->args->count);
+		if (!od->args) goto ERROR;
+	}
 	if (!ParseConv_update_opcontext(o, od, pod)) goto ERROR;
 	if (!e->op_all.first)
 		e->op_all.first = od;
@@ -299,6 +369,32 @@ ERROR:
 	return false;
 }
 
+/*
+ * Copy script arguments declared in \p p to \p s,
+ * with their names, using \p mem.
+ *
+ * \return true, or false on allocation failure
+ */
+static bool copy_args(SAU_Script *restrict s, const SAU_Parse *restrict p,
+		SAU_MemPool *restrict mem) {
+	if (!p->arg_count)
+		return true;
+	SAU_ProgramArg *args = SAU_MemPool_alloc(mem,
+			sizeof(SAU_ProgramArg) * p->arg_count);
+	if (!args)
+		return false;
+	for (uint32_t i = 0; i < p->arg_count; ++i) {
+		const char *name = p->args[i].name;
+		args[i].name = SAU_MemPool_memdup(mem, name, strlen(name) + 1);
+		if (!args[i].name)
+			return false;
+		args[i].def_val = p->args[i].def_val;
+	}
+	s->args = args;
+	s->arg_count = p->arg_count;
+	return true;
+}
+
 /*
  * Recursively create needed operator data nodes,
  * visiting new operator nodes as they branch out.
@@ -329,36 +425,72 @@ ERROR:
 	return false;
 }
 
+/*
+ * Check whether operator data node is to be added to a list.
+ */
+static inline bool in_list(const SAU_ScriptEvData *restrict e,
+		const SAU_ScriptOpData *restrict od, uint8_t list_type) {
+	return (list_type != SAU_POP_CARR ||
+		((e->ev_flags & SAU_SDEV_NEW_OPGRAPH) &&
+		 (od->op_flags & SAU_SDOP_ADD_CARRIER)));
+}
+
+/*
+ * Create list for the operator data nodes, sized to hold
+ * those to be added.
+ *
+ * \return instance, or NULL on error
+ */
+static SAU_ScriptOpList *ParseConv_create_list(ParseConv *restrict o,
+		const SAU_NodeRange *restrict pod_list,
+		uint8_t list_type) {
+	uint32_t count = 0;
+	SAU_ParseOpData *pod = pod_list->first;
+	for (; pod != NULL; pod = pod->range_next) {
+		if (pod->op_flags & SAU_PDOP_IGNORED) continue;
+		SAU_ScriptOpData *od = pod->op_conv;
+		if (!od)
+			return NULL;
+		if (in_list(o->ev, od, list_type)) ++count;
+	}
+	SAU_ScriptOpList *ol = SAU_MemPool_alloc(o->mem,
+			sizeof(SAU_ScriptOpList) +
+			sizeof(SAU_ScriptOpData*) * count);
+	if (!ol)
+		return NULL;
+	ol->use_type = list_type;
+	return ol;
+}
+
 /*
  * Recursively fill in lists for operator node graph,
  * visiting all linked operator nodes as they branch out.
  */
 static bool ParseConv_link_ops(ParseConv *restrict o,
-		SAU_RefList *restrict *od_list,
+		SAU_ScriptOpList *restrict *od_list,
 		const SAU_NodeRange *restrict pod_list,
 		uint8_t list_type) {
 	if (!pod_list)
 		return true;
 	SAU_ScriptEvData *e = o->ev;
+	SAU_ScriptOpList *ol = NULL;
 	if (list_type != SAU_POP_CARR ||
 			(e->ev_flags & SAU_SDEV_NEW_OPGRAPH) != 0) {
-		*od_list = SAU_create_RefList(list_type, o->mem);
-		if (!*od_list) goto ERROR;
+		ol = ParseConv_create_list(o, pod_list, list_type);
+		if (!ol) goto ERROR;
+		*od_list = ol;
 	}
 	SAU_ParseOpData *pod = pod_list->first;
 	for (; pod != NULL; pod = pod->range_next) {
 		if (pod->op_flags & SAU_PDOP_IGNORED) continue;
 		SAU_ScriptOpData *od = pod->op_conv;
 		if (!od) goto ERROR;
-		if ((list_type != SAU_POP_CARR ||
-				 ((e->ev_flags & SAU_SDEV_NEW_OPGRAPH) &&
-				  (od->op_flags & SAU_SDOP_ADD_CARRIER))) &&
-				!SAU_RefList_add(*od_list, od, 0, o->mem))
-			goto ERROR;
-		SAU_RefList *last_mod_list = NULL;
+		if (in_list(e, od, list_type))
+			ol->ops[ol->count++] = od;
+		SAU_ScriptOpList *last_mod_list = NULL;
 		for (SAU_ParseSublist *scope = pod->nest_scopes;
 				scope != NULL; scope = scope->next) {
-			SAU_RefList *next_mod_list = NULL;
+			SAU_ScriptOpList *next_mod_list = NULL;
 			if (!ParseConv_link_ops(o, &next_mod_list,
 						&scope->range,
 						scope->use_type)) goto ERROR;
@@ -379,15 +511,20 @@ ERROR:
  */
 static bool ParseConv_add_event(ParseConv *restrict o,
 		SAU_ParseEvData *restrict pe) {
-	SAU_ScriptEvData *e = SAU_MemPool_alloc(o->mem,
+	SAU_ScriptEvData *e = SAU_MemPool_alloc(ParseConv_mem(o, o->mem,
+				pe->ev_flags & SAU_PDEV_LABELED_ROOT),
 			sizeof(SAU_ScriptEvData));
 	if (!e) goto ERROR;
 	pe->ev_conv = e;
-	if (!o->first_ev)
-		o->first_ev = e;
-	else
-		o->ev->next = e;
+	if (!o->ev_f) {
+		if (!o->first_ev)
+			o->first_ev = e;
+		else
+			o->ev->next = e;
+	}
 	o->ev = e;
+	if (pe->loop != NULL)
+		e->loop = pe->loop->loop_conv;
 	e->wait_ms = pe->wait_ms;
 	/* ev_flags */
 	const SAU_NodeRange ev_op = {.first = pe->op_data};
@@ -399,6 +536,280 @@ ERROR:
 	return false;
 }
 
+/*
+ * Pass on the held events, in order, up to the first with
+ * an operator for which later use is not yet known. The parse
+ * data chunk of each is then released.
+ *
+ * \return true, or false on error
+ */
+static bool ParseConv_pass_held(ParseConv *restrict o) {
+	HeldEventArr *held = &o->held;
+	while (o->held_first < held->count) {
+		HeldEvent *he = &held->a[o->held_first];
+		SAU_ScriptOpData *od = he->e->op_all.first;
+		for (; od != NULL; od = od->range_next) {
+			if (od->op_flags & SAU_SDOP_USE_PENDING)
+				return true;
+		}
+		if (!o->ev_f(o->ev_data, he->e, &o->sopt)) {
+			o->ev_f_error = true;
+			return false;
+		}
+		SAU_ParseChunk_release(he->chunk);
+		++o->held_first;
+	}
+	held->count = 0; // re-use allocation
+	o->held_first = 0;
+	return true;
+}
+
+/*
+ * Convert event placed at \p time_ms, adding the first of any
+ * composites to the heap. If pipelined, pass on the result and
+ * release the chunk of the parse data, once nothing is held back.
+ *
+ * \return true, or false on error
+ */
+static bool ParseConv_place_event(ParseConv *restrict o,
+		SAU_ParseEvData *restrict pe, uint64_t time_ms) {
+	if (pe->composite != NULL) {
+		CompositeItem item = {
+			.time_ms = time_ms + pe->composite->wait_ms,
+			.order = o->composite_order++,
+			.e = pe->composite,
+		};
+		if (!CompositeHeap_push(&o->composites, &item)) return false;
+		pe->composite = NULL;
+	}
+	if (pe->loop != NULL && !pe->loop->loop_conv) {
+		SAU_ScriptLoop *loop = SAU_MemPool_alloc(ParseConv_mem(o,
+					o->mem, true), sizeof(SAU_ScriptLoop));
+		if (!loop) return false;
+		loop->count = pe->loop->count;
+		pe->loop->loop_conv = loop;
+		o->loop_time_ms = time_ms;
+	}
+	pe->wait_ms = time_ms - o->time_ms;
+	o->time_ms = time_ms;
+	if (pe->chunk != NULL)
+		o->mem = o->tmp = pe->chunk->mem;
+	if (!ParseConv_add_event(o, pe))
+		return false;
+	if (o->ev_f != NULL) {
+		HeldEvent he = {o->ev, pe->chunk};
+		if (!_HeldEventArr_add(&o->held, &he) ||
+				!ParseConv_pass_held(o)) return false;
+	}
+	return true;
+}
+
+/*
+ * Place composite events due by \p time_ms, each
+ * replaced in the heap by the next in its sequence.
+ *
+ * \return true, or false on error
+ */
+static bool ParseConv_place_composites(ParseConv *restrict o,
+		uint64_t time_ms) {
+	CompositeHeap *heap = &o->composites;
+	while (heap->count > 0 && heap->a[0].time_ms <= time_ms) {
+		CompositeItem item;
+		CompositeHeap_pop(heap, &item);
+		SAU_ParseEvData *e = item.e;
+		if (e->next != NULL) {
+			CompositeItem next_item = {
+				.time_ms = item.time_ms + e->next->wait_ms,
+				.order = item.order,
+				.e = e->next,
+			};
+			if (!CompositeHeap_push(heap, &next_item)) return false;
+		}
+		if (!ParseConv_place_event(o, e, item.time_ms)) return false;
+	}
+	return true;
+}
+
+/*
+ * Place top-level event with final timing after
+ * the composite events due before it.
+ *
+ * \return true, or false on error
+ */
+static bool ParseConv_release_event(ParseConv *restrict o,
+		SAU_ParseEvData *restrict pe) {
+	o->main_time_ms += pe->wait_ms;
+	return ParseConv_place_composites(o, o->main_time_ms) &&
+		ParseConv_place_event(o, pe, o->main_time_ms);
+}
+
+/*
+ * Adjust timing for the end of the last duration group of a repetition,
+ * after releasing its events. A run lasts from the first event until
+ * the end of the group, \p wait after the last, or until the last event
+ * if later, composites included. The period defaults to that length,
+ * and a shorter period given is lengthened to it. Time after continues
+ * from the end of the last run, as with '|'. A count which would take
+ * the end past LOOP_END_MAX_MS is lowered, with a warning.
+ *
+ * \return true, or false on error
+ */
+static bool ParseConv_end_loop(ParseConv *restrict o, uint32_t wait) {
+	SAU_ParseLoop *pl = o->dur_loop;
+	SAU_ScriptLoop *loop = pl->loop_conv;
+	o->dur_loop = NULL;
+	if (!ParseConv_place_composites(o, UINT64_MAX)) return false;
+	if (!loop)
+		return true;
+	/*
+	 * A run is as long as its events, or as long as
+	 * the time to the last event if that is later.
+	 */
+	uint64_t span = o->main_time_ms + wait - o->loop_time_ms;
+	if (span < o->time_ms - o->loop_time_ms)
+		span = o->time_ms - o->loop_time_ms;
+	uint64_t period = span;
+	if (pl->period_ms > span) {
+		period = pl->period_ms;
+	} else if (pl->period_ms > 0 && pl->period_ms < span) {
+		SAU_warning("parseconv",
+"%s:%d: repeat period %.3f shorter than events repeated, using %.3f",
+				pl->name, pl->line_num,
+				pl->period_ms * .001f, span * .001f);
+	}
+	if (period > UINT32_MAX)
+		period = UINT32_MAX;
+	uint64_t end_ms = o->loop_time_ms + span +
+		(uint64_t) (loop->count - 1) * period;
+	if (end_ms > LOOP_END_MAX_MS) {
+		uint64_t fit_ms = o->loop_time_ms + span;
+		uint32_t count = (period > 0 && fit_ms < LOOP_END_MAX_MS) ?
+			1 + (LOOP_END_MAX_MS - fit_ms) / period : 1;
+		SAU_warning("parseconv",
+"%s:%d: repeat count %" PRIu32 " too large for time limit, using %" PRIu32,
+				pl->name, pl->line_num, loop->count, count);
+		loop->count = count;
+	}
+	loop->period_ms = period;
+	o->time_ms += (uint64_t) (loop->count - 1) * period;
+	o->main_time_ms = o->loop_time_ms +
+		(uint64_t) (loop->count - 1) * period + span;
+	return true;
+}
+
+/*
+ * Adjust timing for the end of a duration group, before \p e_after,
+ * releasing the events held back. The script syntax for time grouping
+ * is only allowed on the "top" operator level, so the algorithm only
+ * deals with this for the events involved.
+ *
+ * \return true, or false on error
+ */
+static bool ParseConv_end_durgroup(ParseConv *restrict o,
+		SAU_ParseEvData *restrict e_after) {
+	SAU_ParseEvData *e = o->dur_ev;
+	uint32_t wait = o->dur_wait_ms, waitcount = 0;
+	o->dur_ev = NULL;
+	o->dur_wait_ms = 0;
+	if (e != NULL) {
+		for (SAU_ParseEvData *we = e; we != e_after; ) {
+			we = we->next;
+			if (we != NULL)
+				waitcount += we->wait_ms;
+		}
+		while (e != e_after) {
+			SAU_ParseOpData *op = e->op_data;
+			SAU_ParseEvData *next = e->next;
+			if (op != NULL && !(op->time.flags & SAU_TIMEP_SET)) {
+				/* fill in sensible default time */
+				op->time.v_ms = wait + waitcount;
+				op->time.flags |= SAU_TIMEP_SET;
+			}
+			if (!ParseConv_release_event(o, e)) return false;
+			e = next;
+			if (e != NULL)
+				waitcount -= e->wait_ms;
+		}
+	}
+	if (o->dur_loop != NULL &&
+			(!e_after || e_after->loop != o->dur_loop))
+		return ParseConv_end_loop(o, wait);
+	if (e_after != NULL)
+		e_after->wait_ms += wait;
+	return true;
+}
+
+/*
+ * Take in the next top-level event, adjusting timing,
+ * and convert events for which it's final.
+ *
+ * \return true, or false on error
+ */
+static bool ParseConv_take_event(ParseConv *restrict o,
+		SAU_ParseEvData *restrict pe) {
+	/*
+	 * Adjust default ramp durations, handle silence as well as
+	 * adding event duration to wait time of next event, and time
+	 * composites, before flattening.
+	 */
+	time_event(pe);
+	if (pe->dur != o->dur) {
+		if (!ParseConv_end_durgroup(o, pe)) return false;
+		o->dur = pe->dur;
+		o->dur_loop = pe->loop;
+	}
+	SAU_ParseOpData *op = pe->op_data;
+	if (op != NULL && o->dur_wait_ms < op->time.v_ms)
+		o->dur_wait_ms = op->time.v_ms;
+	if (!o->dur_ev && (!op || (op->time.flags & SAU_TIMEP_SET)))
+		return ParseConv_release_event(o, pe);
+	if (!o->dur_ev)
+		o->dur_ev = pe;
+	return true;
+}
+
+/*
+ * Convert the events left after the last taken in.
+ *
+ * \return true, or false on error
+ */
+static bool ParseConv_finish(ParseConv *restrict o) {
+	if (!ParseConv_end_durgroup(o, NULL) ||
+			!ParseConv_place_composites(o, UINT64_MAX))
+		return false;
+	if (o->ev_f != NULL) {
+		/*
+		 * No later uses remain to be found.
+		 */
+		for (size_t i = o->held_first; i < o->held.count; ++i) {
+			SAU_ScriptOpData *od = o->held.a[i].e->op_all.first;
+			for (; od != NULL; od = od->range_next)
+				od->op_flags &= ~SAU_SDOP_USE_PENDING;
+		}
+		return ParseConv_pass_held(o);
+	}
+	return true;
+}
+
+/*
+ * Take in event when pipelined, or finish if \p pe is NULL,
+ * reporting any error not reported by the callback.
+ *
+ * \return true, or false on error
+ */
+static bool ParseConv_pipe_event(void *restrict data,
+		SAU_ParseEvData *restrict pe,
+		const SAU_ScriptOptions *restrict sopt) {
+	ParseConv *o = data;
+	o->sopt = *sopt;
+	bool ok = (pe != NULL) ?
+		ParseConv_take_event(o, pe) :
+		ParseConv_finish(o);
+	if (!ok && !o->ev_f_error)
+		SAU_error("parseconv", "memory allocation failure");
+	return ok;
+}
+
 /*
  * Convert parser output to script data, performing
  * post-parsing passes. Perform timing adjustments,
@@ -409,11 +820,7 @@ ERROR:
  */
 static SAU_Script *ParseConv_convert(ParseConv *restrict o,
 		SAU_Parse *restrict p) {
-	SAU_ParseEvData *pe;
-	for (pe = p->events; pe != NULL; pe = pe->next) {
-		time_event(pe);
-		if (pe == pe->dur->range.last) time_durgroup(pe);
-	}
+	SAU_ParseEvData *pe, *next_pe;
 	o->mem = SAU_create_MemPool(0);
 	o->tmp = p->mem;
 	if (!o->mem || !o->tmp) goto ERROR;
@@ -422,15 +829,12 @@ static SAU_Script *ParseConv_convert(ParseConv *restrict o,
 	s->name = p->name;
 	s->sopt = p->sopt;
 	s->mem = o->mem;
-	/*
-	 * Convert events, flattening the remaining list while proceeding.
-	 * Flattening must be done following the timing adjustment pass;
-	 * otherwise, cannot always arrange events in the correct order.
-	 */
-	for (pe = p->events; pe != NULL; pe = pe->next) {
-		if (!ParseConv_add_event(o, pe)) goto ERROR;
-		if (pe->composite != NULL) flatten_events(pe);
+	if (!copy_args(s, p, o->mem)) goto ERROR;
+	for (pe = p->events; pe != NULL; pe = next_pe) {
+		next_pe = pe->next;
+		if (!ParseConv_take_event(o, pe)) goto ERROR;
 	}
+	if (!ParseConv_finish(o)) goto ERROR;
 	s->events = o->first_ev;
 	if (false)
 	ERROR: {
@@ -438,17 +842,21 @@ static SAU_Script *ParseConv_convert(ParseConv *restrict o,
 		SAU_error("parseconv", "memory allocation failure");
 		s = NULL;
 	}
+	_CompositeHeap_clear(&o->composites);
 	return s;
 }
 
 /**
  * Create script data for the given script. Invokes the parser.
+ * If not a path, \p script_arg is a string named \p name,
+ * or "<string>" if NULL.
  *
  * \return instance or NULL on error
  */
-SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path) {
+SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path,
+		const char *restrict name) {
 	ParseConv pc = (ParseConv){0};
-	SAU_Parse *p = SAU_create_Parse(script_arg, is_path);
+	SAU_Parse *p = SAU_create_Parse(script_arg, is_path, name);
 	if (!p)
 		return NULL;
 	SAU_Script *o = ParseConv_convert(&pc, p);
@@ -456,6 +864,53 @@ SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path) {
 	return o;
 }
 
+/**
+ * Pipeline loading of script data for the given script,
+ * passing on each event to \p ev_f as soon as it's final.
+ * The parser is invoked, and its data freed behind it
+ * as it goes, except for labeled parts.
+ *
+ * Events are not linked, and are only valid until the
+ * function returns after passing them. Operator data
+ * used by later events has SAU_SDOP_LATER_USED set.
+ * Errors from \p ev_f are to be reported by it.
+ *
+ * \return instance without events, or NULL on error
+ */
+SAU_Script *SAU_pipe_Script(const char *restrict script_arg, bool is_path,
+		const char *restrict name,
+		SAU_ScriptEv_f ev_f, void *restrict ev_data) {
+	ParseConv pc = (ParseConv){0};
+	pc.ev_f = ev_f;
+	pc.ev_data = ev_data;
+	SAU_Script *o = NULL;
+	SAU_Parse *p = NULL;
+	SAU_MemPool *mem = SAU_create_MemPool(0);
+	if (!mem) goto MEM_ERR;
+	pc.keep = mem;
+	p = SAU_pipe_Parse(script_arg, is_path, name,
+			ParseConv_pipe_event, &pc);
+	if (!p) goto DONE;
+	if (!ParseConv_pipe_event(&pc, NULL, &p->sopt)) goto DONE;
+	o = SAU_MemPool_alloc(mem, sizeof(SAU_Script));
+	if (!o) goto MEM_ERR;
+	o->name = p->name;
+	o->sopt = p->sopt;
+	if (!copy_args(o, p, mem)) goto MEM_ERR;
+	o->mem = mem;
+	mem = NULL; // keep for result
+	if (false)
+	MEM_ERR: {
+		SAU_error("parseconv", "memory allocation failure");
+	}
+DONE:
+	SAU_destroy_Parse(p);
+	_CompositeHeap_clear(&pc.composites);
+	_HeldEventArr_clear(&pc.held);
+	SAU_destroy_MemPool(mem);
+	return o;
+}
+
 /**
  * Destroy script data.
  */
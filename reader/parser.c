@@ -14,6 +14,7 @@
 #include "scanner.h"
 #include "parser.h"
 #include "../math.h"
+#include "../arrtype.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -26,10 +27,16 @@
 #define IS_UPPER(c) ((c) >= 'A' && (c) <= 'Z')
 #define IS_ALPHA(c) (IS_LOWER(c) || IS_UPPER(c))
 
+sauArrType(ArgArr, SAU_ProgramArg, _)
+
 typedef struct ScanLookup {
 	SAU_ScriptOptions sopt;
 	const char *const*wave_names;
 	const char *const*ramp_names;
+	ArgArr args; // script arguments declared
+	/* values scanned, pending until set for operator */
+	SAU_ProgramArgSlot arg_uses[SAU_PARG_TARGETS];
+	uint32_t arg_use_count;
 } ScanLookup;
 
 /*
@@ -205,6 +212,23 @@ DEFER:
 }
 static bool scan_num(SAU_Scanner *restrict o,
 		SAU_ScanNumConst_f scan_numconst, float *restrict var) {
+	if (SAU_Scanner_tryc(o, '$')) {
+		/*
+		 * Only values scanned using scan_argnum() can be
+		 * script arguments; skip the name for other values.
+		 */
+		SAU_ScanFrame sf = o->sf;
+		SAU_SymStr *s = NULL;
+		SAU_Scanner_get_symstr(o, &s);
+		if (!s) {
+			SAU_Scanner_warning(o, NULL,
+					"ignoring $ without argument name");
+			return false;
+		}
+		SAU_Scanner_warning(o, &sf,
+"ignoring argument \"%s\", not supported for this parameter", s->key);
+		return false;
+	}
 	NumParser np = {o, scan_numconst, o->sf, false};
 	uint8_t ws_level = o->ws_level;
 	float num = scan_num_r(&np, NUMEXP_NUM, 0);
@@ -221,6 +245,71 @@ static bool scan_num(SAU_Scanner *restrict o,
 	return true;
 }
 
+/*
+ * Record value scanned for \p target, replacing any earlier
+ * recorded. If \p arg_id is SAU_PARG_NO_ID, no argument is used.
+ */
+static void add_arg_use(ScanLookup *restrict sl,
+		uint32_t arg_id, uint8_t target, float mul) {
+	uint32_t i = 0;
+	while (i < sl->arg_use_count && sl->arg_uses[i].target != target)
+		++i;
+	if (i == sl->arg_use_count)
+		++sl->arg_use_count;
+	sl->arg_uses[i] = (SAU_ProgramArgSlot){arg_id, target, mul};
+}
+
+/*
+ * Scan numerical value for \p target, which may instead be given
+ * as a script argument "$name", optionally followed by "*" and a
+ * factor. The default value of the argument is then used, and the
+ * use recorded.
+ */
+static bool scan_argnum(SAU_Scanner *restrict o,
+		SAU_ScanNumConst_f scan_numconst, float *restrict var,
+		uint8_t target) {
+	ScanLookup *sl = o->data;
+	if (!SAU_Scanner_tryc(o, '$')) {
+		if (!scan_num(o, scan_numconst, var))
+			return false;
+		add_arg_use(sl, SAU_PARG_NO_ID, target, 1.f);
+		return true;
+	}
+	SAU_ScanFrame sf = o->sf;
+	SAU_SymStr *s = NULL;
+	SAU_Scanner_get_symstr(o, &s);
+	if (!s) {
+		SAU_Scanner_warning(o, NULL,
+				"ignoring $ without argument name");
+		return false;
+	}
+	uint32_t arg_id = 0;
+	while (arg_id < sl->args.count && sl->args.a[arg_id].name != s->key)
+		++arg_id;
+	if (arg_id == sl->args.count) {
+		SAU_Scanner_warning(o, &sf,
+				"ignoring undeclared argument \"%s\"", s->key);
+		return false;
+	}
+	float mul = 1.f;
+	if (SAU_Scanner_tryc(o, '*')) {
+		if (SAU_Scanner_tryc(o, '$')) {
+			sf = o->sf;
+			s = NULL;
+			SAU_Scanner_get_symstr(o, &s);
+			SAU_Scanner_warning(o, &sf,
+"ignoring argument \"%s\" as factor, arguments are not allowed as factors",
+					s ? s->key : "");
+			return false;
+		}
+		if (!scan_num(o, NULL, &mul))
+			return false;
+	}
+	*var = sl->args.a[arg_id].def_val * mul;
+	add_arg_use(sl, arg_id, target, mul);
+	return true;
+}
+
 static bool scan_time_val(SAU_Scanner *restrict o,
 		uint32_t *restrict val) {
 	SAU_ScanFrame sf = o->sf;
@@ -397,9 +486,9 @@ static bool scan_wavetype(SAU_Scanner *restrict o, size_t *restrict found_id) {
 
 static bool scan_fval_param(SAU_Scanner *restrict o,
 		SAU_ScanNumConst_f scan_numconst,
-		float *restrict fval,
+		float *restrict fval, uint8_t arg_target,
 		uint32_t *restrict param_attr, uint32_t flag) {
-	if (!scan_num(o, scan_numconst, fval))
+	if (!scan_argnum(o, scan_numconst, fval, arg_target))
 		return false;
 	*param_attr |= flag;
 	return true;
@@ -407,10 +496,10 @@ static bool scan_fval_param(SAU_Scanner *restrict o,
 
 static bool scan_ramp_param(SAU_Scanner *restrict o,
 		SAU_ScanNumConst_f scan_numconst,
-		SAU_Ramp *restrict ramp, bool rel,
+		SAU_Ramp *restrict ramp, bool rel, uint8_t arg_target,
 		uint32_t *restrict param_attr, uint32_t flag) {
 	if (!SAU_Scanner_tryc(o, '{')) {
-		if (!scan_fval_param(o, scan_numconst, &ramp->v0,
+		if (!scan_fval_param(o, scan_numconst, &ramp->v0, arg_target,
 					param_attr, flag))
 			return false;
 		ramp->flags |= SAU_RAMPP_STATE;
@@ -452,7 +541,7 @@ static bool scan_ramp_param(SAU_Scanner *restrict o,
 				time_set = true;
 			break;
 		case 'v':
-			if (scan_num(o, scan_numconst, &vt))
+			if (scan_argnum(o, scan_numconst, &vt, arg_target + 1))
 				goal = true;
 			break;
 		case '}':
@@ -491,25 +580,53 @@ RETURN:
  * Parser
  */
 
+/*
+ * Number of events after which a new chunk is begun,
+ * when pipelined.
+ */
+#define PIPE_CHUNK_EVENTS 256
+
 typedef struct SAU_Parser {
 	ScanLookup sl;
 	SAU_Scanner *sc;
 	SAU_SymTab *st;
 	SAU_MemPool *mp;
+	SAU_MemPool *node_mp; // for data nodes, same as mp unless pipelined
 	uint32_t call_level;
 	/* node state */
 	struct ParseLevel *cur_pl;
 	SAU_ParseDurGroup *cur_dur;
 	SAU_ParseEvData *ev, *first_ev;
+	SAU_ParseLoop *loop; // repetition events are added to, if any
+	/* pipelining */
+	SAU_ParseEv_f ev_f;
+	void *ev_data;
+	SAU_ParseEvData *pipe_ev; // first not yet passed on
+	SAU_ParseChunk *chunk, *first_chunk;
+	SAU_ParseChunk *last_op_chunk; // held for top-level last operator
+	uint32_t chunk_ev_count;
+	bool pipe_error;
 } SAU_Parser;
 
+/*
+ * Destroy the memory of the list of chunks.
+ */
+static void destroy_chunks(SAU_ParseChunk *restrict c) {
+	for (; c != NULL; c = c->next) {
+		SAU_destroy_MemPool(c->mem);
+		c->mem = NULL;
+	}
+}
+
 /*
  * Finalize parser instance.
  */
 static void fini_Parser(SAU_Parser *restrict o) {
 	SAU_destroy_Scanner(o->sc);
 	SAU_destroy_SymTab(o->st);
+	destroy_chunks(o->first_chunk);
 	SAU_destroy_MemPool(o->mp);
+	_ArgArr_clear(&o->sl.args);
 }
 
 /*
@@ -528,6 +645,7 @@ static bool init_Parser(SAU_Parser *restrict o) {
 	o->sc = sc;
 	o->st = st;
 	o->mp = mp;
+	o->node_mp = mp;
 	if (!sc || !st || !mp) goto ERROR;
 	if (!init_ScanLookup(&o->sl, st)) goto ERROR;
 	sc->filters['#'] = scan_filter_hashcommands;
@@ -546,6 +664,7 @@ enum {
 	SCOPE_BLOCK,
 	SCOPE_BIND,
 	SCOPE_NEST,
+	SCOPE_REPEAT,
 };
 
 typedef void (*ParseLevel_sub_f)(SAU_Parser *restrict o);
@@ -625,6 +744,60 @@ static void new_durgroup(SAU_Parser *restrict o) {
 	o->cur_dur = dur;
 }
 
+/**
+ * Release reference to chunk, freeing its memory once unused,
+ * unless labeled. Does nothing if \p o is NULL.
+ */
+void SAU_ParseChunk_release(SAU_ParseChunk *restrict o) {
+	if (!o || --o->refs > 0 || o->labeled)
+		return;
+	SAU_destroy_MemPool(o->mem);
+	o->mem = NULL;
+}
+
+/*
+ * Begin new chunk for data nodes, releasing the current.
+ * On allocation failure, the current chunk is kept.
+ */
+static void new_chunk(SAU_Parser *restrict o) {
+	SAU_ParseChunk *c = SAU_MemPool_alloc(o->mp, sizeof(SAU_ParseChunk));
+	if (!c)
+		return;
+	c->mem = SAU_create_MemPool(0);
+	if (!c->mem)
+		return;
+	c->refs = 1; // held while current
+	if (!o->chunk)
+		o->first_chunk = c;
+	else {
+		o->chunk->next = c;
+		SAU_ParseChunk_release(o->chunk);
+	}
+	o->chunk = c;
+	o->node_mp = c->mem;
+	o->chunk_ev_count = 0;
+}
+
+/*
+ * Pass on the top-level events before \p end, when pipelined.
+ * After an error, they are only skipped, and the rest of the
+ * file is not read, as nothing more will be used.
+ */
+static void pipe_events(SAU_Parser *restrict o,
+		SAU_ParseEvData *restrict end) {
+	SAU_ParseEvData *e = o->pipe_ev;
+	while (e != end) {
+		SAU_ParseEvData *next = e->next;
+		if (!o->pipe_error && !o->ev_f(o->ev_data, e, &o->sl.sopt)) {
+			o->pipe_error = true;
+			o->sc->s_flags |= SAU_SCAN_S_QUIET;
+			SAU_File_end(o->sc->f, 0, false);
+		}
+		e = next;
+	}
+	o->pipe_ev = e;
+}
+
 static void end_operator(SAU_Parser *restrict o) {
 	struct ParseLevel *pl = o->cur_pl;
 	if (!(pl->pl_flags & PL_ACTIVE_OP))
@@ -644,6 +817,14 @@ static void end_operator(SAU_Parser *restrict o) {
 			op->amp2.vt *= sl->sopt.ampmult;
 		}
 	}
+	if (op->args != NULL && !(op->op_flags & SAU_PDOP_NESTED)) {
+		for (uint32_t i = 0; i < op->args->count; ++i) {
+			SAU_ProgramArgSlot *slot = &op->args->slots[i];
+			if (slot->target >= SAU_PARG_AMP &&
+					slot->target <= SAU_PARG_AMP2_GOAL)
+				slot->mul *= sl->sopt.ampmult;
+		}
+	}
 	SAU_ParseOpData *pop = op->prev;
 	if (!pop) {
 		/*
@@ -653,6 +834,15 @@ static void end_operator(SAU_Parser *restrict o) {
 	}
 	pl->operator = NULL;
 	pl->last_operator = op;
+	if (!pl->parent && op->event->chunk != o->last_op_chunk) {
+		/*
+		 * Keep chunk while referenced as last operator.
+		 */
+		SAU_ParseChunk *c = op->event->chunk;
+		if (c != NULL) ++c->refs;
+		SAU_ParseChunk_release(o->last_op_chunk);
+		o->last_op_chunk = c;
+	}
 }
 
 static void end_event(SAU_Parser *restrict o) {
@@ -674,9 +864,24 @@ static void begin_event(SAU_Parser *restrict o,
 		bool is_composite) {
 	struct ParseLevel *pl = o->cur_pl;
 	end_event(o);
-	SAU_ParseEvData *e = SAU_MemPool_alloc(o->mp, sizeof(SAU_ParseEvData));
+	if (o->ev_f != NULL && !is_composite && !pl->parent) {
+		/*
+		 * Events before the last are final when pipelined.
+		 */
+		pipe_events(o, o->ev);
+		if (o->chunk_ev_count >= PIPE_CHUNK_EVENTS)
+			new_chunk(o);
+	}
+	SAU_ParseEvData *e = SAU_MemPool_alloc(o->node_mp,
+			sizeof(SAU_ParseEvData));
 	pl->event = e;
+	if (o->chunk != NULL) {
+		e->chunk = o->chunk;
+		++o->chunk->refs;
+		++o->chunk_ev_count;
+	}
 	e->dur = o->cur_dur;
+	e->loop = o->loop;
 	e->wait_ms = pl->next_wait_ms;
 	pl->next_wait_ms = 0;
 	if (pl->op_prev != NULL) {
@@ -692,7 +897,7 @@ static void begin_event(SAU_Parser *restrict o,
 	}
 	if (!is_composite) {
 		if (!o->first_ev)
-			o->first_ev = e;
+			o->first_ev = o->pipe_ev = e;
 		else
 			o->ev->next = e;
 		o->ev = e;
@@ -711,7 +916,14 @@ static void begin_operator(SAU_Parser *restrict o,
 	 * It is assumed that a valid voice event exists.
 	 */
 	end_operator(o);
-	SAU_ParseOpData *op = SAU_MemPool_alloc(o->mp, sizeof(SAU_ParseOpData));
+	/*
+	 * Labeled nodes may be referred back to at any later point,
+	 * so are kept outside of chunks if pipelined.
+	 */
+	bool labeled = (pl->set_label != NULL ||
+			(!is_composite && pop != NULL && pop->label != NULL));
+	SAU_ParseOpData *op = SAU_MemPool_alloc(labeled ? o->mp : o->node_mp,
+			sizeof(SAU_ParseOpData));
 	pl->operator = op;
 	if (!pl->first_operator)
 		pl->first_operator = op;
@@ -731,7 +943,9 @@ static void begin_operator(SAU_Parser *restrict o,
 		op->use_type = pop->use_type;
 		op->prev = pop;
 		op->op_flags = pop->op_flags &
-			(SAU_PDOP_NESTED | SAU_PDOP_MULTIPLE);
+			(SAU_PDOP_NESTED | SAU_PDOP_MULTIPLE |
+			 SAU_PDOP_LABELED);
+		pop->op_flags |= SAU_PDOP_LATER_USED;
 		if (is_composite) {
 			pop->op_flags |= SAU_PDOP_HAS_COMPOSITE;
 		} else {
@@ -796,6 +1010,16 @@ static void begin_operator(SAU_Parser *restrict o,
 		op->label = pl->set_label;
 		op->label->data = op;
 		pl->set_label = NULL;
+		if (!pop) {
+			op->root_event->ev_flags |= SAU_PDEV_LABELED_ROOT;
+		} else if (!(pop->op_flags & SAU_PDOP_LABELED) &&
+				o->chunk != NULL) {
+			/*
+			 * Earlier data for the operator is in this chunk.
+			 */
+			o->chunk->labeled = true;
+		}
+		op->op_flags |= SAU_PDOP_LABELED;
 	} else if (!is_composite && pop != NULL && pop->label != NULL) {
 		op->label = pop->label;
 		op->label->data = op;
@@ -834,7 +1058,7 @@ static void enter_level(SAU_Parser *restrict o, struct ParseLevel *restrict pl,
 		// handle newscope == SCOPE_TOP here
 		if (!o->cur_dur) new_durgroup(o);
 		if (use_type != SAU_POP_CARR) {
-			pl->op_scope = create_op_scope(use_type, o->mp);
+			pl->op_scope = create_op_scope(use_type, o->node_mp);
 		}
 		return;
 	}
@@ -851,13 +1075,22 @@ static void enter_level(SAU_Parser *restrict o, struct ParseLevel *restrict pl,
 	case SCOPE_BLOCK:
 		pl->op_scope = parent_pl->op_scope;
 		break;
+	case SCOPE_REPEAT:
+		/*
+		 * Any wait given before the repetition
+		 * is for its first event.
+		 */
+		pl->op_scope = parent_pl->op_scope;
+		pl->next_wait_ms = parent_pl->next_wait_ms;
+		parent_pl->next_wait_ms = 0;
+		break;
 	case SCOPE_BIND:
-		pl->op_scope = create_op_scope(use_type, o->mp);
+		pl->op_scope = create_op_scope(use_type, o->node_mp);
 		break;
 	case SCOPE_NEST:
 		pl->pl_flags |= PL_NESTED_SCOPE;
 		pl->parent_op = parent_pl->operator;
-		pl->op_scope = create_op_scope(use_type, o->mp);
+		pl->op_scope = create_op_scope(use_type, o->node_mp);
 		break;
 	default:
 		break;
@@ -871,10 +1104,10 @@ static void leave_level(SAU_Parser *restrict o) {
 		SAU_Scanner_warning(o->sc, NULL,
 				"ignoring label assignment without operator");
 	}
-	if (!pl->parent) {
+	if (!pl->parent || pl->scope == SCOPE_REPEAT) {
 		/*
 		 * At end of top scope, i.e. at end of script,
-		 * end last event and adjust timing.
+		 * or of repetition, end last event and adjust timing.
 		 */
 		end_event(o);
 	}
@@ -891,6 +1124,10 @@ static void leave_level(SAU_Parser *restrict o) {
 		if (pl->last_event != NULL)
 			pl->parent->last_event = pl->last_event;
 		break;
+	case SCOPE_REPEAT:
+		if (pl->last_event != NULL)
+			pl->parent->last_event = pl->last_event;
+		break;
 	case SCOPE_BIND:
 		/*
 		 * Begin multiple-operator node in parent scope
@@ -974,6 +1211,101 @@ DEFER:
 	pl->pl_flags |= PL_DEFERRED_SUB; /* let parse_level() look at it */
 }
 
+/*
+ * Parse script argument declaration, giving the name
+ * and default value.
+ */
+static void parse_argdecl(SAU_Parser *restrict o) {
+	ScanLookup *sl = &o->sl;
+	SAU_Scanner *sc = o->sc;
+	SAU_ScanFrame sf = sc->sf;
+	SAU_SymStr *s = NULL;
+	SAU_Scanner_get_symstr(sc, &s);
+	if (!s) {
+		SAU_Scanner_warning(sc, NULL,
+				"ignoring $ without argument name");
+		return;
+	}
+	if (!SAU_Scanner_tryc(sc, '=')) {
+		SAU_Scanner_warning(sc, NULL,
+"ignoring argument \"%s\" without '=' and default value", s->key);
+		return;
+	}
+	float def_val;
+	if (!scan_num(sc, scan_note_const, &def_val)) {
+		SAU_Scanner_warning(sc, &sf,
+"ignoring argument \"%s\" without default value", s->key);
+		return;
+	}
+	for (size_t i = 0; i < sl->args.count; ++i) {
+		if (sl->args.a[i].name == s->key) {
+			SAU_Scanner_warning(sc, &sf,
+"ignoring redeclaration of argument \"%s\"", s->key);
+			return;
+		}
+	}
+	if (sl->args.count > SAU_PARG_MAX_ID) {
+		SAU_Scanner_warning(sc, &sf,
+				"ignoring argument beyond maximum number");
+		return;
+	}
+	SAU_ProgramArg arg = {s->key, def_val};
+	if (!_ArgArr_add(&sl->args, &arg))
+		SAU_error("parser", "memory allocation failure");
+}
+
+/*
+ * Set the values scanned which use script arguments for the
+ * current operator, replacing any earlier use for each value.
+ */
+static void set_arg_uses(SAU_Parser *restrict o) {
+	ScanLookup *sl = &o->sl;
+	SAU_ParseOpData *op = o->cur_pl->operator;
+	uint32_t use_count = sl->arg_use_count;
+	sl->arg_use_count = 0;
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < use_count; ++i)
+		if (sl->arg_uses[i].arg_id != SAU_PARG_NO_ID) ++count;
+	if (!op->args && !count)
+		return; /* usual case */
+	const SAU_ProgramArgList *old = op->args;
+	if (old != NULL) {
+		for (uint32_t i = 0; i < old->count; ++i) {
+			uint32_t j = 0;
+			while (j < use_count &&
+					sl->arg_uses[j].target !=
+					old->slots[i].target) ++j;
+			if (j == use_count) ++count;
+		}
+	}
+	op->args = NULL;
+	if (!count)
+		return;
+	/* arguments are rarely used, so lists are kept with the parse */
+	SAU_ProgramArgList *list = SAU_MemPool_alloc(o->mp,
+			sizeof(SAU_ProgramArgList) +
+			sizeof(SAU_ProgramArgSlot) * count);
+	if (!list) {
+		SAU_error("parser", "memory allocation failure");
+		return;
+	}
+	if (old != NULL) {
+		for (uint32_t i = 0; i < old->count; ++i) {
+			uint32_t j = 0;
+			while (j < use_count &&
+					sl->arg_uses[j].target !=
+					old->slots[i].target) ++j;
+			if (j == use_count)
+				list->slots[list->count++] = old->slots[i];
+		}
+	}
+	for (uint32_t i = 0; i < use_count; ++i) {
+		if (sl->arg_uses[i].arg_id != SAU_PARG_NO_ID)
+			list->slots[list->count++] = sl->arg_uses[i];
+	}
+	op->args = list;
+}
+
 static void parse_level(SAU_Parser *restrict o,
 		uint8_t use_type, uint8_t newscope);
 
@@ -981,12 +1313,13 @@ static bool parse_ev_amp(SAU_Parser *restrict o) {
 	struct ParseLevel *pl = o->cur_pl;
 	SAU_Scanner *sc = o->sc;
 	SAU_ParseOpData *op = pl->operator;
-	scan_ramp_param(sc, NULL, &op->amp, false,
+	scan_ramp_param(sc, NULL, &op->amp, false, SAU_PARG_AMP,
 			&op->params, SAU_POPP_AMP);
 	if (SAU_Scanner_tryc(sc, ',')) {
-		scan_ramp_param(sc, NULL, &op->amp2, false,
+		scan_ramp_param(sc, NULL, &op->amp2, false, SAU_PARG_AMP2,
 				&op->params, SAU_POPP_AMP2);
 	}
+	set_arg_uses(o);
 	if (SAU_Scanner_tryc(sc, '~') && SAU_Scanner_tryc(sc, '[')) {
 		parse_level(o, SAU_POP_AMOD, SCOPE_NEST);
 	}
@@ -1000,7 +1333,8 @@ static bool parse_ev_chanmix(SAU_Parser *restrict o) {
 	if (op->op_flags & SAU_PDOP_NESTED)
 		return true; // reject
 	scan_ramp_param(sc, scan_chanmix_const, &op->pan, false,
-			&op->params, SAU_POPP_PAN);
+			SAU_PARG_PAN, &op->params, SAU_POPP_PAN);
+	set_arg_uses(o);
 	return false;
 }
 
@@ -1012,11 +1346,12 @@ static bool parse_ev_freq(SAU_Parser *restrict o, bool rel_freq) {
 		return true; // reject
 	SAU_ScanNumConst_f numconst_f = rel_freq ? NULL : scan_note_const;
 	scan_ramp_param(sc, numconst_f, &op->freq, rel_freq,
-			&op->params, SAU_POPP_FREQ);
+			SAU_PARG_FREQ, &op->params, SAU_POPP_FREQ);
 	if (SAU_Scanner_tryc(sc, ',')) {
 		scan_ramp_param(sc, numconst_f, &op->freq2, rel_freq,
-				&op->params, SAU_POPP_FREQ2);
+				SAU_PARG_FREQ2, &op->params, SAU_POPP_FREQ2);
 	}
+	set_arg_uses(o);
 	if (SAU_Scanner_tryc(sc, '~') && SAU_Scanner_tryc(sc, '[')) {
 		parse_level(o, SAU_POP_FMOD, SCOPE_NEST);
 	}
@@ -1027,12 +1362,13 @@ static bool parse_ev_phase(SAU_Parser *restrict o) {
 	struct ParseLevel *pl = o->cur_pl;
 	SAU_Scanner *sc = o->sc;
 	SAU_ParseOpData *op = pl->operator;
-	if (scan_fval_param(sc, NULL, &op->phase,
+	if (scan_fval_param(sc, NULL, &op->phase, SAU_PARG_PHASE,
 				&op->params, SAU_POPP_PHASE)) {
 		op->phase = fmod(op->phase, 1.f);
 		if (op->phase < 0.f)
 			op->phase += 1.f;
 	}
+	set_arg_uses(o);
 	if (SAU_Scanner_tryc(sc, '+') && SAU_Scanner_tryc(sc, '[')) {
 		parse_level(o, SAU_POP_PMOD, SCOPE_NEST);
 	}
@@ -1114,6 +1450,65 @@ DEFER:
 	pl->pl_flags |= PL_DEFERRED_SUB; /* let parse_level() look at it */
 }
 
+/*
+ * Parse repetition of the events within brackets, given the number
+ * of times and optionally the period. Time is separated before and
+ * after as with '|'.
+ */
+static void parse_repeat(SAU_Parser *restrict o, uint8_t use_type) {
+	SAU_Scanner *sc = o->sc;
+	SAU_ScanFrame sf = sc->sf;
+	float count;
+	uint32_t period_ms = 0;
+	if (!scan_num(sc, NULL, &count)) {
+		SAU_Scanner_warning(sc, &sf,
+				"ignoring repeat without number of times");
+		return;
+	}
+	while (SAU_Scanner_tryc(sc, SAU_SCAN_SPACE)) ;
+	if (SAU_Scanner_tryc(sc, 't')) {
+		scan_time_val(sc, &period_ms);
+		while (SAU_Scanner_tryc(sc, SAU_SCAN_SPACE)) ;
+	}
+	if (!SAU_Scanner_tryc(sc, '[')) {
+		SAU_Scanner_warning(sc, &sf,
+				"ignoring repeat without '[' and events");
+		return;
+	}
+	if (count < 1.f) {
+		SAU_Scanner_warning(sc, &sf,
+				"repeat count below 1, using 1");
+		count = 1.f;
+	}
+	SAU_ParseLoop *loop = NULL;
+	if (o->loop != NULL) {
+		SAU_Scanner_warning(sc, &sf,
+				"ignoring repeat within repetition");
+	} else {
+		loop = SAU_MemPool_alloc(o->mp, sizeof(SAU_ParseLoop));
+		if (!loop) {
+			SAU_error("parser", "memory allocation failure");
+		} else {
+			loop->count = (count < (float) UINT32_MAX) ?
+				lrintf(count) : UINT32_MAX;
+			loop->period_ms = period_ms;
+			loop->name = sc->f->path;
+			loop->line_num = sf.line_num;
+		}
+	}
+	end_event(o);
+	o->cur_pl->sub_f = NULL;
+	if (o->cur_dur->range.first != NULL)
+		new_durgroup(o);
+	if (loop != NULL)
+		o->loop = loop;
+	parse_level(o, use_type, SCOPE_REPEAT);
+	if (loop != NULL)
+		o->loop = NULL;
+	if (o->cur_dur->range.first != NULL)
+		new_durgroup(o);
+}
+
 static void parse_level(SAU_Parser *restrict o,
 		uint8_t use_type, uint8_t newscope) {
 	struct ParseLevel pl;
@@ -1137,8 +1532,22 @@ static void parse_level(SAU_Parser *restrict o,
 					goto RETURN;
 				pl.sub_f = NULL;
 				pl.first_operator = NULL;
+			} else if (pl.scope == SCOPE_REPEAT) {
+				/*
+				 * Within repetition, lines are
+				 * as on top level.
+				 */
+				pl.sub_f = NULL;
+				pl.first_operator = NULL;
 			}
 			break;
+		case '$':
+			/*
+			 * Script argument declaration.
+			 */
+			parse_argdecl(o);
+			pl.sub_f = NULL;
+			break;
 		case '\'':
 			/*
 			 * Label assignment (set to what follows).
@@ -1196,6 +1605,14 @@ static void parse_level(SAU_Parser *restrict o,
 				}
 			}
 			break;
+		case 'R':
+			if (pl.sub_f == parse_in_settings ||
+					(pl.pl_flags & PL_NESTED_SCOPE) != 0 ||
+					pl.scope == SCOPE_BIND)
+				goto INVALID;
+			parse_repeat(o, use_type);
+			pl.sub_f = NULL;
+			break;
 		case 'O': {
 			size_t wave;
 			if (!scan_wavetype(sc, &wave))
@@ -1274,10 +1691,11 @@ RETURN:
  * \return name of script, or NULL on error preventing parse
  */
 static const char *parse_file(SAU_Parser *restrict o,
-		const char *restrict script, bool is_path) {
+		const char *restrict script, bool is_path,
+		const char *restrict str_name) {
 	SAU_Scanner *sc = o->sc;
 	const char *name;
-	if (!SAU_Scanner_open(sc, script, is_path))
+	if (!SAU_Scanner_open(sc, script, is_path, str_name))
 		return NULL;
 	parse_level(o, SAU_POP_CARR, SCOPE_TOP);
 	name = sc->f->path;
@@ -1285,34 +1703,86 @@ static const char *parse_file(SAU_Parser *restrict o,
 	return name;
 }
 
-/**
- * Parse a file and return script data.
+/*
+ * Parse a file and return script data. If \p ev_f is not NULL,
+ * parsing is pipelined, passing on events as they become final.
  *
  * \return instance or NULL on error preventing parse
  */
-SAU_Parse* SAU_create_Parse(const char *restrict script_arg, bool is_path) {
+static SAU_Parse *run_parse(const char *restrict script_arg, bool is_path,
+		const char *restrict name,
+		SAU_ParseEv_f ev_f, void *restrict ev_data) {
 	if (!script_arg)
 		return NULL;
 	SAU_Parser pr;
 	if (!init_Parser(&pr))
 		return NULL;
 	SAU_Parse *o = NULL;
-	const char *name = parse_file(&pr, script_arg, is_path);
+	if (ev_f != NULL) {
+		pr.ev_f = ev_f;
+		pr.ev_data = ev_data;
+		new_chunk(&pr);
+	}
+	name = parse_file(&pr, script_arg, is_path, name);
 	if (!name) goto DONE;
+	if (ev_f != NULL) {
+		pipe_events(&pr, NULL);
+		SAU_ParseChunk_release(pr.last_op_chunk);
+		SAU_ParseChunk_release(pr.chunk);
+		if (pr.pipe_error) goto DONE;
+	}
 
 	o = SAU_MemPool_alloc(pr.mp, sizeof(SAU_Parse));
-	o->events = pr.first_ev;
+	o->events = (ev_f != NULL) ? NULL : pr.first_ev;
 	o->name = name;
 	o->sopt = pr.sl.sopt;
+	if (pr.sl.args.count > 0 &&
+			!_ArgArr_mpmemdup(&pr.sl.args, &o->args, pr.mp)) {
+		SAU_error("parser", "memory allocation failure");
+		o = NULL;
+		goto DONE;
+	}
+	o->arg_count = pr.sl.args.count;
 	o->symtab = pr.st;
+	o->chunks = pr.first_chunk;
 	o->mem = pr.mp;
 	pr.st = NULL; // keep for result
+	pr.first_chunk = NULL; // keep for result
 	pr.mp = NULL; // keep for result
 DONE:
 	fini_Parser(&pr);
 	return o;
 }
 
+/**
+ * Parse a file and return script data. If not a path,
+ * \p script_arg is a string named \p name (if not NULL).
+ *
+ * \return instance or NULL on error preventing parse
+ */
+SAU_Parse* SAU_create_Parse(const char *restrict script_arg, bool is_path,
+		const char *restrict name) {
+	return run_parse(script_arg, is_path, name, NULL, NULL);
+}
+
+/**
+ * Parse a file, passing on each top-level event to \p ev_f
+ * as soon as it's final, and return the remaining script data.
+ * Node memory is mostly split into chunks, each freed once all
+ * events in it have been released.
+ *
+ * Errors from \p ev_f are to be reported by it.
+ *
+ * \return instance or NULL on error
+ */
+SAU_Parse* SAU_pipe_Parse(const char *restrict script_arg, bool is_path,
+		const char *restrict name,
+		SAU_ParseEv_f ev_f, void *restrict ev_data) {
+	if (!ev_f)
+		return NULL;
+	return run_parse(script_arg, is_path, name, ev_f, ev_data);
+}
+
 /**
  * Destroy instance.
  */
@@ -1320,5 +1790,6 @@ void SAU_destroy_Parse(SAU_Parse *restrict o) {
 	if (!o)
 		return;
 	SAU_destroy_SymTab(o->symtab);
+	destroy_chunks(o->chunks);
 	SAU_destroy_MemPool(o->mem);
 }
@@ -46,6 +46,8 @@ enum {
 	SAU_PDOP_SILENCE_ADDED = 1<<2,
 	SAU_PDOP_HAS_COMPOSITE = 1<<3,
 	SAU_PDOP_IGNORED = 1<<4, // node skipped by parseconv
+	SAU_PDOP_LATER_USED = 1<<5, // a later node follows for operator
+	SAU_PDOP_LABELED = 1<<6, // operator labeled as of node
 };
 
 /**
@@ -70,18 +72,52 @@ typedef struct SAU_ParseOpData {
 	SAU_Ramp amp, amp2;
 	SAU_Ramp pan;
 	float phase;
+	SAU_ProgramArgList *args; /* NULL unless script arguments used */
 	/* for parseconv */
 	void *op_conv;
 	void *op_context;
 } SAU_ParseOpData;
 
+/**
+ * Repetition of the events within a repeat construct.
+ */
+typedef struct SAU_ParseLoop {
+	uint32_t count;
+	uint32_t period_ms; /* 0 if to be set from the events */
+	const char *name; /* script name and line, for warnings */
+	int32_t line_num;
+	/* for parseconv */
+	void *loop_conv;
+} SAU_ParseLoop;
+
 /**
  * Parse data event flags.
  */
 enum {
 	SAU_PDEV_ADD_WAIT_DURATION = 1<<0,
+	SAU_PDEV_LABELED_ROOT = 1<<1, // root event for labeled operator
 };
 
+/**
+ * Memory for parse data nodes, when parsing is pipelined.
+ *
+ * Nodes are allocated in the current chunk, replaced after a number
+ * of events. Each event, and the parser while it needs the data,
+ * holds a reference. The memory is freed when the last reference is
+ * released. Labeled nodes, which later nodes may refer back to, are
+ * allocated outside of chunks. If a label is only assigned to a later
+ * node for an operator, the chunk is instead marked as labeled, and
+ * kept until the parse is destroyed.
+ */
+typedef struct SAU_ParseChunk {
+	SAU_MemPool *mem;
+	struct SAU_ParseChunk *next;
+	size_t refs;
+	bool labeled;
+} SAU_ParseChunk;
+
+void SAU_ParseChunk_release(SAU_ParseChunk *restrict o);
+
 /**
  * Node type for event data. Includes any voice and operator data part
  * of the event.
@@ -89,7 +125,9 @@ enum {
 typedef struct SAU_ParseEvData {
 	struct SAU_ParseEvData *next;
 	struct SAU_ParseEvData *composite;
+	SAU_ParseChunk *chunk; /* NULL unless pipelined */
 	SAU_ParseDurGroup *dur;
+	SAU_ParseLoop *loop; /* NULL unless repeated */
 	uint32_t wait_ms;
 	uint32_t ev_flags;
 	SAU_ParseOpData *op_data;
@@ -101,13 +139,31 @@ typedef struct SAU_ParseEvData {
  * Type returned after processing a file.
  */
 typedef struct SAU_Parse {
-	SAU_ParseEvData *events;
+	SAU_ParseEvData *events; // NULL if pipelined
 	const char *name; // currently simply set to the filename
 	SAU_ScriptOptions sopt;
+	SAU_ProgramArg *args; // script arguments declared, named in symtab
+	uint32_t arg_count;
 	SAU_SymTab *symtab;
+	SAU_ParseChunk *chunks; // chunks left if pipelined
 	SAU_MemPool *mem; // internally used, provided until destroy
 } SAU_Parse;
 
-SAU_Parse *SAU_create_Parse(const char *restrict script_arg, bool is_path)
-	sauMalloclike;
+/**
+ * Function called with each top-level event once final, in order,
+ * when parsing is pipelined. Composite events are reached through
+ * their main event. The chunk of the event is to be released when
+ * done with it. The script options are passed as set so far.
+ *
+ * \return true, or false on error, stopping further calls
+ */
+typedef bool (*SAU_ParseEv_f)(void *restrict data,
+		SAU_ParseEvData *restrict e,
+		const SAU_ScriptOptions *restrict sopt);
+
+SAU_Parse *SAU_create_Parse(const char *restrict script_arg, bool is_path,
+		const char *restrict name) sauMalloclike;
+SAU_Parse *SAU_pipe_Parse(const char *restrict script_arg, bool is_path,
+		const char *restrict name,
+		SAU_ParseEv_f ev_f, void *restrict ev_data) sauMalloclike;
 void SAU_destroy_Parse(SAU_Parse *restrict o);
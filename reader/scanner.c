@@ -74,13 +74,15 @@ void SAU_destroy_Scanner(SAU_Scanner *restrict o) {
  *
  * Wrapper around SAU_File functions. \p script may be
  * either a file path or a string, depending on \p is_path.
+ * A string is named \p name, or "<string>" if NULL.
  *
  * \return true on success
  */
 bool SAU_Scanner_open(SAU_Scanner *restrict o,
-		const char *restrict script, bool is_path) {
+		const char *restrict script, bool is_path,
+		const char *restrict name) {
 	if (!is_path) {
-		SAU_File_stropenrb(o->f, "<string>", script);
+		SAU_File_stropenrb(o->f, name ? name : "<string>", script);
 	} else if (!SAU_File_fopenrb(o->f, script)) {
 		SAU_error(NULL,
 "couldn't open script file \"%s\" for reading", script);
@@ -121,16 +123,20 @@ static uint8_t filter_symchar(SAU_File *restrict o sauMaybeUnused,
  * Read identifier string into \p buf. At most \p buf_len - 1 characters
  * are read, and the string is always NULL-terminated.
  *
- * If \p lenp is not NULL, it will be used to set the string length.
+ * The symbol table hash of the string read is computed along the way
+ * and set using \p hashp. If \p lenp is not NULL, it will be used to
+ * set the string length.
  *
  * \return true if the string fit into the buffer, false if truncated
  */
 static bool read_symstr(SAU_File *restrict f,
 		uint8_t *restrict buf, size_t buf_len,
-		size_t *restrict lenp) {
+		size_t *restrict lenp, uint32_t *restrict hashp) {
+	SAU_SymHash hash;
 	size_t i = 0;
 	size_t max_len = buf_len - 1;
 	bool truncate = false;
+	SAU_SymHash_init(&hash);
 	for (;;) {
 		if (i == max_len) {
 			truncate = true;
@@ -142,9 +148,11 @@ static bool read_symstr(SAU_File *restrict f,
 			break;
 		}
 		buf[i++] = c;
+		SAU_SymHash_add(&hash, c);
 	}
 	buf[i] = '\0';
 	if (lenp) *lenp = i;
+	*hashp = SAU_SymHash_get(&hash);
 	return !truncate;
 }
 
@@ -264,6 +272,7 @@ uint8_t SAU_Scanner_filter_blockcomment(SAU_Scanner *restrict o,
 	int32_t line_num = o->sf.line_num;
 	int32_t char_num = o->sf.char_num;
 	for (;;) {
+		char_num += SAU_File_skiplinec(f, check_c);
 		uint8_t c = SAU_File_GETC(f);
 		++char_num;
 		if (c == '\n') {
@@ -496,30 +505,37 @@ uint8_t SAU_Scanner_setws_level(SAU_Scanner *restrict o, uint8_t ws_level) {
 }
 
 /*
- * Assign scan frame from undo buffer.
+ * Save scan frame to undo buffer position \p i.
  */
-static void restore_frame(SAU_Scanner *restrict o, uint32_t offset) {
-	uint32_t i = (o->undo_pos - offset) & SAU_SCAN_UNGET_MAX;
-	o->sf = o->undo[i];
+static inline void save_frame(SAU_Scanner *restrict o, uint32_t i) {
+	o->undo[i & SAU_SCAN_UNGET_MAX] = o->sf;
 }
 
 /*
- * Perform pending updates before a get call.
+ * Assign scan frame from undo buffer position \p i.
+ */
+static inline void restore_frame(SAU_Scanner *restrict o, uint32_t i) {
+	o->sf = o->undo[i & SAU_SCAN_UNGET_MAX];
+}
+
+/*
+ * Perform pending updates before a get call, saving the current
+ * scan frame. After ungets, the frame saved for the one returned
+ * to is kept, and those after it dropped.
  */
 static void prepare_frame(SAU_Scanner *restrict o) {
 	if (o->unget_num > 0) {
-		/*
-		 * Start from frame after the one ungotten to.
-		 */
-		restore_frame(o, --o->unget_num);
-		return;
-	}
-	if (o->s_flags & SAU_SCAN_S_DISCARD) {
-		o->s_flags &= ~SAU_SCAN_S_DISCARD;
+		o->undo_pos = (o->undo_pos + 1 - o->unget_num) &
+			SAU_SCAN_UNGET_MAX;
+		o->unget_num = 0;
 	} else {
-		o->undo_pos = (o->undo_pos + 1) & SAU_SCAN_UNGET_MAX;
+		if (o->s_flags & SAU_SCAN_S_DISCARD) {
+			o->s_flags &= ~SAU_SCAN_S_DISCARD;
+		} else {
+			o->undo_pos = (o->undo_pos + 1) & SAU_SCAN_UNGET_MAX;
+		}
+		save_frame(o, o->undo_pos);
 	}
-	o->undo[o->undo_pos] = o->sf;
 	if (o->sf.c_flags & SAU_SCAN_C_LNBRK_POSUP) {
 		o->sf.c_flags &= ~SAU_SCAN_C_LNBRK_POSUP;
 		pos_past_linebreak(o, 0);
@@ -527,6 +543,15 @@ static void prepare_frame(SAU_Scanner *restrict o) {
 	o->sf.c_flags &= ~(SAU_SCAN_C_SPACE | SAU_SCAN_C_LNBRK);
 }
 
+/*
+ * Undo prepare_frame() for a get which read nothing,
+ * dropping the frame saved.
+ */
+static void unprepare_frame(SAU_Scanner *restrict o) {
+	restore_frame(o, o->undo_pos);
+	o->undo_pos = (o->undo_pos - 1) & SAU_SCAN_UNGET_MAX;
+}
+
 /*
  * Set character used after filtering.
  *
@@ -545,25 +570,22 @@ static void set_usedc(SAU_Scanner *restrict o, uint8_t c) {
 
 /*
  * Perform updates after reading a sequence of characters,
- * e.g. a string or number. Prepares a temporary post-get scan frame.
+ * e.g. a string or number.
  */
 static void advance_frame(SAU_Scanner *o, size_t strlen, uint8_t c) {
-	if (strlen == 0)
-		return;
-	uint32_t reget_count = (strlen > o->unget_num) ?
-		o->unget_num :
-		strlen;
-	uint32_t char_inc = strlen;
-	if (reget_count > 0) {
-		/*
-		 * Advance past ungets prior to frame to restore to.
-		 */
-		o->unget_num -= (reget_count - 1);
-	}
-	prepare_frame(o);
-	o->sf.char_num += char_inc;
+	o->sf.char_num += strlen;
 	o->sf.c = c;
-	o->s_flags |= SAU_SCAN_S_DISCARD;
+}
+
+/*
+ * Get the character last ungotten, returning to the scan frame
+ * from the get of it.
+ */
+static uint8_t regetc(SAU_Scanner *restrict o) {
+	restore_frame(o, o->undo_pos + 2 - o->unget_num);
+	--o->unget_num;
+	SAU_File_INCP(o->f);
+	return o->sf.c;
 }
 
 /**
@@ -578,6 +600,8 @@ static void advance_frame(SAU_Scanner *o, size_t strlen, uint8_t c) {
 uint8_t SAU_Scanner_getc(SAU_Scanner *restrict o) {
 	SAU_File *f = o->f;
 	uint8_t c;
+	if (o->unget_num > 0)
+		return regetc(o);
 	prepare_frame(o);
 	for (;;) {
 		++o->sf.char_num;
@@ -585,8 +609,10 @@ uint8_t SAU_Scanner_getc(SAU_Scanner *restrict o) {
 		c = SAU_Scanner_usefilter(o, c, 0);
 		if (c != 0) break;
 	}
-	if (c == SAU_SCAN_EOF)
+	if (c == SAU_SCAN_EOF) {
+		o->sf.c = 0;
 		return 0;
+	}
 	set_usedc(o, c);
 	return c;
 }
@@ -606,7 +632,7 @@ bool SAU_Scanner_tryc(SAU_Scanner *restrict o, uint8_t testc) {
 	/*
 	 * Use quick handling for unfiltered characters.
 	 */
-	if (!SAU_Scanner_getfilter(o, c)) {
+	if (!o->unget_num && !SAU_Scanner_getfilter(o, c)) {
 		if (c != testc)
 			return false;
 		prepare_frame(o);
@@ -617,7 +643,6 @@ bool SAU_Scanner_tryc(SAU_Scanner *restrict o, uint8_t testc) {
 	}
 	c = SAU_Scanner_getc(o);
 	if (c != testc) {
-		o->s_flags |= SAU_SCAN_S_DISCARD;
 		SAU_Scanner_ungetc(o);
 		return false;
 	}
@@ -628,8 +653,9 @@ bool SAU_Scanner_tryc(SAU_Scanner *restrict o, uint8_t testc) {
  * Unget one character and jump to the previous scan frame.
  * The next get will jump back and begin with the last character got.
  *
- * The scan position is assigned from the undo buffer, with up to
- * SAU_SCAN_UNGET_MAX ungets allowed in a row.
+ * The scan position is assigned from the frame saved by the get,
+ * with up to SAU_SCAN_UNGET_MAX ungets allowed in a row. Getting the
+ * characters again with SAU_Scanner_getc() returns to their frames.
  *
  * Allows revisiting a character using a different scanning method.
  *
@@ -642,7 +668,10 @@ uint32_t SAU_Scanner_ungetc(SAU_Scanner *restrict o) {
 			SAU_SCAN_UNGET_MAX);
 		return o->unget_num;
 	}
-	restore_frame(o, ++o->unget_num);
+	if (!o->unget_num)
+		save_frame(o, o->undo_pos + 1); // to return to
+	++o->unget_num;
+	restore_frame(o, o->undo_pos + 1 - o->unget_num);
 	SAU_File *f = o->f;
 	SAU_File_UNGETC(f);
 	set_usedc(o, o->sf.c);
@@ -667,7 +696,7 @@ bool SAU_Scanner_geti(SAU_Scanner *restrict o,
 	++o->sf.char_num;
 	bool truncated = !SAU_File_geti(f, var, allow_sign, &read_len);
 	if (read_len == 0) {
-		o->s_flags |= SAU_SCAN_S_DISCARD;
+		unprepare_frame(o);
 		if (str_len) *str_len = 0;
 		return true;
 	}
@@ -722,7 +751,7 @@ bool SAU_Scanner_getd(SAU_Scanner *restrict o,
 	if (read_len == 0) {
 		if (sign)
 			SAU_File_DECP(f);
-		o->s_flags |= SAU_SCAN_S_DISCARD;
+		unprepare_frame(o);
 		if (str_len) *str_len = 0;
 		return true;
 	}
@@ -748,13 +777,14 @@ bool SAU_Scanner_get_symstr(SAU_Scanner *restrict o,
 		SAU_SymStr **restrict symstrp) {
 	SAU_File *f = o->f;
 	size_t len;
+	uint32_t hash;
 	bool truncated;
 	prepare_frame(o);
 	o->sf.c = SAU_File_RETC(f);
 	++o->sf.char_num;
-	truncated = !read_symstr(f, o->strbuf, STRBUF_LEN, &len);
+	truncated = !read_symstr(f, o->strbuf, STRBUF_LEN, &len, &hash);
 	if (len == 0) {
-		o->s_flags |= SAU_SCAN_S_DISCARD;
+		unprepare_frame(o);
 		*symstrp = NULL;
 		return true;
 	}
@@ -767,7 +797,8 @@ bool SAU_Scanner_get_symstr(SAU_Scanner *restrict o,
 	}
 	advance_frame(o, read_len - 1, SAU_File_RETC_NC(f));
 
-	SAU_SymStr *symstr = SAU_SymTab_get_symstr(o->symtab, o->strbuf, len);
+	SAU_SymStr *symstr = SAU_SymTab_get_symstr_hashed(o->symtab,
+			o->strbuf, len, hash);
 	if (!symstr) {
 		SAU_Scanner_error(o, NULL, "failed to register string '%s'",
 				o->strbuf);
@@ -115,7 +115,7 @@ uint8_t SAU_Scanner_setws_level(SAU_Scanner *restrict o, uint8_t ws_level);
  */
 enum {
 	SAU_SCAN_S_ERROR = 1<<0, // true if at least one error has been printed
-	SAU_SCAN_S_DISCARD = 1<<1, // don't save scan frame next get
+	SAU_SCAN_S_DISCARD = 1<<1, // reuse last frame saved next get
 	SAU_SCAN_S_QUIET = 1<<2, // suppress warnings (but still print errors)
 };
 
@@ -151,7 +151,8 @@ SAU_Scanner *SAU_create_Scanner(SAU_SymTab *restrict symtab) sauMalloclike;
 void SAU_destroy_Scanner(SAU_Scanner *restrict o);
 
 bool SAU_Scanner_open(SAU_Scanner *restrict o,
-		const char *restrict script, bool is_path);
+		const char *restrict script, bool is_path,
+		const char *restrict name);
 void SAU_Scanner_close(SAU_Scanner *restrict o);
 
 /**
@@ -24,40 +24,76 @@
 # define SAU_SYMTAB_STATS 0
 #endif
 #if SAU_SYMTAB_STATS
+static size_t lookup_count = 0;
+static size_t probe_count = 0;
+static size_t probe_max = 0;
 static size_t collision_count = 0;
 #include <stdio.h>
 #endif
 
+/*
+ * Table slot. The full hash is kept alongside the item, so that
+ * probing past other items rarely needs to look at their keys.
+ */
+typedef struct StrTabSlot {
+	uint32_t hash;
+	SAU_SymStr *item;
+} StrTabSlot;
+
+/*
+ * Open-addressed hash table using linear probing,
+ * kept at most half full.
+ */
 typedef struct StrTab {
-	SAU_SymStr **items;
+	StrTabSlot *slots;
 	size_t count;
 	size_t alloc;
+#if SAU_SYMTAB_STATS
+	size_t lookups;
+#endif
 } StrTab;
 
 static inline void fini_StrTab(StrTab *restrict o) {
-	free(o->items);
+	free(o->slots);
 }
 
 /*
- * Return the hash of the given string \p key of lenght \p len.
+ * Load up to 8 characters into a 64-bit word, first character lowest
+ * and any remaining bytes zero.
+ */
+static inline uint64_t load_word(const uint8_t *restrict s, size_t len) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if (len == 8) {
+		uint64_t w;
+		memcpy(&w, s, 8);
+		return w;
+	}
+#endif
+	uint64_t w = 0;
+	for (size_t i = 0; i < len; ++i)
+		w |= (uint64_t) s[i] << (i * 8);
+	return w;
+}
+
+/*
+ * Return the hash of the given string \p key of length \p len.
+ *
+ * Multiplicative hashing 8 characters at a time (as in FxHash),
+ * with a final avalanche step (from MurmurHash3) so that the low
+ * bits used for the table index depend on all characters. Gives
+ * the same result as SAU_SymHash used on the characters in order.
  *
  * \return hash
  */
-static size_t StrTab_hash_key(StrTab *restrict o,
-		const char *restrict key, size_t len) {
-	size_t i;
-	size_t hash;
-	/*
-	 * Calculate DJB2 hash,
-	 * varied by adding len.
-	 */
-	hash = 5381 + (len * 33);
-	for (i = 0; i < len; ++i) {
-		size_t c = key[i];
-		hash = ((hash << 5) + hash) ^ c;
-	}
-	hash &= (o->alloc - 1);
-	return hash;
+static uint32_t StrTab_hash_key(const void *restrict key, size_t len) {
+	const uint8_t *s = key;
+	uint64_t hash = 0;
+	size_t i = 0;
+	for (; i + 8 <= len; i += 8)
+		hash = SAU_SymHash_mix(hash, load_word(&s[i], 8));
+	if (i < len)
+		hash = SAU_SymHash_mix(hash, load_word(&s[i], len - i));
+	return SAU_SymHash_final(hash, len);
 }
 
 /*
@@ -66,41 +102,31 @@ static size_t StrTab_hash_key(StrTab *restrict o,
  * \return true, or false on allocation failure
  */
 static bool StrTab_upsize(StrTab *restrict o) {
-	SAU_SymStr **items, **old_items = o->items;
+	StrTabSlot *slots, *old_slots = o->slots;
 	size_t alloc, old_alloc = o->alloc;
 	size_t i;
 	alloc = (old_alloc > 0) ?
 		(old_alloc << 1) :
 		STRTAB_ALLOC_INITIAL;
-	items = calloc(alloc, sizeof(SAU_SymStr*));
-	if (!items)
+	slots = calloc(alloc, sizeof(StrTabSlot));
+	if (!slots)
 		return false;
 	o->alloc = alloc;
-	o->items = items;
+	o->slots = slots;
 
 	/*
-	 * Rehash entries
+	 * Reinsert entries, using the stored hashes.
 	 */
 	for (i = 0; i < old_alloc; ++i) {
-		SAU_SymStr *item = old_items[i];
-		while (item != NULL) {
-			SAU_SymStr *prev_item;
-			size_t hash;
-			hash = StrTab_hash_key(o, item->key, item->key_len);
-			/*
-			 * Before adding the entry to the new table, set
-			 * item->prev to the previous (if any) item with
-			 * the same hash in the new table. Done repeatedly,
-			 * the links are rebuilt, though not necessarily in
-			 * the same order.
-			 */
-			prev_item = item->prev;
-			item->prev = o->items[hash];
-			o->items[hash] = item;
-			item = prev_item;
-		}
+		StrTabSlot *old_slot = &old_slots[i];
+		if (!old_slot->item)
+			continue;
+		size_t j = old_slot->hash & (alloc - 1);
+		while (slots[j].item != NULL)
+			j = (j + 1) & (alloc - 1);
+		slots[j] = *old_slot;
 	}
-	free(old_items);
+	free(old_slots);
 	return true;
 }
 
@@ -109,13 +135,16 @@ static bool StrTab_upsize(StrTab *restrict o) {
  * If allocated, \p extra is added to the size of the node; use
  * 1 to add a NULL-byte for a string key.
  *
+ * The \p hash must be that given by StrTab_hash_key() for the key.
+ *
  * Initializes the hash table if empty.
  *
  * \return SAU_SymStr, or NULL on allocation failure
  */
 static SAU_SymStr *StrTab_unique_item(StrTab *restrict o,
 		SAU_MemPool *restrict memp,
-		const void *restrict key, size_t len, size_t extra) {
+		const void *restrict key, size_t len, uint32_t hash,
+		size_t extra) {
 	if (!key || len == 0)
 		return NULL;
 	if (o->count == (o->alloc / 2)) {
@@ -123,23 +152,40 @@ static SAU_SymStr *StrTab_unique_item(StrTab *restrict o,
 			return NULL;
 	}
 
-	size_t hash = StrTab_hash_key(o, key, len);
-	SAU_SymStr *item = o->items[hash];
-	while (item != NULL) {
-		if (item->key_len == len &&
-			!memcmp(item->key, key, len)) return item;
-		item = item->prev;
+	size_t mask = o->alloc - 1;
+	size_t i = hash & mask;
+	StrTabSlot *slot;
+#if SAU_SYMTAB_STATS
+	++o->lookups;
+	size_t probes = 0;
+	++lookup_count;
+#endif
+	for (;;) {
+		slot = &o->slots[i];
+		SAU_SymStr *item = slot->item;
+		if (!item)
+			break;
+		if (slot->hash == hash) {
+			if (item->key_len == len &&
+				!memcmp(item->key, key, len)) return item;
 #if SAU_SYMTAB_STATS
-		++collision_count;
+			++collision_count;
+#endif
+		}
+		i = (i + 1) & mask;
+#if SAU_SYMTAB_STATS
+		++probe_count;
+		if (++probes > probe_max) probe_max = probes;
 #endif
 	}
-	item = SAU_MemPool_alloc(memp, sizeof(SAU_SymStr) + (len + extra));
+	SAU_SymStr *item = SAU_MemPool_alloc(memp,
+			sizeof(SAU_SymStr) + (len + extra));
 	if (!item)
 		return NULL;
-	item->prev = o->items[hash];
-	o->items[hash] = item;
 	item->key_len = len;
 	memcpy(item->key, key, len);
+	slot->hash = hash;
+	slot->item = item;
 	++o->count;
 	return item;
 }
@@ -171,9 +217,28 @@ void SAU_destroy_SymTab(SAU_SymTab *restrict o) {
 	if (!o)
 		return;
 #if SAU_SYMTAB_STATS
-	printf("collision count: %zd\n", collision_count);
+	printf("symtab lookups: %zd\n"
+		"symtab probes past first slot: %zd (mean %.3f, max %zd)\n"
+		"symtab full hash collisions: %zd\n",
+		lookup_count, probe_count,
+		lookup_count ? (double) probe_count / lookup_count : 0.0,
+		probe_max, collision_count);
 #endif
 	fini_StrTab(&o->strtab);
+	free(o);
+}
+
+/**
+ * Get usage counts for the symbol table.
+ */
+void SAU_SymTab_get_stats(const SAU_SymTab *restrict o,
+		SAU_SymTabStats *restrict stats) {
+#if SAU_SYMTAB_STATS
+	stats->lookups = o->strtab.lookups;
+#else
+	stats->lookups = 0;
+#endif
+	stats->strings = o->strtab.count;
 }
 
 /**
@@ -184,7 +249,19 @@ void SAU_destroy_SymTab(SAU_SymTab *restrict o) {
  */
 SAU_SymStr *SAU_SymTab_get_symstr(SAU_SymTab *restrict o,
 		const void *restrict str, size_t len) {
-	return StrTab_unique_item(&o->strtab, o->memp, str, len, 1);
+	return StrTab_unique_item(&o->strtab, o->memp, str, len,
+			StrTab_hash_key(str, len), 1);
+}
+
+/**
+ * Like SAU_SymTab_get_symstr(), but using a \p hash already
+ * computed for \p str using SAU_SymHash, e.g. while reading it.
+ *
+ * \return unique item for \p str, or NULL on allocation failure
+ */
+SAU_SymStr *SAU_SymTab_get_symstr_hashed(SAU_SymTab *restrict o,
+		const void *restrict str, size_t len, uint32_t hash) {
+	return StrTab_unique_item(&o->strtab, o->memp, str, len, hash, 1);
 }
 
 /**
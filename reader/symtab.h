@@ -18,7 +18,6 @@
  * Item stored for each unique string associated with the symbol table.
  */
 typedef struct SAU_SymStr {
-	struct SAU_SymStr *prev;
 	void *data;
 	size_t key_len;
 	char key[];
@@ -30,8 +29,90 @@ typedef struct SAU_SymTab SAU_SymTab;
 SAU_SymTab *SAU_create_SymTab(SAU_MemPool *restrict mempool) sauMalloclike;
 void SAU_destroy_SymTab(SAU_SymTab *restrict o);
 
+/**
+ * Usage counts for a symbol table, totalled since creation.
+ * Lookups which didn't add a string are the hits. Lookups are
+ * only counted if built with SAU_SYMTAB_STATS, otherwise zero.
+ */
+typedef struct SAU_SymTabStats {
+	size_t lookups; // string lookups, including those adding strings
+	size_t strings; // unique strings held
+} SAU_SymTabStats;
+
+void SAU_SymTab_get_stats(const SAU_SymTab *restrict o,
+		SAU_SymTabStats *restrict stats);
+
+/*
+ * Combine the hash with the next 8 characters, held in a 64-bit word
+ * with the first character lowest (as in FxHash).
+ */
+static inline uint64_t SAU_SymHash_mix(uint64_t hash, uint64_t word) {
+	return (((hash << 5) | (hash >> 59)) ^ word)
+		* UINT64_C(0x517CC1B727220A95);
+}
+
+/*
+ * Finish hash for a string of length \p len, with a final avalanche step
+ * (from MurmurHash3) so that the low bits depend on all characters.
+ */
+static inline uint32_t SAU_SymHash_final(uint64_t hash, size_t len) {
+	hash ^= len;
+	hash ^= hash >> 33;
+	hash *= UINT64_C(0xFF51AFD7ED558CCD);
+	hash ^= hash >> 33;
+	hash *= UINT64_C(0xC4CEB9FE1A85EC53);
+	hash ^= hash >> 33;
+	return (uint32_t) hash;
+}
+
+/**
+ * Incremental string hash, for computing the hash used by the symbol
+ * table while a string is read one character at a time. The result
+ * can be passed to SAU_SymTab_get_symstr_hashed(), avoiding a second
+ * pass over the string.
+ */
+typedef struct SAU_SymHash {
+	uint64_t hash;
+	uint64_t word;
+	size_t len;
+} SAU_SymHash;
+
+/**
+ * Initialize incremental hash for an empty string.
+ */
+static inline void SAU_SymHash_init(SAU_SymHash *restrict o) {
+	o->hash = 0;
+	o->word = 0;
+	o->len = 0;
+}
+
+/**
+ * Add the next character \p c to the string hashed.
+ */
+static inline void SAU_SymHash_add(SAU_SymHash *restrict o, uint8_t c) {
+	o->word |= (uint64_t) c << ((o->len & 7) * 8);
+	if ((++o->len & 7) == 0) {
+		o->hash = SAU_SymHash_mix(o->hash, o->word);
+		o->word = 0;
+	}
+}
+
+/**
+ * Get the hash of the string added so far.
+ *
+ * \return hash
+ */
+static inline uint32_t SAU_SymHash_get(const SAU_SymHash *restrict o) {
+	uint64_t hash = o->hash;
+	if ((o->len & 7) != 0)
+		hash = SAU_SymHash_mix(hash, o->word);
+	return SAU_SymHash_final(hash, o->len);
+}
+
 SAU_SymStr *SAU_SymTab_get_symstr(SAU_SymTab *restrict o,
 		const void *restrict str, size_t len);
+SAU_SymStr *SAU_SymTab_get_symstr_hashed(SAU_SymTab *restrict o,
+		const void *restrict str, size_t len, uint32_t hash);
 
 /**
  * Get the unique copy of \p str held in the symbol table,
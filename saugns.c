@@ -14,9 +14,11 @@
 #include "saugns.h"
 #include "help.h"
 #include <errno.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #define NAME SAU_CLINAME_STR
+#define THREADS_MAX 64 /* each renders its own segment buffer */
 
 /*
  * Print help list for \p topic,
@@ -41,9 +43,11 @@ static void print_help(const char *restrict topic,
  */
 static void print_usage(bool h_arg, const char *restrict h_type) {
 	fputs(
-"Usage: "NAME" [-a|-m] [-r <srate>] [-o <wavfile>] [options] <script>...\n"
+"Usage: "NAME" [-a|-m] [-r <srate>] [-s <start>] [-o <wavfile>] [options] <script>...\n"
+"       "NAME" -w|-W [-r <srate>] [-s <start>] [options] <script>...\n"
 "       "NAME" [-c] [options] <script>...\n"
-"Common options: [-e] [-p]\n",
+"Common options: [-e] [-p] [-P] [-j <threads>] [-C <cachedir>]\n"
+"                [-A <name>=<value>]...\n",
 		stderr);
 	if (!h_type)
 		fputs(
@@ -54,11 +58,26 @@ static void print_usage(bool h_arg, const char *restrict h_type) {
 "  -m \tMuted; always disable audio device output.\n"
 "  -r \tSample rate in Hz (default "SAU_STREXP(SAU_DEFAULT_SRATE)");\n"
 "     \tif unsupported for audio device, warns and prints rate used instead.\n"
+"  -s \tStart time in seconds (may be fractional); skips ahead without\n"
+"     \tgenerating audio, output beginning at that point in each script.\n"
 "  -o \tWrite a 16-bit PCM WAV file, always using the sample rate requested;\n"
 "     \tdisables audio device output by default.\n"
 "  -e \tEvaluate strings instead of files.\n"
 "  -c \tCheck scripts only, reporting any errors or requested info.\n"
 "  -p \tPrint info for scripts after loading.\n"
+"  -P \tPipelined build; parse and convert scripts a piece at a time,\n"
+"     \tfreeing data behind, for lower peak memory with large scripts.\n"
+"  -j \tRender audio in time segments using this many threads in parallel;\n"
+"     \tthe result is the same as for a single thread (the default).\n"
+"     \tAt most 64 threads are used.\n"
+"  -C \tCache compiled programs in the given directory, and load them from\n"
+"     \tit instead of parsing scripts whose contents are unchanged.\n"
+"  -w \tWatch script files, keeping the audio device open after playing;\n"
+"     \ta script saved is rebuilt, and played again from the start, its\n"
+"     \tnew program swapped in if playing. Runs until interrupted.\n"
+"  -W \tLike -w, but a program swapped in resumes at the same time.\n"
+"  -A \tSet script argument, declared in a script as $<name>=<default>,\n"
+"     \tto the number given; may be repeated for several arguments.\n"
 "  -h \tPrint this and list help topics, or print help for '-h <topic>'.\n"
 "  -v \tPrint version.\n",
 			stderr);
@@ -92,6 +111,41 @@ static int32_t get_piarg(const char *restrict str) {
 	return i;
 }
 
+/*
+ * Read a non-negative time in seconds, with an optional fraction,
+ * from the given string.
+ *
+ * \return time in milliseconds or -1 if invalid
+ */
+static int32_t get_tmsarg(const char *restrict str) {
+	char *endp;
+	double d;
+	errno = 0;
+	d = strtod(str, &endp);
+	if (errno || !(d >= 0.0) || d > (INT32_MAX / 1000) ||
+			endp == str || *endp)
+		return -1;
+	return lrint(d * 1000.0);
+}
+
+/*
+ * Check script argument setting given as "name=value",
+ * for a non-empty name and a finite number as value.
+ *
+ * \return true if valid
+ */
+static bool check_argdef(const char *restrict str) {
+	const char *eq = strchr(str, '=');
+	if (!eq || eq == str)
+		return false;
+	char *endp;
+	errno = 0;
+	double d = strtod(eq + 1, &endp);
+	if (errno || !isfinite(d) || endp == eq + 1 || *endp)
+		return false;
+	return true;
+}
+
 /*
  * Parse command line arguments.
  *
@@ -102,8 +156,12 @@ static int32_t get_piarg(const char *restrict str) {
 static bool parse_args(int argc, char **restrict argv,
 		uint32_t *restrict flags,
 		SAU_PtrArr *restrict script_args,
+		SAU_PtrArr *restrict arg_defs,
 		const char **restrict wav_path,
-		uint32_t *restrict srate) {
+		const char **restrict cache_dir,
+		uint32_t *restrict srate,
+		uint32_t *restrict start_ms,
+		uint32_t *restrict threads) {
 	struct SAU_opt opt = (struct SAU_opt){0};
 	int c;
 	int32_t i;
@@ -113,8 +171,15 @@ static bool parse_args(int argc, char **restrict argv,
 	*srate = SAU_DEFAULT_SRATE;
 	opt.err = 1;
 REPARSE:
-	while ((c = SAU_getopt(argc, argv, "amr:o:ecphv", &opt)) != -1) {
+	while ((c = SAU_getopt(argc, argv, "amr:s:o:ecpPj:C:wWA:hv", &opt)) != -1) {
 		switch (c) {
+		case 'A':
+			if (!check_argdef(opt.arg)) goto USAGE;
+			SAU_PtrArr_add(arg_defs, (void*) opt.arg);
+			continue;
+		case 'C':
+			*cache_dir = opt.arg;
+			continue;
 		case 'a':
 			if ((*flags & (SAU_ARG_AUDIO_DISABLE |
 					SAU_ARG_MODE_CHECK)) != 0)
@@ -134,6 +199,16 @@ REPARSE:
 			h_arg = true;
 			h_type = opt.arg; /* optional argument for -h */
 			goto USAGE;
+		case 'j':
+			i = get_piarg(opt.arg);
+			if (i < 0) goto USAGE;
+			if (i > THREADS_MAX) {
+				SAU_warning(NULL,
+"limiting threads from %d to %d", i, THREADS_MAX);
+				i = THREADS_MAX;
+			}
+			*threads = i;
+			continue;
 		case 'm':
 			if ((*flags & (SAU_ARG_AUDIO_ENABLE |
 					SAU_ARG_MODE_CHECK)) != 0)
@@ -150,6 +225,9 @@ REPARSE:
 		case 'p':
 			*flags |= SAU_ARG_PRINT_INFO;
 			break;
+		case 'P':
+			*flags |= SAU_ARG_PIPELINE;
+			break;
 		case 'r':
 			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
 				goto USAGE;
@@ -158,9 +236,25 @@ REPARSE:
 			if (i < 0) goto USAGE;
 			*srate = i;
 			continue;
+		case 's':
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			*flags |= SAU_ARG_MODE_FULL;
+			i = get_tmsarg(opt.arg);
+			if (i < 0) goto USAGE;
+			*start_ms = i;
+			continue;
 		case 'v':
 			print_version();
 			goto ABORT;
+		case 'W':
+			*flags |= SAU_ARG_WATCH_RESUME;
+			/* fall-through */
+		case 'w':
+			if ((*flags & SAU_ARG_MODE_CHECK) != 0)
+				goto USAGE;
+			*flags |= SAU_ARG_MODE_FULL | SAU_ARG_WATCH;
+			break;
 		default:
 			fputs("Pass -h for general usage help.\n", stderr);
 			goto ABORT;
@@ -178,11 +272,15 @@ REPARSE:
 		++opt.ind;
 		c = 0; /* only goto REPARSE after advancing, to prevent hang */
 	}
+	if ((*flags & SAU_ARG_WATCH) != 0 && ((*flags & (SAU_ARG_EVAL_STRING |
+				SAU_ARG_AUDIO_DISABLE)) != 0 || *wav_path != NULL))
+		goto USAGE;
 	return true;
 USAGE:
 	print_usage(h_arg, h_type);
 ABORT:
 	SAU_PtrArr_clear(script_args);
+	SAU_PtrArr_clear(arg_defs);
 	return false;
 }
 
@@ -191,22 +289,41 @@ ABORT:
  */
 int main(int argc, char **restrict argv) {
 	SAU_PtrArr script_args = (SAU_PtrArr){0};
+	SAU_PtrArr arg_defs = (SAU_PtrArr){0};
 	SAU_PtrArr prg_objs = (SAU_PtrArr){0};
 	const char *wav_path = NULL;
+	const char *cache_dir = NULL;
 	uint32_t options = 0;
 	uint32_t srate = 0;
-	if (!parse_args(argc, argv, &options, &script_args, &wav_path,
-			&srate))
+	uint32_t start_ms = 0;
+	uint32_t threads = 1;
+	if (!parse_args(argc, argv, &options, &script_args, &arg_defs,
+			&wav_path, &cache_dir, &srate, &start_ms, &threads))
 		return 0;
-	bool error = !SAU_build(&script_args, options, &prg_objs);
+	bool error = !SAU_build(&script_args, options, cache_dir, &prg_objs);
+	if ((options & SAU_ARG_WATCH) != 0) {
+		/*
+		 * Keep watching even if no script built, to play fixes.
+		 */
+		error = !SAU_play_watched(&prg_objs, &script_args, cache_dir,
+				srate, options, start_ms, &arg_defs);
+		SAU_PtrArr_clear(&script_args);
+		SAU_PtrArr_clear(&arg_defs);
+		SAU_discard(&prg_objs);
+		return error;
+	}
 	SAU_PtrArr_clear(&script_args);
-	if (error)
+	if (error) {
+		SAU_PtrArr_clear(&arg_defs);
 		return 1;
+	}
 	if (prg_objs.count > 0) {
-		error = !SAU_play(&prg_objs, srate, options, wav_path);
+		error = !SAU_play(&prg_objs, srate, options, start_ms, threads,
+				wav_path, &arg_defs);
 		SAU_discard(&prg_objs);
-		if (error)
-			return 1;
 	}
+	SAU_PtrArr_clear(&arg_defs);
+	if (error)
+		return 1;
 	return 0;
 }
@@ -30,11 +30,22 @@ enum {
 	SAU_ARG_MODE_CHECK    = 1<<3,
 	SAU_ARG_PRINT_INFO    = 1<<4,
 	SAU_ARG_EVAL_STRING   = 1<<5,
+	SAU_ARG_PIPELINE      = 1<<6,
+	SAU_ARG_WATCH         = 1<<7,
+	SAU_ARG_WATCH_RESUME  = 1<<8,
 };
 
 size_t SAU_build(const SAU_PtrArr *restrict script_args, uint32_t options,
+		const char *restrict cache_dir,
 		SAU_PtrArr *restrict prg_objs);
 void SAU_discard(SAU_PtrArr *restrict prg_objs);
 
 bool SAU_play(const SAU_PtrArr *restrict prg_objs, uint32_t srate,
-		uint32_t options, const char *restrict wav_path);
+		uint32_t options, uint32_t start_ms, uint32_t threads,
+		const char *restrict wav_path,
+		const SAU_PtrArr *restrict arg_defs);
+bool SAU_play_watched(SAU_PtrArr *restrict prg_objs,
+		const SAU_PtrArr *restrict script_args,
+		const char *restrict cache_dir,
+		uint32_t srate, uint32_t options, uint32_t start_ms,
+		const SAU_PtrArr *restrict arg_defs);
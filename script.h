@@ -12,7 +12,6 @@
  */
 
 #pragma once
-#include "reflist.h"
 #include "program.h"
 
 /**
@@ -27,8 +26,26 @@ typedef struct SAU_NodeRange {
  */
 enum {
 	SAU_SDOP_ADD_CARRIER = 1<<0,
+	SAU_SDOP_LATER_USED = 1<<1,
+	SAU_SDOP_USE_PENDING = 1<<2, // later use not yet known when piped
 };
 
+struct SAU_ScriptOpData;
+
+/**
+ * Compact list of operator data references, for the carriers of
+ * an event or the modulators of one type for an operator. Items
+ * are held in an array after the list header, in one allocation.
+ *
+ * The \a next field links the lists of further types for a node.
+ */
+typedef struct SAU_ScriptOpList {
+	struct SAU_ScriptOpList *next;
+	uint32_t count;
+	uint8_t use_type;
+	struct SAU_ScriptOpData *ops[];
+} SAU_ScriptOpList;
+
 /**
  * Node type for operator data.
  */
@@ -49,8 +66,9 @@ typedef struct SAU_ScriptOpData {
 	SAU_Ramp amp, amp2;
 	SAU_Ramp pan;
 	float phase;
+	const SAU_ProgramArgList *args; /* NULL unless arguments used */
 	/* new node adjacents in operator linkage graph */
-	SAU_RefList *mod_lists;
+	SAU_ScriptOpList *mod_lists;
 } SAU_ScriptOpData;
 
 /**
@@ -61,19 +79,31 @@ enum {
 	SAU_SDEV_LATER_USED = 1<<1,
 };
 
+/**
+ * Repetition of a sequence of events, played \a count times in all,
+ * each time \a period_ms after the first event of the previous.
+ * Set for each of the events. The period is final once an event
+ * after the sequence is given, or the events end.
+ */
+typedef struct SAU_ScriptLoop {
+	uint32_t count;
+	uint32_t period_ms;
+} SAU_ScriptLoop;
+
 /**
  * Node type for event data. Includes any voice and operator data part
  * of the event.
  */
 typedef struct SAU_ScriptEvData {
 	struct SAU_ScriptEvData *next;
+	const SAU_ScriptLoop *loop; /* NULL unless repeated */
 	uint32_t wait_ms;
 	uint32_t ev_flags;
 	SAU_NodeRange op_all;
 	/* for scriptconv */
 	uint32_t vo_id;
 	struct SAU_ScriptEvData *root_ev;
-	SAU_RefList *carriers;
+	SAU_ScriptOpList *carriers;
 } SAU_ScriptEvData;
 
 /**
@@ -115,9 +145,24 @@ typedef struct SAU_Script {
 	SAU_ScriptEvData *events;
 	const char *name; // currently simply set to the filename
 	SAU_ScriptOptions sopt;
+	const SAU_ProgramArg *args; // script arguments declared
+	uint32_t arg_count;
 	struct SAU_MemPool *mem; // internally used, provided until destroy
 } SAU_Script;
 
-SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path)
-	sauMalloclike;
+/**
+ * Function called with each event when script data is pipelined,
+ * with the script options as set so far.
+ *
+ * \return true, or false on error, stopping further calls
+ */
+typedef bool (*SAU_ScriptEv_f)(void *restrict data,
+		SAU_ScriptEvData *restrict e,
+		const SAU_ScriptOptions *restrict sopt);
+
+SAU_Script *SAU_load_Script(const char *restrict script_arg, bool is_path,
+		const char *restrict name) sauMalloclike;
+SAU_Script *SAU_pipe_Script(const char *restrict script_arg, bool is_path,
+		const char *restrict name,
+		SAU_ScriptEv_f ev_f, void *restrict ev_data) sauMalloclike;
 void SAU_discard_Script(SAU_Script *restrict o);
@@ -11,28 +11,78 @@
  * <https://www.gnu.org/licenses/>.
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include "saugns.h"
-#if SAU_TEST_SCANNER
-# include "reader/scanner.h"
-#else
-# include "reader/lexer.h"
-#endif
+#include "reader/scanner.h"
+#include "reader/lexer.h"
 #include "reader/file.h"
+#include "script.h"
+#include "arrtype.h"
 #include <errno.h>
+#include <float.h>
+#include <inttypes.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #define NAME "test-scan"
 
+/*
+ * Input types for benchmark runs.
+ */
+enum {
+	INPUT_FILE = 0,
+	INPUT_MEM,
+	INPUT_MMAP,
+};
+
+static const char *const input_names[] = {
+	"file",
+	"mem",
+	"mmap",
+	NULL
+};
+
+/*
+ * Benchmark settings, for reader throughput testing.
+ */
+typedef struct BenchOpt {
+	uint32_t runs; // 0 unless benchmarking
+	uint8_t input;
+	bool scanner; // run scanner directly instead of lexer
+	bool numbers; // read generated numbers instead of scripts
+	uint32_t composites; // events for generated composites check
+} BenchOpt;
+
 /*
  * Print command line usage instructions.
  */
 static void print_usage(void) {
 	fputs(
 "Usage: "NAME" [-c] [-p] [-e] <script>...\n"
+"       "NAME" -t <runs> [-s] [-i file|mem|mmap] [-e] <script>...\n"
+"       "NAME" -n [-t <runs>]\n"
+"       "NAME" -g <events>\n"
 "\n"
 "  -e \tEvaluate strings instead of files.\n"
 "  -c \tCheck scripts only, reporting any errors or requested info.\n"
 "  -p \tPrint info for scripts after loading.\n"
+"  -t \tBenchmark reading each script this many times, printing\n"
+"     \tthroughput, symbol table and memory pool use for a run.\n"
+"  -s \tBenchmark the scanner alone, getting characters, instead of\n"
+"     \tgetting tokens with the lexer.\n"
+"  -i \tBenchmark input; read files through stdio (the default), from\n"
+"     \ta copy in memory, or from a memory-mapped file.\n"
+"  -n \tCheck reading of generated numbers against strtod(), covering\n"
+"     \tedge cases in rounding, length and magnitude. With -t, instead\n"
+"     \tbenchmark reading typical numbers, compared to strtod().\n"
+"  -g \tGenerate a script with this many events, half with composite\n"
+"     \tevents, and check the order and times of events once parsed.\n"
 "  -h \tPrint this message.\n"
 "  -v \tPrint version.\n",
 		stderr);
@@ -45,6 +95,21 @@ static void print_version(void) {
 	puts(NAME" ("SAU_CLINAME_STR") "SAU_VERSION_STR);
 }
 
+/*
+ * Read a positive integer from the given string.
+ *
+ * \return positive value or -1 if invalid
+ */
+static int32_t get_piarg(const char *restrict str) {
+	char *endp;
+	int32_t i;
+	errno = 0;
+	i = strtol(str, &endp, 10);
+	if (errno || i <= 0 || endp == str || *endp)
+		return -1;
+	return i;
+}
+
 /*
  * Parse command line arguments.
  *
@@ -54,23 +119,14 @@ static void print_version(void) {
  */
 static bool parse_args(int argc, char **restrict argv,
 		uint32_t *restrict flags,
-		SAU_PtrArr *restrict script_args) {
-	for (;;) {
-		const char *arg;
-		--argc;
-		++argv;
-		if (argc < 1) {
-			if (!script_args->count) goto USAGE;
-			break;
-		}
-		arg = *argv;
-		if (*arg != '-') {
-			SAU_PtrArr_add(script_args, (void*) arg);
-			continue;
-		}
-NEXT_C:
-		if (!*++arg) continue;
-		switch (*arg) {
+		SAU_PtrArr *restrict script_args,
+		BenchOpt *restrict bench) {
+	struct SAU_opt opt = (struct SAU_opt){0};
+	int c;
+	int32_t i;
+	opt.err = 1;
+	while ((c = SAU_getopt(argc, argv, "ceg:i:nst:hv", &opt)) != -1) {
+		switch (c) {
 		case 'c':
 			if ((*flags & SAU_ARG_MODE_FULL) != 0)
 				goto USAGE;
@@ -79,19 +135,61 @@ NEXT_C:
 		case 'e':
 			*flags |= SAU_ARG_EVAL_STRING;
 			break;
+		case 'g':
+			i = get_piarg(opt.arg);
+			if (i < 0) goto USAGE;
+			bench->composites = i;
+			continue;
 		case 'h':
 			goto USAGE;
+		case 'i':
+			for (i = 0; input_names[i] != NULL; ++i)
+				if (!strcmp(opt.arg, input_names[i])) break;
+			if (!input_names[i]) goto USAGE;
+			bench->input = i;
+			continue;
+		case 'n':
+			bench->numbers = true;
+			break;
 		case 'p':
 			*flags |= SAU_ARG_PRINT_INFO;
 			break;
+		case 's':
+			bench->scanner = true;
+			break;
+		case 't':
+			i = get_piarg(opt.arg);
+			if (i < 0) goto USAGE;
+			bench->runs = i;
+			continue;
 		case 'v':
 			print_version();
 			goto ABORT;
 		default:
-			goto USAGE;
+			fputs("Pass -h for usage help.\n", stderr);
+			goto ABORT;
 		}
-		goto NEXT_C;
 	}
+	if (bench->composites > 0) {
+		if (bench->numbers || bench->runs || bench->scanner ||
+				bench->input != INPUT_FILE ||
+				*flags != 0 || opt.ind < argc)
+			goto USAGE;
+		return true;
+	}
+	if (bench->numbers) {
+		if (bench->scanner || bench->input != INPUT_FILE ||
+				*flags != 0 || opt.ind < argc)
+			goto USAGE;
+		return true;
+	}
+	if ((bench->scanner || bench->input != INPUT_FILE) && !bench->runs)
+		goto USAGE;
+	if (bench->input != INPUT_FILE && (*flags & SAU_ARG_EVAL_STRING))
+		goto USAGE;
+	for (; opt.ind < argc; ++opt.ind)
+		SAU_PtrArr_add(script_args, argv[opt.ind]);
+	if (!script_args->count) goto USAGE;
 	return true;
 USAGE:
 	print_usage();
@@ -100,6 +198,692 @@ ABORT:
 	return false;
 }
 
+/*
+ * Read file into NUL-terminated string.
+ *
+ * \return allocated string or NULL on error
+ */
+static char *read_file(const char *restrict path, size_t *restrict len) {
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return NULL;
+	char *text = NULL;
+	size_t count = 0, alloc = 0;
+	for (;;) {
+		if (count + BUFSIZ + 1 > alloc) {
+			alloc = (alloc > 0) ? alloc * 2 : BUFSIZ + 1;
+			char *new_text = realloc(text, alloc);
+			if (!new_text) goto ERROR;
+			text = new_text;
+		}
+		size_t read_len = fread(text + count, 1, BUFSIZ, f);
+		count += read_len;
+		if (read_len < BUFSIZ) {
+			if (ferror(f)) goto ERROR;
+			break;
+		}
+	}
+	fclose(f);
+	text[count] = '\0';
+	*len = count;
+	return text;
+ERROR:
+	fclose(f);
+	free(text);
+	return NULL;
+}
+
+/*
+ * Map file into memory as a NUL-terminated string. The mapping
+ * is placed over zeroed pages one byte longer than the file,
+ * the zero byte after the file contents ending the string.
+ *
+ * \return mapped string or NULL on error
+ */
+static char *map_file(const char *restrict path, size_t *restrict len,
+		size_t *restrict map_len) {
+	char *text = MAP_FAILED;
+	int fd = open(path, O_RDONLY), zero_fd = -1;
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) < 0)
+		goto DONE;
+	zero_fd = open("/dev/zero", O_RDONLY);
+	if (zero_fd < 0)
+		goto DONE;
+	long page_len = sysconf(_SC_PAGESIZE);
+	if (page_len <= 0) page_len = 4096;
+	*len = st.st_size;
+	*map_len = (*len / page_len + 1) * page_len;
+	text = mmap(NULL, *map_len, PROT_READ, MAP_PRIVATE, zero_fd, 0);
+	if (text == MAP_FAILED || *len == 0)
+		goto DONE;
+	if (mmap(text, *len, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+				fd, 0) == MAP_FAILED) {
+		munmap(text, *map_len);
+		text = MAP_FAILED;
+	}
+DONE:
+	if (fd >= 0) close(fd);
+	if (zero_fd >= 0) close(zero_fd);
+	return (text != MAP_FAILED) ? text : NULL;
+}
+
+/*
+ * \return seconds elapsed for processor since \p start
+ */
+static double elapsed(clock_t start) {
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/*
+ * Read script once for benchmark, counting characters (for the scanner)
+ * or tokens (for the lexer), and getting the symbol table and memory
+ * pool use for the run.
+ *
+ * \return true unless error occurred
+ */
+static bool bench_run(const char *restrict script, bool is_path,
+		const BenchOpt *restrict opt, size_t *restrict count,
+		SAU_SymTabStats *restrict sym_stats,
+		SAU_MemPoolStats *restrict mem_stats) {
+	SAU_MemPool *mempool = SAU_create_MemPool(0);
+	SAU_SymTab *symtab = SAU_create_SymTab(mempool);
+	SAU_Scanner *scanner = NULL;
+	SAU_Lexer *lexer = NULL;
+	SAU_SymTabStats sym_start;
+	bool ok = false;
+	if (!symtab) goto DONE;
+	*count = 0;
+	if (opt->scanner) {
+		if (!(scanner = SAU_create_Scanner(symtab))) goto DONE;
+		SAU_SymTab_get_stats(symtab, &sym_start);
+		if (!SAU_Scanner_open(scanner, script, is_path, NULL)) goto DONE;
+		while (SAU_Scanner_getc(scanner) != 0) ++*count;
+	} else {
+		SAU_ScriptToken token;
+		if (!(lexer = SAU_create_Lexer(symtab))) goto DONE;
+		SAU_SymTab_get_stats(symtab, &sym_start);
+		if (!SAU_Lexer_open(lexer, script, is_path)) goto DONE;
+		while (SAU_Lexer_get(lexer, &token)) ++*count;
+	}
+	/*
+	 * Leave out the symbols added upon creation, e.g. keywords.
+	 */
+	SAU_SymTab_get_stats(symtab, sym_stats);
+	sym_stats->lookups -= sym_start.lookups;
+	sym_stats->strings -= sym_start.strings;
+	SAU_MemPool_get_stats(mempool, mem_stats);
+	ok = true;
+DONE:
+	SAU_destroy_Scanner(scanner);
+	SAU_destroy_Lexer(lexer);
+	SAU_destroy_SymTab(symtab);
+	SAU_destroy_MemPool(mempool);
+	return ok;
+}
+
+/*
+ * Benchmark reading script the number of times set, printing
+ * the throughput, and symbol table and memory pool use per run.
+ *
+ * \return true unless error occurred
+ */
+static bool bench_script(const char *restrict script_arg, bool is_path,
+		const BenchOpt *restrict opt) {
+	const char *script = script_arg;
+	char *text = NULL;
+	size_t len = 0, map_len = 0;
+	bool ok = false;
+	if (!is_path) {
+		len = strlen(script_arg);
+	} else if (opt->input == INPUT_FILE) {
+		struct stat st;
+		if (stat(script_arg, &st) == 0) len = st.st_size;
+	} else {
+		text = (opt->input == INPUT_MMAP) ?
+			map_file(script_arg, &len, &map_len) :
+			read_file(script_arg, &len);
+		if (!text) {
+			SAU_error(NULL, "couldn't read script file \"%s\"",
+					script_arg);
+			return false;
+		}
+		script = text;
+		is_path = false;
+	}
+	size_t count = 0;
+	SAU_SymTabStats sym_stats;
+	SAU_MemPoolStats mem_stats;
+	clock_t start = clock();
+	for (uint32_t i = 0; i < opt->runs; ++i) {
+		if (!bench_run(script, is_path, opt, &count,
+					&sym_stats, &mem_stats))
+			goto DONE;
+	}
+	double run_s = elapsed(start) / opt->runs;
+	printf("%s: %s, %s input, %u runs\n"
+		"  %.3f ms/run, %.1f MB/s, %.2f M%s/s (%zu %s)\n",
+		(is_path || text != NULL) ? script_arg : "<string>",
+		opt->scanner ? "scanner" : "lexer",
+		(is_path || text != NULL) ? input_names[opt->input] : "string",
+		opt->runs,
+		run_s * 1000.0,
+		(run_s > 0.0) ? len / run_s * 1e-6 : 0.0,
+		(run_s > 0.0) ? count / run_s * 1e-6 : 0.0,
+		opt->scanner ? "chars" : "tokens",
+		count,
+		opt->scanner ? "chars" : "tokens");
+	/*
+	 * Lookup and allocation counts are zero unless compiled in.
+	 */
+	fputs("  symtab: ", stdout);
+	if (sym_stats.lookups > 0) {
+		size_t hits = sym_stats.lookups - sym_stats.strings;
+		printf("%zu lookups, %.1f%% hits, ",
+			sym_stats.lookups, 100.0 * hits / sym_stats.lookups);
+	}
+	printf("%zu strings added\n", sym_stats.strings);
+	fputs("  mempool: ", stdout);
+	if (mem_stats.allocs > 0)
+		printf("%zu allocations, %zu bytes, ",
+			mem_stats.allocs, mem_stats.bytes);
+	printf("%zu blocks\n", mem_stats.blocks);
+	ok = true;
+DONE:
+	if (opt->input == INPUT_MMAP) {
+		if (text) munmap(text, map_len);
+	} else {
+		free(text);
+	}
+	return ok;
+}
+
+/*
+ * Get next pseudo-random value for generated input, from \p state.
+ */
+static uint32_t rand_next(uint64_t *restrict state) {
+	*state = *state * UINT64_C(6364136223846793005) +
+		UINT64_C(1442695040888963407);
+	return *state >> 33;
+}
+
+/*
+ * Append \p len characters from \p str to \p text.
+ *
+ * \return true unless allocation failed
+ */
+static bool add_text(SAU_ByteArr *restrict text,
+		const char *restrict str, size_t len) {
+	if (!SAU_ByteArr_upsize(text, text->count + len))
+		return false;
+	memcpy(&text->a[text->count], str, len);
+	text->count += len;
+	return true;
+}
+
+/*
+ * Append \p count copies of \p c to \p text, or random digits
+ * if \p c is NUL.
+ *
+ * \return true unless allocation failed
+ */
+static bool add_digits(SAU_ByteArr *restrict text, uint64_t *restrict state,
+		size_t count, char c) {
+	if (!SAU_ByteArr_upsize(text, text->count + count))
+		return false;
+	for (size_t i = 0; i < count; ++i)
+		text->a[text->count++] = c ? c : (char) ('0' + rand_next(state) % 10);
+	return true;
+}
+
+/*
+ * Fixed cases for number reading checks. A '#' is replaced by
+ * as many zeros as the count in the string after it, allowing
+ * long numbers and large or small magnitudes to be written
+ * compactly; the count ends with ':' where digits follow.
+ */
+static const char *const number_cases[] = {
+	"0", "00", "0.0", ".0", "0.", ".5", "5.", "-0", "+1", "-.25",
+	"1", "9", "10", "0.1", "0.2", "0.3", "0.30000000000000004",
+	"123456789012345678", "1234567890123456789",
+	"12345678901234567890", "18446744073709551615",
+	"18446744073709551616", "99999999999999999999",
+	"9007199254740992", "9007199254740993", "9007199254740994",
+	"9007199254740995", "9007199254740993.0000000000000000001",
+	"4503599627370496.5", "4503599627370497.5",
+	"4503599627370496.5#800:1", "4503599627370497.5#800:1",
+	"4503599627370496.5#900", "4503599627370496.4#900:9",
+	"3.141592653589793238462643383279502884197",
+	"2.718281828459045235360287471352662497757",
+	"0.000000000000000000000000000001",
+	"1#22", "1#23", "9007199254740991#7", "9007199254740993#7",
+	"1#308", "1#309", "17976931348623157#292", "17976931348623158#292",
+	"179769313486231580793728971405301#276",
+	"0.#307:22250738585072014", "0.#307:22250738585072011",
+	"0.#307:2225073858507201136057409796709131975934819546351645648",
+	"0.#323:494065645841246544", "0.#323:247032822920623272",
+	"0.#323:2470328229206232720882538", "0.#323:24703282292062327209",
+	"0.#323:2470328229206232720#1000:1", "0.#400:1", "#900:1.5",
+	"0.#900:123", "1.#1000",
+	NULL
+};
+
+/*
+ * Values for which to check reading the number halfway to the next
+ * larger double, with the result rounding to even, up, and down.
+ * Further cases are random.
+ */
+static const double halfway_cases[] = {
+	0.0, 1.0, 0.1, 123.456, 4503599627370495.0,
+	DBL_MIN, DBL_MIN - 0x1p-1074, 0x1p-1074, 0x3p-1074,
+};
+#define NUM_HALFWAY_CASES \
+	(sizeof(halfway_cases) / sizeof(*halfway_cases))
+
+/*
+ * Append fixed case \p str from number_cases to \p text.
+ *
+ * \return true unless allocation failed
+ */
+static bool add_number_case(SAU_ByteArr *restrict text,
+		const char *restrict str) {
+	while (*str != '\0') {
+		size_t len = strcspn(str, "#");
+		if (!add_text(text, str, len))
+			return false;
+		str += len;
+		if (*str == '#') {
+			char *end;
+			size_t zeros = strtoul(str + 1, &end, 10);
+			if (!add_digits(text, NULL, zeros, '0'))
+				return false;
+			str = (*end == ':') ? end + 1 : end;
+		}
+	}
+	return true;
+}
+
+/*
+ * Append to \p text the exact decimal value halfway between \p x
+ * (positive, below 2^52) and the next larger double, the hardest
+ * case for rounding. If \p offset is positive, a 1 is appended
+ * far after the last digit, so that the result is to round up;
+ * if negative, the value is made slightly smaller to round down.
+ *
+ * \return true unless allocation failed
+ */
+static bool add_halfway(SAU_ByteArr *restrict text, double x, int offset) {
+	uint8_t digits[1200]; // least significant first
+	size_t len = 0, point;
+	int exp;
+	uint64_t mant = ldexp(frexp(x, &exp), DBL_MANT_DIG);
+	exp -= DBL_MANT_DIG;
+	if (!mant) {
+		exp = DBL_MIN_EXP - DBL_MANT_DIG;
+	} else if (exp < DBL_MIN_EXP - DBL_MANT_DIG) {
+		/* subnormal, ulp smallest possible */
+		mant >>= (DBL_MIN_EXP - DBL_MANT_DIG) - exp;
+		exp = DBL_MIN_EXP - DBL_MANT_DIG;
+	}
+	/* (2 * mant + 1) * 2^(exp - 1) = (2 * mant + 1) * 5^-(exp - 1)
+	   / 10^-(exp - 1) */
+	mant = 2 * mant + 1;
+	point = 1 - exp;
+	do digits[len++] = mant % 10; while ((mant /= 10) > 0);
+	for (size_t i = 0; i < point; ++i) {
+		uint32_t carry = 0;
+		for (size_t j = 0; j < len; ++j) {
+			uint32_t d = digits[j] * 5 + carry;
+			digits[j] = d % 10;
+			carry = d / 10;
+		}
+		if (carry > 0) digits[len++] = carry;
+	}
+	if (offset < 0) digits[0] = 4; // was 5, followed by 9s below
+	if (point >= len && (!add_text(text, "0.", 2) ||
+				!add_digits(text, NULL, point - len, '0')))
+		return false;
+	if (!SAU_ByteArr_upsize(text, text->count + len + 1))
+		return false;
+	for (size_t i = len; i-- > 0; ) {
+		if (i == point - 1 && point < len)
+			text->a[text->count++] = '.';
+		text->a[text->count++] = '0' + digits[i];
+	}
+	if (offset > 0)
+		return add_digits(text, NULL, 900, '0') &&
+			add_text(text, "1", 1);
+	if (offset < 0)
+		return add_digits(text, NULL, 20, '9');
+	return true;
+}
+
+/*
+ * Append a random number to \p text, with up to 20 digits before
+ * and after the point, or now and then many more or leading zeros.
+ *
+ * \return true unless allocation failed
+ */
+static bool add_random_number(SAU_ByteArr *restrict text,
+		uint64_t *restrict state) {
+	uint32_t r = rand_next(state);
+	size_t int_len = r % 21, frac_len = (r >> 5) % 21;
+	size_t zeros = 0;
+	bool point = (r >> 10) & 1;
+	if (((r >> 11) & 7) == 0) {
+		char sign = ((r >> 14) & 1) ? '-' : '+';
+		if (!add_text(text, &sign, 1)) return false;
+	}
+	if (((r >> 15) & 15) == 0)
+		zeros = rand_next(state) % 40;
+	if (((r >> 19) & 255) == 0) {
+		if ((r >> 27) & 1)
+			int_len = rand_next(state) % 1000;
+		else
+			frac_len = rand_next(state) % 1000;
+	}
+	if (!point) frac_len = zeros = 0;
+	if (!int_len && !frac_len) int_len = 1;
+	if (!add_digits(text, state, int_len, '\0'))
+		return false;
+	if (point) {
+		if (!add_text(text, ".", 1) ||
+				!add_digits(text, state, zeros, '0') ||
+				!add_digits(text, state, frac_len, '\0'))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Check number \p i read by SAU_File_getd() from \p f against
+ * strtod() for the same text at \p *str, advancing it past the
+ * number. Mismatches are printed, and \p synced cleared if the
+ * lengths read differ.
+ *
+ * \return true if result and length match
+ */
+static bool check_number(SAU_File *restrict f, const char **restrict str,
+		size_t i, bool *restrict synced) {
+	char *end;
+	double ref = strtod(*str, &end), val = 0.0;
+	size_t ref_len = end - *str, len;
+	bool ok = SAU_File_getd(f, &val, true, &len);
+	bool match = (len == ref_len) && !memcmp(&val, &ref, sizeof(double))
+		&& (ok == !isinf(ref));
+	if (len != ref_len)
+		*synced = false;
+	if (!match) {
+		printf("  mismatch for number %zu \"%.40s%s\" (%zu chars):\n"
+			"    SAU_File_getd() %a (%zu chars%s),"
+			" strtod() %a (%zu chars)\n",
+			i, *str, (ref_len > 40) ? "..." : "", ref_len,
+			val, len, ok ? "" : ", truncated",
+			ref, ref_len);
+	}
+	*str = end;
+	return match;
+}
+
+/*
+ * Check SAU_File_getd() against strtod() for the fixed and
+ * a number of random cases, read from one string so as to
+ * also cross buffer area boundaries at varying positions.
+ *
+ * \return true if all results match
+ */
+static bool check_numbers(void) {
+	const size_t random_count = 200000, halfway_count = 1000;
+	SAU_ByteArr text = (SAU_ByteArr){0};
+	SAU_File *f = NULL;
+	uint64_t state = 1;
+	size_t count = 0, fails = 0;
+	bool ok = false;
+	for (size_t i = 0; number_cases[i] != NULL; ++i, ++count) {
+		if (!add_number_case(&text, number_cases[i]) ||
+				!add_text(&text, "\n", 1))
+			goto DONE;
+	}
+	for (size_t i = 0; i < halfway_count; ++i) {
+		double x = (i < NUM_HALFWAY_CASES) ? halfway_cases[i] :
+			ldexp(rand_next(&state), -(int) (rand_next(&state)
+						% (-DBL_MIN_EXP + 40)));
+		for (int offset = -1; offset <= 1; ++offset, ++count) {
+			if (!add_halfway(&text, x, offset) ||
+					!add_text(&text, "\n", 1))
+				goto DONE;
+		}
+	}
+	for (size_t i = 0; i < random_count; ++i, ++count) {
+		if (!add_random_number(&text, &state) ||
+				!add_text(&text, (i % 8 == 7) ? "\n" : " ", 2))
+			goto DONE;
+		--text.count; // keep NUL after, overwritten by next
+	}
+	if (!(f = SAU_create_File()) ||
+			!SAU_File_stropenrb(f, "<numbers>", (char*) text.a))
+		goto DONE;
+	const char *str = (const char*) text.a;
+	bool synced = true;
+	for (size_t i = 0; i < count; ++i) {
+		if (!check_number(f, &str, i, &synced) &&
+				(++fails == 10 || !synced))
+			break; // stop, or positions no longer match
+		SAU_File_GETC(f);
+		++str;
+	}
+	printf("numbers: %zu checked, %zu mismatched\n", count, fails);
+	ok = !fails;
+DONE:
+	if (!ok && !fails)
+		SAU_error(NULL, "memory allocation failure");
+	SAU_destroy_File(f);
+	SAU_ByteArr_clear(&text);
+	return ok;
+}
+
+/*
+ * Benchmark reading generated numbers of kinds typical for scripts
+ * with SAU_File_getd(), and with strtod() for comparison, printing
+ * the throughput.
+ *
+ * \return true unless error occurred
+ */
+static bool bench_numbers(uint32_t runs) {
+	const size_t count = 1000000;
+	SAU_ByteArr text = (SAU_ByteArr){0};
+	SAU_File *f = NULL;
+	uint64_t state = 1;
+	bool ok = false;
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t r = rand_next(&state) % 20;
+		size_t int_len = 1 + rand_next(&state) % 4, frac_len = 0;
+		if (r >= 8) frac_len = 1 + rand_next(&state) % 3;
+		if (r >= 16) frac_len = 6 + rand_next(&state) % 12;
+		if (!add_digits(&text, &state, int_len, '\0') ||
+				(frac_len > 0 && (!add_text(&text, ".", 1) ||
+				 !add_digits(&text, &state, frac_len, '\0'))) ||
+				!add_text(&text, " ", 2))
+			goto DONE;
+		--text.count; // keep NUL after, overwritten by next
+	}
+	if (!(f = SAU_create_File()))
+		goto DONE;
+	volatile double sum = 0.0;
+	clock_t start = clock();
+	for (uint32_t i = 0; i < runs; ++i) {
+		SAU_File_stropenrb(f, "<numbers>", (char*) text.a);
+		for (size_t j = 0; j < count; ++j) {
+			double val;
+			SAU_File_getd(f, &val, false, NULL);
+			SAU_File_GETC(f);
+			sum += val;
+		}
+	}
+	double getd_s = elapsed(start) / runs;
+	start = clock();
+	for (uint32_t i = 0; i < runs; ++i) {
+		char *str = (char*) text.a;
+		for (size_t j = 0; j < count; ++j) {
+			sum += strtod(str, &str);
+			++str;
+		}
+	}
+	double strtod_s = elapsed(start) / runs;
+	printf("numbers: %zu (%zu bytes), %u runs\n",
+		count, text.count, runs);
+	printf("  SAU_File_getd(): %.3f ms/run, %.1f MB/s, %.2f M/s\n",
+		getd_s * 1000.0,
+		(getd_s > 0.0) ? text.count / getd_s * 1e-6 : 0.0,
+		(getd_s > 0.0) ? count / getd_s * 1e-6 : 0.0);
+	printf("  strtod():        %.3f ms/run, %.1f MB/s, %.2f M/s\n",
+		strtod_s * 1000.0,
+		(strtod_s > 0.0) ? text.count / strtod_s * 1e-6 : 0.0,
+		(strtod_s > 0.0) ? count / strtod_s * 1e-6 : 0.0);
+	ok = true;
+DONE:
+	if (!ok)
+		SAU_error(NULL, "memory allocation failure");
+	SAU_destroy_File(f);
+	SAU_ByteArr_clear(&text);
+	return ok;
+}
+
+/*
+ * Event expected in generated script, placed by time, then with
+ * composites before ordinary events, those of a later event first.
+ */
+typedef struct GenEvent {
+	uint64_t time_ms;
+	uint32_t id;
+	uint32_t parent;
+	uint32_t step; // 0 for ordinary event
+} GenEvent;
+
+static int GenEvent_cmp(const void *restrict _a, const void *restrict _b) {
+	const GenEvent *a = _a, *b = _b;
+	if (a->time_ms != b->time_ms)
+		return (a->time_ms < b->time_ms) ? -1 : 1;
+	if ((a->step > 0) != (b->step > 0))
+		return (a->step > 0) ? -1 : 1;
+	if (a->parent != b->parent)
+		return ((a->parent > b->parent) == (a->step > 0)) ? -1 : 1;
+	return (a->step < b->step) ? -1 : (a->step > b->step);
+}
+
+/*
+ * Generate script with \p events ordinary events, half with a sequence
+ * of composite events, all with durations and waits of a few multiples
+ * of 10 ms so that many are placed at the same time. Each event gets
+ * a unique frequency, used to identify it. \p gen is set to an array
+ * of the events in the order expected.
+ *
+ * \return allocated string or NULL on error
+ */
+static char *generate_composites(size_t events, GenEvent **restrict gen,
+		size_t *restrict gen_count) {
+	SAU_ByteArr text = (SAU_ByteArr){0};
+	GenEvent *a = NULL;
+	size_t count = 0, alloc = 0;
+	uint64_t state = 1, time_ms = 0;
+	char str[64];
+	for (size_t i = 0; i < events; ++i) {
+		uint32_t r = rand_next(&state);
+		uint32_t steps = (r & 1) ? 1 + (r >> 1) % 4 : 0;
+		uint64_t step_time_ms = time_ms;
+		if (i > 0) {
+			uint32_t wait_ms = 10 * ((r >> 3) % 4);
+			time_ms += wait_ms;
+			step_time_ms = time_ms;
+			sprintf(str, "\\%.2f ", wait_ms * .001);
+			if (!add_text(&text, str, strlen(str))) goto ERROR;
+		}
+		for (uint32_t step = 0; step <= steps; ++step) {
+			uint32_t dur_ms = 10 * (1 + rand_next(&state) % 5);
+			if (count == alloc) {
+				alloc = alloc ? alloc * 2 : 1024;
+				GenEvent *new_a = realloc(a, alloc * sizeof(*a));
+				if (!new_a) goto ERROR;
+				a = new_a;
+			}
+			a[count] = (GenEvent){step_time_ms, count, i, step};
+			sprintf(str, step ? "; f%zu t%.2f" : "Osin f%zu t%.2f",
+					100 + count, dur_ms * .001);
+			if (!add_text(&text, str, strlen(str))) goto ERROR;
+			step_time_ms += dur_ms;
+			++count;
+		}
+		if (!add_text(&text, "\n", 2)) goto ERROR;
+		--text.count; // keep NUL after, overwritten by next
+	}
+	qsort(a, count, sizeof(*a), GenEvent_cmp);
+	*gen = a;
+	*gen_count = count;
+	return (char*) text.a;
+ERROR:
+	free(a);
+	SAU_ByteArr_clear(&text);
+	return NULL;
+}
+
+/*
+ * Check the order and times of events after flattening, for a
+ * generated script with \p events ordinary events and composites,
+ * against those expected. Mismatches are printed.
+ *
+ * \return true if all match
+ */
+static bool check_composites(size_t events) {
+	GenEvent *gen = NULL;
+	size_t gen_count = 0, count = 0, fails = 0;
+	SAU_Script *sd = NULL;
+	bool ok = false;
+	char *text = generate_composites(events, &gen, &gen_count);
+	if (!text) {
+		SAU_error(NULL, "memory allocation failure");
+		return false;
+	}
+	clock_t start = clock();
+	if (!(sd = SAU_load_Script(text, false, NULL)))
+		goto DONE;
+	double load_s = elapsed(start);
+	uint64_t time_ms = 0;
+	for (SAU_ScriptEvData *e = sd->events; e != NULL; e = e->next) {
+		const SAU_ScriptOpData *op = e->op_all.first;
+		uint32_t id = op ? lrintf(op->freq.v0) - 100 : UINT32_MAX;
+		time_ms += e->wait_ms;
+		if (count < gen_count &&
+				id == gen[count].id && time_ms == gen[count].time_ms) {
+			++count;
+			continue;
+		}
+		if (count < gen_count)
+			printf("  mismatch for event %zu: got %" PRIu32
+				" at %" PRIu64 " ms, expected %" PRIu32
+				" at %" PRIu64 " ms\n",
+				count, id, time_ms,
+				gen[count].id, gen[count].time_ms);
+		else
+			printf("  extra event %zu: got %" PRIu32 "\n",
+					count, id);
+		++count;
+		if (++fails == 10) break;
+	}
+	if (count < gen_count && fails < 10) {
+		printf("  %zu events missing\n", gen_count - count);
+		++fails;
+	}
+	printf("composites: %zu events from %zu, %zu mismatched, "
+		"%.3f ms to load\n",
+		gen_count, events, fails, load_s * 1000.0);
+	ok = !fails;
+DONE:
+	SAU_discard_Script(sd);
+	free(text);
+	free(gen);
+	return ok;
+}
+
 /*
  * Run script through test code.
  *
@@ -115,7 +899,7 @@ static SAU_Program *build_program(const char *restrict script_arg,
 #if SAU_TEST_SCANNER
 	SAU_Scanner *scanner = SAU_create_Scanner(symtab);
 	if (!scanner) goto CLOSE;
-	if (!SAU_Scanner_open(scanner, script_arg, is_path)) goto CLOSE;
+	if (!SAU_Scanner_open(scanner, script_arg, is_path, NULL)) goto CLOSE;
 	for (;;) {
 		uint8_t c = SAU_Scanner_getc(scanner);
 		if (!c) {
@@ -151,6 +935,7 @@ CLOSE:
  * \return number of programs successfully built
  */
 size_t SAU_build(const SAU_PtrArr *restrict script_args, uint32_t options,
+		const char *restrict cache_dir sauMaybeUnused,
 		SAU_PtrArr *restrict prg_objs) {
 	bool are_paths = !(options & SAU_ARG_EVAL_STRING);
 	size_t built = 0;
@@ -182,9 +967,27 @@ int main(int argc, char **restrict argv) {
 	SAU_PtrArr script_args = (SAU_PtrArr){0};
 	SAU_PtrArr prg_objs = (SAU_PtrArr){0};
 	uint32_t options = 0;
-	if (!parse_args(argc, argv, &options, &script_args))
+	BenchOpt bench = (BenchOpt){0};
+	if (!parse_args(argc, argv, &options, &script_args, &bench))
 		return 0;
-	bool error = !SAU_build(&script_args, options, &prg_objs);
+	if (bench.composites > 0)
+		return !check_composites(bench.composites);
+	if (bench.numbers)
+		return (bench.runs > 0) ?
+			!bench_numbers(bench.runs) :
+			!check_numbers();
+	if (bench.runs > 0) {
+		bool are_paths = !(options & SAU_ARG_EVAL_STRING);
+		const char **args = (const char**) SAU_PtrArr_ITEMS(&script_args);
+		bool error = false;
+		for (size_t i = 0; i < script_args.count; ++i) {
+			if (!bench_script(args[i], are_paths, &bench))
+				error = true;
+		}
+		SAU_PtrArr_clear(&script_args);
+		return error;
+	}
+	bool error = !SAU_build(&script_args, options, NULL, &prg_objs);
 	SAU_PtrArr_clear(&script_args);
 	if (error)
 		return 1;